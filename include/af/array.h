@@ -189,6 +189,19 @@ namespace af
          */
         array(const array& in);
 
+#if AF_API_VERSION >= 37
+#if __cplusplus > 199711L
+        /**
+            Moves the \p in array into the new array without creating a new
+            handle. \p in is left empty and can only be assigned to or
+            destroyed.
+
+            \param in The input \ref array
+         */
+        array(array &&in) noexcept;
+#endif
+#endif
+
         /**
             Allocate a one-dimensional array of a specified size with undefined
             contents
@@ -914,6 +927,19 @@ namespace af
         /// \note   This is a copy on write operation. The copy only occurs when the
         ///          operator() is used on the left hand side.
         ASSIGN(operator=)
+
+#if AF_API_VERSION >= 37
+#if __cplusplus > 199711L
+        /// \brief Moves the handle of \p other into this array
+        ///
+        /// The previous handle of this array is released. \p other is left
+        /// empty and can only be assigned to or destroyed.
+        ///
+        /// \param[in] other is the \ref af::array that is moved
+        /// \returns the reference to this
+        array& operator=(array &&other) noexcept;
+#endif
+#endif
         /// @}
 
         /// \ingroup array_mem_operator_plus_eq
@@ -0,0 +1,835 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <af/defines.h>
+#include <af/exception.h>
+
+#if AF_API_VERSION >= 37
+/// An independent queue of the CPU backend
+typedef void *afcpu_stream;
+
+/// A point on the queue of the CPU backend that the host can wait for
+typedef void *afcpu_event;
+
+/// The functions captured from the queue of a thread that can be replayed
+typedef void *afcpu_graph;
+
+/// The placement of new buffers on the NUMA nodes of the system
+typedef enum {
+    AFCPU_NUMA_DEFAULT    = 0, ///< Pages are placed on the node that first
+                               ///< writes them
+    AFCPU_NUMA_INTERLEAVE = 1, ///< Pages are interleaved across all nodes
+    AFCPU_NUMA_LOCAL      = 2, ///< Pages are written first by the threads
+                               ///< that execute the functions
+    AFCPU_NUMA_NODE       = 3  ///< Pages are placed on a single node
+} afcpu_numa_policy;
+
+/// The handling of writes to an array mapped from a file
+typedef enum {
+    AFCPU_MAP_READ_ONLY     = 0, ///< The array is copied before it is
+                                 ///< modified
+    AFCPU_MAP_COPY_ON_WRITE = 1  ///< Only the pages that are modified are
+                                 ///< copied
+} afcpu_map_mode;
+
+/// The counters of the functions enqueued on a queue of the CPU backend
+typedef struct {
+    unsigned long long queued;  ///< Functions executed by the worker
+    unsigned long long inlined; ///< Functions executed by the calling thread
+    unsigned long long stalls;  ///< Times a thread waited for the worker to
+                                ///< catch up
+    double stall_seconds;       ///< Time the threads waited for the worker
+} afcpu_queue_stats;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if AF_API_VERSION >= 37
+/**
+   Set the number of threads the CPU backend uses to execute a function
+
+   The queued functions are completed before the threads are replaced.
+
+   \param[in] num_threads The number of threads including the thread that
+                          executes the queue. The default number of threads is
+                          used if it is 0.
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_set_num_threads(int num_threads);
+
+/**
+   Get the number of threads the CPU backend uses to execute a function
+
+   \param[out] num_threads The number of threads including the thread that
+                           executes the queue
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_get_num_threads(int* num_threads);
+
+/**
+   Pin the worker threads of the CPU backend to separate cores
+
+   The queued functions are completed before the threads are replaced.
+   Pinning is ignored on OSX.
+
+   \param[in] pin The threads are pinned if true
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_set_thread_affinity(bool pin);
+
+/**
+   Create a stream that executes functions independently of the default queue
+
+   Functions called from a thread bound to the stream with
+   \ref afcpu_set_stream are executed in order on the stream. They are not
+   ordered with functions on other streams. An array used on more than one
+   stream must be synchronized with \ref af_sync by the thread that wrote it.
+
+   \param[out] stream The new stream
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_create_stream(afcpu_stream *stream);
+
+/**
+   Release a stream created with \ref afcpu_create_stream
+
+   The functions on the stream are completed. Threads that are still bound to
+   the stream continue to use it until they are bound to another stream.
+
+   \param[in] stream The stream to release
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_release_stream(afcpu_stream stream);
+
+/**
+   Bind the calling thread to a stream
+
+   \ref af_sync and the functions that read the data of an array only wait
+   for the stream of the calling thread.
+
+   \param[in] stream The stream created with \ref afcpu_create_stream. The
+                      thread uses the default queue if it is NULL.
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_set_stream(afcpu_stream stream);
+
+/**
+   Get the stream the calling thread is bound to
+
+   \param[out] stream The stream of the calling thread. It is NULL if the
+                       thread uses the default queue.
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_get_stream(afcpu_stream *stream);
+
+/**
+   Get the counters of the queue or stream of the calling thread
+
+   A thread waits for the worker of the queue when the functions on the queue
+   exceed AF_CPU_QUEUE_MAX_FUNCTIONS, when the arrays they use exceed
+   AF_CPU_QUEUE_MAX_BYTES, or when memory is low. The counters are never
+   reset.
+
+   \param[out] stats The counters of the queue
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_get_queue_stats(afcpu_queue_stats *stats);
+
+/**
+   Set the limits after which a thread waits for the worker of its queue
+
+   The limits apply to every queue and stream and replace the limits of
+   AF_CPU_QUEUE_MAX_FUNCTIONS and AF_CPU_QUEUE_MAX_BYTES.
+
+   \param[in] max_functions The number of functions on a queue. The limit of
+                             AF_CPU_QUEUE_MAX_FUNCTIONS is used if it is 0.
+   \param[in] max_bytes     The bytes of the arrays used by the functions on
+                             a queue. The limit of AF_CPU_QUEUE_MAX_BYTES is
+                             used if it is 0.
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_set_queue_limits(size_t max_functions, size_t max_bytes);
+
+/**
+   Get the number of NUMA nodes of the system
+
+   \param[out] count The number of nodes. It is 1 if the topology of the
+                      system is not available.
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_get_numa_node_count(int *count);
+
+/**
+   Set the placement of the buffers allocated by the calling thread
+
+   The policy applies to buffers of at least 1 MB that are allocated after
+   this call. Buffers that are reused from the memory manager keep their
+   placement. \ref AFCPU_NUMA_LOCAL places the pages near the threads of the
+   CPU backend, which is most effective after
+   \ref afcpu_set_thread_affinity.
+
+   The policy belongs to the calling thread rather than to an array. To place
+   a single array, set the policy before the function that creates the array
+   and restore it afterwards.
+
+   \param[in] policy The placement of new buffers. \ref AFCPU_NUMA_DEFAULT
+                      restores the policy set by AF_CPU_NUMA_POLICY.
+   \param[in] node   The node used with \ref AFCPU_NUMA_NODE. The nodes are
+                      numbered from 0 in the order of their system ids.
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_set_numa_policy(afcpu_numa_policy policy, int node);
+
+/**
+   Create an array whose data is mapped from a file
+
+   The data is read from the file when it is first used. The pages are shared
+   with the page cache, and with other processes that map the same file, until
+   they are modified. The file is never modified. The data must be stored in
+   column major order.
+
+   \param[out] out      The new array
+   \param[in]  filename The file that holds the data
+   \param[in]  offset   The position of the first element in the file in bytes.
+                        It must be a multiple of the size of an element.
+   \param[in]  ndims    The number of dimensions of the array
+   \param[in]  dims     The size of each dimension
+   \param[in]  type     The type of the elements
+   \param[in]  mode     The handling of writes to the array
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_map_array(af_array *out, const char *filename,
+                             dim_t offset, unsigned ndims,
+                             const dim_t *const dims, af_dtype type,
+                             afcpu_map_mode mode);
+
+/**
+   Create an array that is mapped from a file written by \ref af_save_array
+
+   \param[out] out      The new array
+   \param[in]  filename The file written by \ref af_save_array
+   \param[in]  key      The key of the array in the file. The first array
+                        saved with the key is mapped.
+   \param[in]  mode     The handling of writes to the array
+   \returns \ref af_err error code. \ref AF_ERR_NOT_SUPPORTED if the array
+            was saved by \ref af_save_array_compressed.
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_map_array_key(af_array *out, const char *filename,
+                                 const char *key, afcpu_map_mode mode);
+
+/**
+   Copy the data of an array to a host pointer without waiting for the copy
+
+   The copy is enqueued after the functions that compute the array. The
+   calling thread can enqueue more functions while it is copied.
+
+   \param[out] event The event that is complete when the data is copied. It
+                      must be released with \ref afcpu_release_event.
+   \param[out] data  The host pointer. It must stay valid until the event is
+                      complete.
+   \param[in]  arr   The array to copy
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_get_data_ptr_async(afcpu_event *event, void *data,
+                                      const af_array arr);
+
+/**
+   Copy data from a host pointer to an array without waiting for the copy
+
+   \param[out] event The event that is complete when the data is copied. It
+                      must be released with \ref afcpu_release_event.
+   \param[in]  arr   The array to write to
+   \param[in]  data  The host pointer. It must not be modified until the
+                      event is complete.
+   \param[in]  bytes The number of bytes to copy
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_write_array_async(afcpu_event *event, af_array arr,
+                                     const void *data, const size_t bytes);
+
+/**
+   Create an array from a host pointer without waiting for the copy
+
+   \param[out] event The event that is complete when the data is copied. It
+                      must be released with \ref afcpu_release_event.
+   \param[out] arr   The new array
+   \param[in]  data  The host pointer. It must not be modified until the
+                      event is complete.
+   \param[in]  ndims The number of dimensions of the array
+   \param[in]  dims  The size of each dimension
+   \param[in]  type  The type of the elements
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_create_array_async(afcpu_event *event, af_array *arr,
+                                      const void *const data,
+                                      const unsigned ndims,
+                                      const dim_t *const dims,
+                                      const af_dtype type);
+
+/**
+   Evaluate an array without waiting for the result
+
+   \param[out] event The event that is complete when the array is computed.
+                      It must be released with \ref afcpu_release_event.
+   \param[in]  arr   The array to evaluate
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_eval_async(afcpu_event *event, af_array arr);
+
+/**
+   Block the calling thread until an event is complete
+
+   \param[in] event The event returned by one of the asynchronous functions
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_wait_event(afcpu_event event);
+
+/**
+   Release an event returned by one of the asynchronous functions
+
+   The functions before the event are not waited for.
+
+   \param[in] event The event to release
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_release_event(afcpu_event event);
+
+/**
+   Write the profile of the functions executed by the CPU backend
+
+   The functions are recorded if the AF_CPU_PROFILE environment variable
+   names a file. The profile is written to that file when the process exits.
+   It holds the name of the function that enqueued each kernel, the types and
+   dimensions of its arrays, the time it ran and waited on the queue, and the
+   memory allocated for it. It can be viewed with chrome://tracing or
+   Perfetto.
+
+   \param[in] filename The file to write the profile to. The file named by
+                        AF_CPU_PROFILE is used if it is NULL.
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_write_profile(const char *filename);
+
+/**
+   Start capturing the functions the calling thread enqueues
+
+   The functions run as usual while they are captured. The buffers allocated
+   during the capture are kept by the graph, so each replay writes the same
+   arrays and allocates nothing. The functions are replayed with the same
+   arguments, so the values the functions read on the host during the capture
+   are fixed, and functions that read or write host pointers can not be
+   captured.
+
+   \param[in] inputs  The arrays whose data is replaced before each replay.
+                       Their data is overwritten by the replays.
+   \param[in] ninputs The number of inputs
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_begin_capture(const af_array *inputs,
+                                 const unsigned ninputs);
+
+/**
+   Stop capturing functions and create the graph of the captured functions
+
+   \param[out] graph    The graph. It must be released with
+                         \ref afcpu_release_graph.
+   \param[in]  outputs  The arrays that are evaluated before the capture
+                         ends. The replays write their data.
+   \param[in]  noutputs The number of outputs
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_end_capture(afcpu_graph *graph, const af_array *outputs,
+                               const unsigned noutputs);
+
+/**
+   Enqueue the functions of a graph without waiting for them
+
+   \param[in] graph   The graph created by \ref afcpu_end_capture
+   \param[in] inputs  The arrays copied to the inputs of the graph. They must
+                       have the types and the dimensions of the inputs passed
+                       to \ref afcpu_begin_capture.
+   \param[in] ninputs The number of inputs
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_replay_graph(afcpu_graph graph, const af_array *inputs,
+                                const unsigned ninputs);
+
+/**
+   Release a graph and the buffers allocated during its capture
+
+   \param[in] graph The graph to release
+   \returns \ref af_err error code
+
+   \ingroup cpu_mat
+ */
+AFAPI af_err afcpu_release_graph(afcpu_graph graph);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <af/array.h>
+#include <af/dim4.hpp>
+
+#include <vector>
+
+namespace afcpu
+{
+
+#if AF_API_VERSION >= 37
+/**
+   Set the number of threads the CPU backend uses to execute a function
+
+   \param[in] num_threads The number of threads including the thread that
+                          executes the queue. The default number of threads is
+                          used if it is 0.
+
+   \ingroup cpu_mat
+ */
+static inline void setNumThreads(int num_threads)
+{
+    af_err err = afcpu_set_num_threads(num_threads);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to set the number of CPU threads");
+}
+
+/**
+   Get the number of threads the CPU backend uses to execute a function
+
+   \returns the number of threads including the thread that executes the queue
+
+   \ingroup cpu_mat
+ */
+static inline int getNumThreads()
+{
+    int retVal;
+    af_err err = afcpu_get_num_threads(&retVal);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to get the number of CPU threads");
+    return retVal;
+}
+
+/**
+   Pin the worker threads of the CPU backend to separate cores
+
+   \param[in] pin The threads are pinned if true
+
+   \ingroup cpu_mat
+ */
+static inline void setThreadAffinity(bool pin)
+{
+    af_err err = afcpu_set_thread_affinity(pin);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to set the affinity of the CPU threads");
+}
+
+/**
+   Create a stream that executes functions independently of the default queue
+
+   \returns the new stream
+
+   \ingroup cpu_mat
+ */
+static inline afcpu_stream createStream()
+{
+    afcpu_stream retVal;
+    af_err err = afcpu_create_stream(&retVal);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to create a CPU stream");
+    return retVal;
+}
+
+/**
+   Release a stream created with afcpu::createStream
+
+   \param[in] stream The stream to release
+
+   \ingroup cpu_mat
+ */
+static inline void releaseStream(afcpu_stream stream)
+{
+    af_err err = afcpu_release_stream(stream);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to release the CPU stream");
+}
+
+/**
+   Bind the calling thread to a stream
+
+   \param[in] stream The stream created with afcpu::createStream. The thread
+                      uses the default queue if it is NULL.
+
+   \ingroup cpu_mat
+ */
+static inline void setStream(afcpu_stream stream)
+{
+    af_err err = afcpu_set_stream(stream);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to set the CPU stream");
+}
+
+/**
+   Get the stream the calling thread is bound to
+
+   \returns the stream of the calling thread or NULL for the default queue
+
+   \ingroup cpu_mat
+ */
+static inline afcpu_stream getStream()
+{
+    afcpu_stream retVal;
+    af_err err = afcpu_get_stream(&retVal);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to get the CPU stream");
+    return retVal;
+}
+
+/**
+   Get the counters of the queue or stream of the calling thread
+
+   \returns the counters of the queue
+
+   \ingroup cpu_mat
+ */
+static inline afcpu_queue_stats getQueueStats()
+{
+    afcpu_queue_stats retVal;
+    af_err err = afcpu_get_queue_stats(&retVal);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to get the CPU queue counters");
+    return retVal;
+}
+
+/**
+   Set the limits after which a thread waits for the worker of its queue
+
+   \param[in] max_functions The number of functions on a queue. 0 restores
+                             the default limit.
+   \param[in] max_bytes     The bytes of the arrays used by the functions on
+                             a queue. 0 restores the default limit.
+
+   \ingroup cpu_mat
+ */
+static inline void setQueueLimits(size_t max_functions = 0,
+                                  size_t max_bytes = 0)
+{
+    af_err err = afcpu_set_queue_limits(max_functions, max_bytes);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to set the CPU queue limits");
+}
+
+/**
+   Get the number of NUMA nodes of the system
+
+   \returns the number of nodes
+
+   \ingroup cpu_mat
+ */
+static inline int getNumaNodeCount()
+{
+    int retVal;
+    af_err err = afcpu_get_numa_node_count(&retVal);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to get the number of NUMA nodes");
+    return retVal;
+}
+
+/**
+   Set the placement of the buffers allocated by the calling thread
+
+   \param[in] policy The placement of new buffers
+   \param[in] node   The node used with \ref AFCPU_NUMA_NODE
+
+   \ingroup cpu_mat
+ */
+static inline void setNumaPolicy(afcpu_numa_policy policy, int node = 0)
+{
+    af_err err = afcpu_set_numa_policy(policy, node);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to set the NUMA policy");
+}
+
+/**
+   Create an array whose data is mapped from a file
+
+   \param[in] filename The file that holds the data
+   \param[in] offset   The position of the first element in the file in bytes.
+                       It must be a multiple of the size of an element.
+   \param[in] dims     The dimensions of the array
+   \param[in] type     The type of the elements
+   \param[in] mode     The handling of writes to the array
+   \returns the array mapped from the file
+
+   \ingroup cpu_mat
+ */
+static inline af::array mapArray(const char *filename, dim_t offset,
+                                 const af::dim4 &dims, af::dtype type,
+                                 afcpu_map_mode mode = AFCPU_MAP_READ_ONLY)
+{
+    af_array out;
+    af_err err = afcpu_map_array(&out, filename, offset, dims.ndims(),
+                                 dims.get(), type, mode);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to map the array from the file");
+    return af::array(out);
+}
+
+/**
+   Create an array that is mapped from a file written by af::saveArray
+
+   \param[in] filename The file written by af::saveArray
+   \param[in] key      The key of the array in the file
+   \param[in] mode     The handling of writes to the array
+   \returns the array mapped from the file
+
+   \ingroup cpu_mat
+ */
+static inline af::array mapArray(const char *filename, const char *key,
+                                 afcpu_map_mode mode = AFCPU_MAP_READ_ONLY)
+{
+    af_array out;
+    af_err err = afcpu_map_array_key(&out, filename, key, mode);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to map the array from the file");
+    return af::array(out);
+}
+
+/**
+   Copy the data of an array to a host pointer without waiting for the copy
+
+   \param[out] data The host pointer. It must stay valid until the event is
+                     complete.
+   \param[in]  arr  The array to copy
+   \returns the event that is complete when the data is copied
+
+   \ingroup cpu_mat
+ */
+static inline afcpu_event hostAsync(void *data, const af::array &arr)
+{
+    afcpu_event retVal;
+    af_err err = afcpu_get_data_ptr_async(&retVal, data, arr.get());
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to copy the array to the host");
+    return retVal;
+}
+
+/**
+   Copy data from a host pointer to an array without waiting for the copy
+
+   \param[in] arr   The array to write to
+   \param[in] data  The host pointer. It must not be modified until the event
+                     is complete.
+   \param[in] bytes The number of bytes to copy
+   \returns the event that is complete when the data is copied
+
+   \ingroup cpu_mat
+ */
+static inline afcpu_event writeAsync(af::array &arr, const void *data,
+                                     size_t bytes)
+{
+    afcpu_event retVal;
+    af_err err = afcpu_write_array_async(&retVal, arr.get(), data, bytes);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to write the array");
+    return retVal;
+}
+
+/**
+   Evaluate an array without waiting for the result
+
+   \param[in] arr The array to evaluate
+   \returns the event that is complete when the array is computed
+
+   \ingroup cpu_mat
+ */
+static inline afcpu_event evalAsync(const af::array &arr)
+{
+    afcpu_event retVal;
+    af_err err = afcpu_eval_async(&retVal, arr.get());
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to evaluate the array");
+    return retVal;
+}
+
+/**
+   Block the calling thread until an event is complete
+
+   \param[in] event The event returned by one of the asynchronous functions
+
+   \ingroup cpu_mat
+ */
+static inline void waitEvent(afcpu_event event)
+{
+    af_err err = afcpu_wait_event(event);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to wait for the CPU event");
+}
+
+/**
+   Release an event returned by one of the asynchronous functions
+
+   \param[in] event The event to release
+
+   \ingroup cpu_mat
+ */
+static inline void releaseEvent(afcpu_event event)
+{
+    af_err err = afcpu_release_event(event);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to release the CPU event");
+}
+
+/**
+   Write the profile of the functions executed by the CPU backend
+
+   \param[in] filename The file to write the profile to. The file named by
+                        AF_CPU_PROFILE is used if it is NULL.
+
+   \ingroup cpu_mat
+ */
+static inline void writeProfile(const char *filename = NULL)
+{
+    af_err err = afcpu_write_profile(filename);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to write the CPU profile");
+}
+
+/**
+   Start capturing the functions the calling thread enqueues
+
+   \param[in] inputs The arrays whose data is replaced before each replay
+
+   \ingroup cpu_mat
+ */
+static inline void beginCapture(
+    const std::vector<af::array> &inputs = std::vector<af::array>())
+{
+    std::vector<af_array> handles;
+    for (size_t i = 0; i < inputs.size(); i++)
+        handles.push_back(inputs[i].get());
+    af_err err = afcpu_begin_capture(handles.empty() ? NULL : &handles[0],
+                                     (unsigned)handles.size());
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to start the capture");
+}
+
+/**
+   Stop capturing functions and create the graph of the captured functions
+
+   \param[in] outputs The arrays that are evaluated before the capture ends
+   \returns the graph that must be released with afcpu::releaseGraph
+
+   \ingroup cpu_mat
+ */
+static inline afcpu_graph endCapture(
+    const std::vector<af::array> &outputs = std::vector<af::array>())
+{
+    std::vector<af_array> handles;
+    for (size_t i = 0; i < outputs.size(); i++)
+        handles.push_back(outputs[i].get());
+    afcpu_graph retVal;
+    af_err err = afcpu_end_capture(&retVal,
+                                   handles.empty() ? NULL : &handles[0],
+                                   (unsigned)handles.size());
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to end the capture");
+    return retVal;
+}
+
+/**
+   Enqueue the functions of a graph without waiting for them
+
+   \param[in] graph  The graph created by afcpu::endCapture
+   \param[in] inputs The arrays copied to the inputs of the graph
+
+   \ingroup cpu_mat
+ */
+static inline void replayGraph(
+    afcpu_graph graph,
+    const std::vector<af::array> &inputs = std::vector<af::array>())
+{
+    std::vector<af_array> handles;
+    for (size_t i = 0; i < inputs.size(); i++)
+        handles.push_back(inputs[i].get());
+    af_err err = afcpu_replay_graph(graph,
+                                    handles.empty() ? NULL : &handles[0],
+                                    (unsigned)handles.size());
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to replay the graph");
+}
+
+/**
+   Release a graph and the buffers allocated during its capture
+
+   \param[in] graph The graph to release
+
+   \ingroup cpu_mat
+ */
+static inline void releaseGraph(afcpu_graph graph)
+{
+    af_err err = afcpu_release_graph(graph);
+    if (err!=AF_SUCCESS)
+        throw af::exception("Failed to release the graph");
+}
+#endif
+
+}
+#endif
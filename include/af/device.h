@@ -10,6 +10,32 @@
 #pragma once
 #include <af/defines.h>
 
+#if AF_API_VERSION >= 37
+/// The number of size classes of \ref af_memory_stats. Class 0 holds the
+/// requests of up to 1 KB and class i the requests of up to 2^(10 + i) bytes.
+/// The last class holds all the requests larger than 16 MB.
+#define AF_MEM_STATS_SIZE_CLASSES 16
+
+/// Statistics of the memory manager of a device
+typedef struct {
+    size_t used_bytes;        ///< Bytes in the buffers that are in use
+    size_t peak_used_bytes;   ///< Highest used_bytes since the last reset
+    size_t peak_alloc_bytes;  ///< Highest number of bytes allocated from the
+                              ///< device, including the free buffers, since
+                              ///< the last reset
+    size_t alloc_count;       ///< Number of allocation requests
+    size_t alloc_bytes;       ///< Bytes requested
+    size_t class_count[AF_MEM_STATS_SIZE_CLASSES];  ///< Requests per size
+                                                    ///< class
+    size_t class_bytes[AF_MEM_STATS_SIZE_CLASSES];  ///< Bytes requested per
+                                                    ///< size class
+    size_t reuse_count;       ///< Requests served with a free buffer
+    size_t native_count;      ///< Requests that allocated a new buffer
+    size_t gc_count;          ///< Number of garbage collections
+    double gc_seconds;        ///< Time spent in garbage collection
+} af_memory_stats;
+#endif
+
 #ifdef __cplusplus
 namespace af
 {
@@ -245,6 +271,20 @@ namespace af
     ///
     /// \ingroup device_func_mem
     AFAPI size_t getMemStepSize();
+
+#if AF_API_VERSION >= 37
+    /// \brief Get the statistics of the memory manager of the active device
+    ///
+    /// \returns the statistics since the last call to \ref resetMemStats
+    ///
+    /// \ingroup device_func_mem
+    AFAPI af_memory_stats deviceMemStats();
+
+    /// \brief Reset the counters and the peaks of \ref deviceMemStats
+    ///
+    /// \ingroup device_func_mem
+    AFAPI void resetMemStats();
+#endif
 }
 #endif
 
@@ -377,6 +417,43 @@ extern "C" {
     AFAPI af_err af_print_mem_info(const char *msg, const int device_id);
 #endif
 
+#if AF_API_VERSION >= 37
+    /**
+       Get the statistics of the memory manager of the active device
+
+       The counters and the peaks cover the time since the last call to
+       \ref af_device_mem_stats_reset.
+
+       \param[out] stats The statistics
+       \returns \ref af_err error code
+
+       \ingroup device_func_mem
+    */
+    AFAPI af_err af_device_mem_stats(af_memory_stats *stats);
+
+    /**
+       Reset the counters and the peaks of \ref af_device_mem_stats
+
+       \returns \ref af_err error code
+
+       \ingroup device_func_mem
+    */
+    AFAPI af_err af_device_mem_stats_reset();
+
+    /**
+       Get a table of the memory statistics of the active device
+
+       The table holds the statistics of \ref af_device_mem_stats and the
+       allocations of each function that created arrays since the last reset.
+
+       \param[out] output The table. It must be freed with \ref af_free_host.
+       \returns \ref af_err error code
+
+       \ingroup device_func_mem
+    */
+    AFAPI af_err af_device_mem_stats_report(char **output);
+#endif
+
     /**
        Call the garbage collection routine
        \ingroup device_func_mem
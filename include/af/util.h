@@ -9,6 +9,7 @@
 
 #pragma once
 #include <af/defines.h>
+#include <af/seq.h>
 
 #ifdef __cplusplus
 namespace af
@@ -49,6 +50,24 @@ namespace af
     AFAPI int saveArray(const char *key, const array &arr, const char *filename, const bool append = false);
 #endif
 
+#if AF_API_VERSION >= 37
+    /**
+        \param[in] key is an expression used as tag/key for the array during \ref readArray
+        \param[in] arr is the array to be written
+        \param[in] filename is the path to the location on disk
+        \param[in] append is used to append to an existing file when true and create or
+        overwrite an existing file when false
+        \param[in] compress is used to compress the data of the array when true. The array
+        is read by \ref readArray the same way as an uncompressed array.
+
+        \returns index of the saved array in the file
+
+        \ingroup stream_func_save
+    */
+    AFAPI int saveArray(const char *key, const array &arr, const char *filename,
+                        const bool append, const bool compress);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         \param[in] filename is the path to the location on disk
@@ -92,6 +111,28 @@ namespace af
     AFAPI int readArrayCheck(const char *filename, const char *key);
 #endif
 
+#if AF_API_VERSION >= 37
+    /**
+        Only the elements selected by the sequences are read from the file.
+
+        \param[in] filename is the path to the location on disk
+        \param[in] key is the tag/name of the array to be read. The key needs to have an exact match.
+        \param[in] s0 is the sequence of elements read along the first dimension
+        \param[in] s1 is the sequence of elements read along the second dimension
+        \param[in] s2 is the sequence of elements read along the third dimension
+        \param[in] s3 is the sequence of elements read along the fourth dimension
+
+        \returns array with the elements read by key
+
+        \note This function will throw an exception if the key is not found.
+
+        \ingroup stream_func_read
+    */
+    AFAPI array readArray(const char *filename, const char *key,
+                          const seq &s0, const seq &s1 = span,
+                          const seq &s2 = span, const seq &s3 = span);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         \param[out] output is the pointer to the c-string that will hold the data. The memory for
@@ -195,6 +236,27 @@ extern "C" {
     AFAPI af_err af_save_array(int *index, const char* key, const af_array arr, const char *filename, const bool append);
 #endif
 
+#if AF_API_VERSION >= 37
+    /**
+        Saves the array like \ref af_save_array and compresses its data.
+        The array is read by \ref af_read_array_key the same way as an
+        uncompressed array.
+
+        \param[out] index is the index location of the array in the file
+        \param[in] key is an expression used as tag/key for the array during \ref readArray()
+        \param[in] arr is the array to be written
+        \param[in] filename is the path to the location on disk
+        \param[in] append is used to append to an existing file when true and create or
+        overwrite an existing file when false
+
+        \ingroup stream_func_save
+    */
+    AFAPI af_err af_save_array_compressed(int *index, const char *key,
+                                          const af_array arr,
+                                          const char *filename,
+                                          const bool append);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         \param[out] out is the array read from index
@@ -235,6 +297,26 @@ extern "C" {
     AFAPI af_err af_read_array_key_check(int *index, const char *filename, const char* key);
 #endif
 
+#if AF_API_VERSION >= 37
+    /**
+        Only the elements selected by the sequences are read from the file.
+        The data of the other elements is not read.
+
+        \param[out] out is the array with the elements read by key
+        \param[in] filename is the path to the location on disk
+        \param[in] key is the tag/name of the array to be read. The key needs to have an exact match.
+        \param[in] ndims is the number of sequences. The remaining dimensions are read completely.
+        \param[in] index is the sequence of elements read along each dimension
+
+        \note This function will throw an exception if the key is not found.
+
+        \ingroup stream_func_read
+    */
+    AFAPI af_err af_read_array_key_seq(af_array *out, const char *filename,
+                                       const char *key, const unsigned ndims,
+                                       const af_seq *const index);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         \param[out] output is the pointer to the c-string that will hold the data. The memory for
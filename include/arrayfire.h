@@ -289,6 +289,14 @@
         kernels and do custom memory operations using native CUDA commands. The functions
         contained in the \p afcu namespace provide methods to get the stream and native
         device id that ArrayFire is using.
+
+     @defgroup cpu_mat CPU specific functions
+
+        \brief Controlling the threads used by ArrayFire's CPU backend.
+
+        The functions contained in the \p afcpu namespace set the number of
+        threads the CPU backend uses to execute a function and whether the
+        threads are pinned to cores.
    @}
 @}
 
@@ -163,7 +163,9 @@ detail::Array<T> &getCopyOnWriteArray(const af_array &arr) {
 
     ARG_ASSERT(0, A->isSparse() == false);
 
-    if (A->useCount() > 1) { *A = copyArray(*A); }
+    // Arrays that do not own their data, such as sub-arrays and read-only
+    // external arrays, are not modified in place
+    if (A->useCount() > 1 || !A->isOwner()) { *A = copyArray(*A); }
 
     return *A;
 }
@@ -288,6 +288,36 @@ af_err af_device_mem_info(size_t *alloc_bytes, size_t *alloc_buffers,
     return AF_SUCCESS;
 }
 
+af_err af_device_mem_stats(af_memory_stats *stats) {
+    try {
+        ARG_ASSERT(0, stats != nullptr);
+        memoryStats(stats);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err af_device_mem_stats_reset() {
+    try {
+        resetMemoryStats();
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err af_device_mem_stats_report(char **output) {
+    try {
+        ARG_ASSERT(0, output != nullptr);
+        const std::string report = memoryStatsReport();
+        void *ptr                = nullptr;
+        AF_CHECK(af_alloc_host(&ptr, report.size() + 1));
+        memcpy(ptr, report.c_str(), report.size() + 1);
+        *output = static_cast<char *>(ptr);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
 af_err af_set_mem_step_size(const size_t step_bytes) {
     try {
         detail::setMemStepSize(step_bytes);
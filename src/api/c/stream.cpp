@@ -9,21 +9,36 @@
 
 #include <backend.hpp>
 #include <common/ArrayInfo.hpp>
+#include <common/compression.hpp>
+#include <common/dispatch.hpp>
 #include <common/err_common.hpp>
 #include <handle.hpp>
+#include <indexing_common.hpp>
 #include <type_util.hpp>
 
 #include <af/array.h>
 #include <af/index.h>
-
+#if defined(AF_CPU)
+#include <platform.hpp>
+#include <thread_pool.hpp>
+#include <af/cpu.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
+#include <string>
 #include <vector>
 
 using std::string;
 using std::vector;
 
 using af::dim4;
+using common::convert2Canonical;
 using detail::cdouble;
 using detail::cfloat;
 using detail::createHostDataArray;
@@ -33,40 +48,257 @@ using detail::uint;
 using detail::uintl;
 using detail::ushort;
 
-#define STREAM_FORMAT_VERSION 0x1
+#define STREAM_FORMAT_VERSION 0x2
 static const char sfv_char = STREAM_FORMAT_VERSION;
 
-template<typename T>
-static int save(const char *key, const af_array arr, const char *filename,
-                const bool append = false) {
-    // (char     )   Version (Once)
-    // (int      )   No. of Arrays (Once)
-    // (int    )   Length of the key
-    // (cstring)   Key
-    // (intl   )   Offset bytes to next array (type + dims + data)
-    // (char   )   Type
-    // (intl   )   dim4 (x 4)
-    // (T      )   data (x elements)
-    // Setup all the data structures that need to be written to file
-    ///////////////////////////////////////////////////////////////////////////
-    std::string k(key);
-    int klen = k.size();
+// Version 2 layout
+//
+// (StreamHeader)   Header
+// (T           )   Data of each array (x elements). 64 byte aligned.
+// (StreamEntry )   Index of the arrays (x No. of arrays)
+// (int         )   Key table (x No. of slots)
+// (char        )   Keys
+//
+// The key table is an open addressing hash table of the keys. Each slot holds
+// the position of an entry in the index plus one, or 0 if it is empty. An
+// array is found with a few reads regardless of the number of arrays in the
+// file, and its data can be read in one call or mapped into memory.
+//
+// Appending an array writes its data and a new index after the index, and
+// then the header that points to the new index. The file holds the previous
+// arrays until the header is replaced. The space of the previous index is
+// not reused.
+//
+// The data of a compressed array is split into chunks that are compressed
+// separately, so that they are compressed and decompressed in parallel and
+// part of the array can be read without decompressing all of it.
+//
+// (intl        )   Uncompressed size of a chunk in bytes. The last chunk is
+//                  smaller if the size of the data is not a multiple of it.
+// (intl        )   Offset of the end of each chunk from the end of this table
+//                  (x No. of chunks)
+// (char        )   Chunks. A chunk that does not compress is stored as is.
+
+struct StreamHeader {
+    char version;
+    char reserved[3];
+    int n_arrays;
+    intl index_offset;  // Offset of the index from the start of the file
+    intl n_slots;       // Number of slots in the key table
+    intl reserved2;
+};
+
+struct StreamEntry {
+    intl key_offset;  // Offset of the key from the start of the keys
+    int key_length;
+    char type;
+    char codec;  // STREAM_CODEC_NONE or STREAM_CODEC_SHUFFLE_LZ
+    char reserved[2];
+    intl data_offset;  // Offset of the data from the start of the file
+    intl dims[4];
+    intl data_bytes;  // Size of the data in the file
+};
+
+static_assert(sizeof(StreamHeader) == 32, "Unexpected StreamHeader size");
+static_assert(sizeof(StreamEntry) == 64, "Unexpected StreamEntry size");
+
+static const intl STREAM_DATA_ALIGNMENT = 64;
+
+static const char STREAM_CODEC_NONE       = 0;
+static const char STREAM_CODEC_SHUFFLE_LZ = 1;
+
+// Large enough to compress well and small enough to split the arrays that
+// are worth compressing across the threads
+static const intl STREAM_CHUNK_BYTES = 256 * 1024;
+
+/// Calls \p func for each chunk in [0, \p count). The CPU backend splits the
+/// chunks across its thread pool.
+static void forEachChunk(intl count, const std::function<void(intl)> &func) {
+#if defined(AF_CPU)
+    detail::threadPool().parallel_for(count, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t chunk = begin; chunk < end; chunk++) { func(chunk); }
+    });
+#else
+    for (intl chunk = 0; chunk < count; chunk++) { func(chunk); }
+#endif
+}
 
-    const ArrayInfo &info = getInfo(arr);
-    std::vector<T> data(info.elements());
+static intl alignStreamOffset(intl offset) {
+    return (offset + STREAM_DATA_ALIGNMENT - 1) / STREAM_DATA_ALIGNMENT *
+           STREAM_DATA_ALIGNMENT;
+}
+
+// FNV-1a hash of the key
+static uint64_t hashStreamKey(const char *key, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<unsigned char>(key[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static StreamHeader readStreamHeader(std::istream &is) {
+    StreamHeader header;
+    is.seekg(0);
+    is.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!is || header.n_arrays < 0 || header.n_slots < header.n_arrays) {
+        AF_ERROR("Invalid file header", AF_ERR_ARG);
+    }
+    return header;
+}
+
+static StreamEntry readStreamEntry(std::istream &is,
+                                   const StreamHeader &header, int index) {
+    StreamEntry entry;
+    is.seekg(header.index_offset + index * sizeof(StreamEntry));
+    is.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+    if (!is) { AF_ERROR("Invalid file index", AF_ERR_ARG); }
+    return entry;
+}
+
+static intl getKeysOffset(const StreamHeader &header) {
+    return header.index_offset + header.n_arrays * sizeof(StreamEntry) +
+           header.n_slots * sizeof(int);
+}
+
+// Returns the position of the first array saved with key or -1
+static int findStreamEntry(std::istream &is, const StreamHeader &header,
+                           const string &key) {
+    if (header.n_slots == 0) { return -1; }
+
+    const intl table_offset =
+        header.index_offset + header.n_arrays * sizeof(StreamEntry);
+    const intl keys_offset = getKeysOffset(header);
+
+    intl slot = hashStreamKey(key.data(), key.size()) & (header.n_slots - 1);
+    for (intl probe = 0; probe < header.n_slots; probe++) {
+        int position = 0;
+        is.seekg(table_offset + slot * sizeof(int));
+        is.read(reinterpret_cast<char *>(&position), sizeof(int));
+        if (!is || position <= 0) { return -1; }
+
+        StreamEntry entry = readStreamEntry(is, header, position - 1);
+        if (entry.key_length == static_cast<int>(key.size())) {
+            string readKey(key.size(), '\0');
+            is.seekg(keys_offset + entry.key_offset);
+            is.read(&readKey.front(), key.size());
+            if (readKey == key) { return position - 1; }
+        }
+        slot = (slot + 1) & (header.n_slots - 1);
+    }
+    return -1;
+}
+
+// Writes the index and the header. The index starts at header.index_offset.
+static void writeStreamIndex(std::ostream &os, StreamHeader &header,
+                             const vector<StreamEntry> &entries,
+                             const string &keys) {
+    intl n_slots = 8;
+    while (n_slots < 2 * static_cast<intl>(entries.size())) { n_slots *= 2; }
+
+    // Only the first array with a key is found, as in version 1
+    vector<int> table(n_slots, 0);
+    for (size_t i = 0; i < entries.size(); i++) {
+        const char *key = keys.data() + entries[i].key_offset;
+        const size_t length = entries[i].key_length;
+        intl slot = hashStreamKey(key, length) & (n_slots - 1);
+        bool duplicate = false;
+        while (table[slot] != 0 && !duplicate) {
+            const StreamEntry &other = entries[table[slot] - 1];
+            duplicate = other.key_length == entries[i].key_length &&
+                        keys.compare(other.key_offset, length, key, length) ==
+                            0;
+            slot = (slot + 1) & (n_slots - 1);
+        }
+        if (!duplicate) { table[slot] = static_cast<int>(i) + 1; }
+    }
 
-    AF_CHECK(af_get_data_ptr(&data.front(), arr));
+    header.n_arrays = static_cast<int>(entries.size());
+    header.n_slots  = n_slots;
 
-    char type = info.getType();
+    os.seekp(header.index_offset);
+    os.write(reinterpret_cast<const char *>(entries.data()),
+             entries.size() * sizeof(StreamEntry));
+    os.write(reinterpret_cast<const char *>(table.data()),
+             table.size() * sizeof(int));
+    os.write(keys.data(), keys.size());
 
-    intl odims[4];
-    for (int i = 0; i < 4; i++) { odims[i] = info.dims()[i]; }
+    // The index must be complete before the header points to it
+    os.flush();
+    os.seekp(0);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+/// Returns the elements of arr on the host. They are copied to host_data
+/// unless they can be read from the buffer of the array.
+template<typename T>
+static const T *getHostData(const af_array arr, vector<T> &host_data) {
+#if defined(AF_CPU)
+    // The data of linear arrays is read from the buffer of the array
+    const detail::Array<T> &in = getArray<T>(arr);
+    in.eval();
+    if (in.isLinear()) {
+        return static_cast<const T *>(getRawPtr(in)) + in.getOffset();
+    }
+#endif
+    host_data.resize(getInfo(arr).elements());
+    AF_CHECK(af_get_data_ptr(host_data.data(), arr));
+    return host_data.data();
+}
+
+// Returns the number of bytes written
+template<typename T>
+static intl writeData(std::ostream &os, const af_array arr) {
+    vector<T> host_data;
+    const T *data    = getHostData<T>(arr, host_data);
+    const intl bytes = getInfo(arr).elements() * sizeof(T);
+    os.write(reinterpret_cast<const char *>(data), bytes);
+    return bytes;
+}
+
+// Returns the number of bytes written
+template<typename T>
+static intl writeCompressedData(std::ostream &os, const af_array arr) {
+    vector<T> host_data;
+    const char *data =
+        reinterpret_cast<const char *>(getHostData<T>(arr, host_data));
+    const intl bytes    = getInfo(arr).elements() * sizeof(T);
+    const intl n_chunks = divup(bytes, STREAM_CHUNK_BYTES);
+
+    vector<vector<char>> chunks(n_chunks);
+    forEachChunk(n_chunks, [&](intl chunk) {
+        const intl begin  = chunk * STREAM_CHUNK_BYTES;
+        const intl size   = std::min(STREAM_CHUNK_BYTES, bytes - begin);
+        const char *first = data + begin;
+        chunks[chunk]     = common::compressChunk(first, size, sizeof(T));
+        if (chunks[chunk].empty()) {
+            chunks[chunk].assign(first, first + size);
+        }
+    });
+
+    vector<intl> table(1, STREAM_CHUNK_BYTES);
+    intl end = 0;
+    for (const auto &chunk : chunks) {
+        end += chunk.size();
+        table.push_back(end);
+    }
+    os.write(reinterpret_cast<const char *>(table.data()),
+             table.size() * sizeof(intl));
+    for (const auto &chunk : chunks) { os.write(chunk.data(), chunk.size()); }
+    return table.size() * sizeof(intl) + end;
+}
 
-    intl offset = sizeof(char) + 4 * sizeof(intl) + info.elements() * sizeof(T);
-    ///////////////////////////////////////////////////////////////////////////
+template<typename T>
+static int save(const char *key, const af_array arr, const char *filename,
+                const bool append, const bool compress) {
+    const ArrayInfo &info = getInfo(arr);
 
     std::fstream fs;
-    int n_arrays = 0;
+    StreamHeader header = {};
+    header.version      = sfv_char;
+    header.index_offset = sizeof(StreamHeader);
+    vector<StreamEntry> entries;
+    string keys;
 
     if (append) {
         std::ifstream checkIfExists(filename);
@@ -82,19 +314,28 @@ static int save(const char *key, const af_array arr, const char *filename,
         // Throw exception if file is not open
         if (!fs.is_open()) AF_ERROR("File failed to open", AF_ERR_ARG);
 
-        // Assert Version
         if (fs.peek() == std::fstream::traits_type::eof()) {
             // File is empty
             fs.clear();
         } else {
-            char prev_version = 0;
-            fs.read(&prev_version, sizeof(char));
-
-            AF_ASSERT(
-                prev_version == sfv_char,
-                "ArrayFire data format has changed. Can't append to file");
-
-            fs.read((char *)&n_arrays, sizeof(int));
+            if (fs.peek() != sfv_char) {
+                AF_ERROR(
+                    "ArrayFire data format has changed. Can't append to file",
+                    AF_ERR_ARG);
+            }
+            header = readStreamHeader(fs);
+
+            entries.resize(header.n_arrays);
+            fs.seekg(header.index_offset);
+            fs.read(reinterpret_cast<char *>(entries.data()),
+                    entries.size() * sizeof(StreamEntry));
+            if (!entries.empty()) {
+                const StreamEntry &last = entries.back();
+                keys.resize(last.key_offset + last.key_length);
+                fs.seekg(getKeysOffset(header));
+                fs.read(&keys.front(), keys.size());
+            }
+            if (!fs) { AF_ERROR("Invalid file index", AF_ERR_ARG); }
         }
     } else {
         fs.open(filename,
@@ -104,24 +345,56 @@ static int save(const char *key, const af_array arr, const char *filename,
         if (!fs.is_open()) AF_ERROR("File failed to open", AF_ERR_ARG);
     }
 
-    n_arrays++;
-
-    // Write version and n_arrays to top of file
-    fs.seekp(0);
-    fs.write(&sfv_char, 1);
-    fs.write((char *)&n_arrays, sizeof(int));
-
-    // Write array to end of file. Irrespective of new or append
-    fs.seekp(0, std::ios_base::end);
-    fs.write((char *)&klen, sizeof(int));
-    fs.write(k.c_str(), klen);
-    fs.write((char *)&offset, sizeof(intl));
-    fs.write(&type, sizeof(char));
-    fs.write((char *)&odims, sizeof(intl) * 4);
-    fs.write((char *)&data.front(), sizeof(T) * data.size());
+    // The data follows the previous index, which stays valid until the
+    // header is replaced
+    const intl index_end = getKeysOffset(header) + keys.size();
+
+    StreamEntry entry = {};
+    entry.key_offset  = keys.size();
+    entry.key_length  = static_cast<int>(strlen(key));
+    entry.type        = info.getType();
+    entry.codec       = compress ? STREAM_CODEC_SHUFFLE_LZ : STREAM_CODEC_NONE;
+    entry.data_offset = alignStreamOffset(index_end);
+    for (int i = 0; i < 4; i++) { entry.dims[i] = info.dims()[i]; }
+    keys.append(key, entry.key_length);
+
+    // The gap before the data is filled so that the file does not depend on
+    // how the stream extends it
+    fs.seekp(index_end);
+    const string padding(entry.data_offset - index_end, '\0');
+    fs.write(padding.data(), padding.size());
+    entry.data_bytes = compress ? writeCompressedData<T>(fs, arr)
+                                : writeData<T>(fs, arr);
+
+    entries.push_back(entry);
+    header.index_offset = entry.data_offset + entry.data_bytes;
+    writeStreamIndex(fs, header, entries, keys);
+    if (!fs) { AF_ERROR("Failed to write the file", AF_ERR_RUNTIME); }
     fs.close();
 
-    return n_arrays - 1;
+    return header.n_arrays - 1;
+}
+
+static int saveArray(const char *key, const af_array arr,
+                     const char *filename, const bool append,
+                     const bool compress) {
+    const ArrayInfo &info = getInfo(arr);
+    af_dtype type         = info.getType();
+    switch (type) {
+        case f32: return save<float>(key, arr, filename, append, compress);
+        case c32: return save<cfloat>(key, arr, filename, append, compress);
+        case f64: return save<double>(key, arr, filename, append, compress);
+        case c64: return save<cdouble>(key, arr, filename, append, compress);
+        case b8: return save<char>(key, arr, filename, append, compress);
+        case s32: return save<int>(key, arr, filename, append, compress);
+        case u32: return save<unsigned>(key, arr, filename, append, compress);
+        case u8: return save<uchar>(key, arr, filename, append, compress);
+        case s64: return save<intl>(key, arr, filename, append, compress);
+        case u64: return save<uintl>(key, arr, filename, append, compress);
+        case s16: return save<short>(key, arr, filename, append, compress);
+        case u16: return save<ushort>(key, arr, filename, append, compress);
+        default: TYPE_ERROR(1, type);
+    }
 }
 
 af_err af_save_array(int *index, const char *key, const af_array arr,
@@ -130,63 +403,41 @@ af_err af_save_array(int *index, const char *key, const af_array arr,
         ARG_ASSERT(0, key != NULL);
         ARG_ASSERT(2, filename != NULL);
 
-        const ArrayInfo &info = getInfo(arr);
-        af_dtype type         = info.getType();
-        int id                = -1;
-        switch (type) {
-            case f32: id = save<float>(key, arr, filename, append); break;
-            case c32: id = save<cfloat>(key, arr, filename, append); break;
-            case f64: id = save<double>(key, arr, filename, append); break;
-            case c64: id = save<cdouble>(key, arr, filename, append); break;
-            case b8: id = save<char>(key, arr, filename, append); break;
-            case s32: id = save<int>(key, arr, filename, append); break;
-            case u32: id = save<unsigned>(key, arr, filename, append); break;
-            case u8: id = save<uchar>(key, arr, filename, append); break;
-            case s64: id = save<intl>(key, arr, filename, append); break;
-            case u64: id = save<uintl>(key, arr, filename, append); break;
-            case s16: id = save<short>(key, arr, filename, append); break;
-            case u16: id = save<ushort>(key, arr, filename, append); break;
-            default: TYPE_ERROR(1, type);
-        }
+        int id = saveArray(key, arr, filename, append, false);
         std::swap(*index, id);
     }
     CATCHALL;
     return AF_SUCCESS;
 }
 
-template<typename T>
-static af_array readDataToArray(std::fstream &fs) {
-    intl dims[4];
-    fs.read((char *)&dims, 4 * sizeof(intl));
-
-    dim4 d;
-    for (int i = 0; i < 4; i++) { d[i] = dims[i]; }
-
-    intl size = d.elements();
-
-    std::vector<T> data(size);
-    fs.read((char *)&data.front(), size * sizeof(T));
+af_err af_save_array_compressed(int *index, const char *key,
+                                const af_array arr, const char *filename,
+                                const bool append) {
+    try {
+        ARG_ASSERT(0, key != NULL);
+        ARG_ASSERT(2, filename != NULL);
 
-    return getHandle(createHostDataArray<T>(d, &data.front()));
+        int id = saveArray(key, arr, filename, append, true);
+        std::swap(*index, id);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
 }
 
-static af_array readArrayV1(const char *filename, const unsigned index) {
-    char version = 0;
-    int n_arrays = 0;
-
-    std::fstream fs(filename, std::fstream::in | std::fstream::binary);
-
-    // Throw exception if file is not open
-    if (!fs.is_open()) AF_ERROR("File failed to open", AF_ERR_ARG);
-
-    if (fs.peek() == std::fstream::traits_type::eof()) {
-        AF_ERROR("File is empty", AF_ERR_ARG);
-    }
+// The position of the data of an array in a file
+struct StreamArray {
+    intl data_offset;
+    af_dtype type;
+    char codec;
+    dim4 dims;
+};
 
-    fs.read(&version, sizeof(char));
+static StreamArray locateArrayV1(std::istream &fs, const unsigned index) {
+    int n_arrays = 0;
+    fs.seekg(sizeof(char));
     fs.read((char *)&n_arrays, sizeof(int));
 
-    AF_ASSERT((int)index < n_arrays, "Index out of bounds");
+    if ((int)index >= n_arrays) AF_ERROR("Index out of bounds", AF_ERR_ARG);
 
     for (int i = 0; i < (int)index; i++) {
         // (int    )   Length of the key
@@ -198,9 +449,6 @@ static af_array readArrayV1(const char *filename, const unsigned index) {
         int klen = -1;
         fs.read((char *)&klen, sizeof(int));
 
-        // char* key = new char[klen];
-        // fs.read((char*)&key, klen * sizeof(char));
-
         // Skip the array name tag
         fs.seekg(klen, std::ios_base::cur);
 
@@ -215,67 +463,397 @@ static af_array readArrayV1(const char *filename, const unsigned index) {
     int klen = -1;
     fs.read((char *)&klen, sizeof(int));
 
-    // char* key = new char[klen];
-    // fs.read((char*)&key, klen * sizeof(char));
-
-    // Skip the array name tag
-    fs.seekg(klen, std::ios_base::cur);
-
-    // Read data offset
-    intl offset = -1;
-    fs.read((char *)&offset, sizeof(intl));
+    // Skip the array name tag and the data offset
+    fs.seekg(klen + sizeof(intl), std::ios_base::cur);
 
     // Read type and dims
-    char type_ = -1;
-    fs.read(&type_, sizeof(char));
+    char type = -1;
+    fs.read(&type, sizeof(char));
+    intl dims[4];
+    fs.read((char *)&dims, 4 * sizeof(intl));
+    if (!fs) AF_ERROR("File is truncated", AF_ERR_ARG);
+
+    StreamArray array;
+    array.data_offset = fs.tellg();
+    array.type        = (af_dtype)type;
+    array.codec       = STREAM_CODEC_NONE;
+    for (int i = 0; i < 4; i++) { array.dims[i] = dims[i]; }
+    return array;
+}
 
-    af_dtype type = (af_dtype)type_;
+static StreamArray locateArrayV2(std::istream &fs, const unsigned index) {
+    StreamHeader header = readStreamHeader(fs);
+    if (index >= static_cast<unsigned>(header.n_arrays)) {
+        AF_ERROR("Index out of bounds", AF_ERR_ARG);
+    }
+    StreamEntry entry = readStreamEntry(fs, header, index);
+
+    StreamArray array;
+    array.data_offset = entry.data_offset;
+    array.type        = (af_dtype)entry.type;
+    array.codec       = entry.codec;
+    for (int i = 0; i < 4; i++) { array.dims[i] = entry.dims[i]; }
+    return array;
+}
 
-    af_array out;
-    switch (type) {
-        case f32: out = readDataToArray<float>(fs); break;
-        case c32: out = readDataToArray<cfloat>(fs); break;
-        case f64: out = readDataToArray<double>(fs); break;
-        case c64: out = readDataToArray<cdouble>(fs); break;
-        case b8: out = readDataToArray<char>(fs); break;
-        case s32: out = readDataToArray<int>(fs); break;
-        case u32: out = readDataToArray<uint>(fs); break;
-        case u8: out = readDataToArray<uchar>(fs); break;
-        case s64: out = readDataToArray<intl>(fs); break;
-        case u64: out = readDataToArray<uintl>(fs); break;
-        case s16: out = readDataToArray<short>(fs); break;
-        case u16: out = readDataToArray<ushort>(fs); break;
-        default: TYPE_ERROR(1, type);
+static StreamArray checkVersionAndLocate(std::istream &fs,
+                                         const string &filename,
+                                         const unsigned index) {
+    if (fs.peek() == std::istream::traits_type::eof()) {
+        std::string errStr = filename + " is empty";
+        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
     }
-    fs.close();
 
-    return out;
+    switch (fs.peek()) {
+        case 1: return locateArrayV1(fs, index);
+        case 2: return locateArrayV2(fs, index);
+        default: AF_ERROR("Invalid version", AF_ERR_ARG);
+    }
 }
 
-static af_array checkVersionAndRead(const char *filename,
-                                    const unsigned index) {
-    char version = 0;
-
-    std::string filenameStr = std::string(filename);
-    std::fstream fs(filenameStr, std::fstream::in | std::fstream::binary);
+static void openStream(std::ifstream &fs, const string &filename) {
+    fs.open(filename, std::ifstream::in | std::ifstream::binary);
     // Throw exception if file is not open
     if (!fs.is_open()) {
-        std::string errStr = "Failed to open: " + filenameStr;
+        std::string errStr = "Failed to open: " + filename;
         AF_ERROR(errStr.c_str(), AF_ERR_ARG);
     }
+}
 
-    if (fs.peek() == std::fstream::traits_type::eof()) {
-        std::string errStr = filenameStr + " is empty";
-        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
+/// Returns the uncompressed size of the chunks of a compressed array
+template<typename T>
+static intl readChunkBytes(std::istream &is, const StreamArray &array) {
+    intl chunk_bytes = 0;
+    is.seekg(array.data_offset);
+    is.read((char *)&chunk_bytes, sizeof(intl));
+    if (!is || chunk_bytes <= 0 || chunk_bytes % sizeof(T) != 0) {
+        AF_ERROR("Invalid compressed data", AF_ERR_ARG);
+    }
+    return chunk_bytes;
+}
+
+/// Decompresses the elements [first, first + count) of a compressed array.
+/// Only the chunks that hold them are read.
+template<typename T>
+static void readCompressedElements(std::istream &is, const StreamArray &array,
+                                   intl first, intl count, T *out) {
+    if (count <= 0) { return; }
+    const intl bytes       = array.dims.elements() * sizeof(T);
+    const intl chunk_bytes = readChunkBytes<T>(is, array);
+
+    const intl n_chunks    = divup(bytes, chunk_bytes);
+    const intl begin_byte  = first * sizeof(T);
+    const intl end_byte    = (first + count) * sizeof(T);
+    const intl first_chunk = begin_byte / chunk_bytes;
+    const intl last_chunk  = divup(end_byte, chunk_bytes);
+
+    // ends[i] is the end of chunk first_chunk + i - 1, which is the start of
+    // chunk first_chunk + i
+    const intl table_offset = array.data_offset + sizeof(intl);
+    vector<intl> ends(last_chunk - first_chunk + 1, 0);
+    if (first_chunk > 0) {
+        is.seekg(table_offset + (first_chunk - 1) * sizeof(intl));
+        is.read((char *)ends.data(), ends.size() * sizeof(intl));
     } else {
-        fs.read(&version, sizeof(char));
+        is.seekg(table_offset);
+        is.read((char *)(ends.data() + 1), (ends.size() - 1) * sizeof(intl));
+    }
+    if (!is) { AF_ERROR("File is truncated", AF_ERR_ARG); }
+    for (size_t i = 0; i + 1 < ends.size(); i++) {
+        const intl begin = (first_chunk + intl(i)) * chunk_bytes;
+        const intl size  = std::min(chunk_bytes, bytes - begin);
+        if (ends[i] < 0 || ends[i + 1] < ends[i] ||
+            ends[i + 1] - ends[i] > size) {
+            AF_ERROR("Invalid compressed data", AF_ERR_ARG);
+        }
+    }
+
+    vector<char> compressed(ends.back() - ends.front());
+    is.seekg(table_offset + n_chunks * sizeof(intl) + ends.front());
+    is.read(compressed.data(), compressed.size());
+    if (!is) { AF_ERROR("File is truncated", AF_ERR_ARG); }
+
+    char *dst = reinterpret_cast<char *>(out);
+    forEachChunk(ends.size() - 1, [&](intl i) {
+        const intl chunk_begin = (first_chunk + i) * chunk_bytes;
+        const intl size        = std::min(chunk_bytes, bytes - chunk_begin);
+        const char *src        = compressed.data() + ends[i] - ends.front();
+        const intl src_bytes   = ends[i + 1] - ends[i];
+
+        // The part of the chunk that is read
+        const intl low  = std::max(begin_byte, chunk_begin);
+        const intl high = std::min(end_byte, chunk_begin + size);
+        char *part      = dst + low - begin_byte;
+        if (src_bytes == size) {
+            memcpy(part, src + low - chunk_begin, high - low);
+        } else if (high - low == size) {
+            common::decompressChunk(src, src_bytes, part, size, sizeof(T));
+        } else {
+            vector<char> chunk(size);
+            common::decompressChunk(src, src_bytes, chunk.data(), size,
+                                    sizeof(T));
+            memcpy(part, chunk.data() + low - chunk_begin, high - low);
+        }
+    });
+}
+
+template<typename T>
+static void readElements(std::istream &is, const StreamArray &array,
+                         intl first, dim_t count, T *out) {
+    if (array.codec == STREAM_CODEC_SHUFFLE_LZ) {
+        readCompressedElements(is, array, first, count, out);
+        return;
+    }
+    if (array.codec != STREAM_CODEC_NONE) {
+        AF_ERROR("Unknown compression codec", AF_ERR_ARG);
+    }
+    is.seekg(array.data_offset + first * sizeof(T));
+    is.read((char *)out, count * sizeof(T));
+}
+
+template<typename T>
+static af_array readData(std::istream &is, const StreamArray &array) {
+    const dim4 &d = array.dims;
+#if defined(AF_CPU)
+    // The data is read into the buffer of the new array
+    detail::Array<T> out = detail::createEmptyArray<T>(d);
+    readElements(is, array, 0, d.elements(),
+                 static_cast<T *>(getRawPtr(out)));
+    return getHandle(out);
+#else
+    std::vector<T> data(d.elements());
+    readElements(is, array, 0, d.elements(), data.data());
+
+    return getHandle(createHostDataArray<T>(d, data.data()));
+#endif
+}
+
+// The elements of a row that are further apart than this are read separately
+static const size_t STREAM_GATHER_BYTES = 4096;
+
+static void getSeqSteps(const vector<af_seq> &seqs, dim_t steps[4]) {
+    for (int i = 0; i < 4; i++) {
+        steps[i] = seqs[i].step == 0 ? 1 : (dim_t)seqs[i].step;
+    }
+}
+
+/// Reads the elements of an array selected by seqs, which must be canonical
+/// read(first, count, out) reads count elements starting at first.
+template<typename T, typename Reader>
+static void readSeqData(const StreamArray &array, const vector<af_seq> &seqs,
+                        const Reader &read, T *out) {
+    const dim4 &dims   = array.dims;
+    const dim4 odims   = toDims(seqs, dims);
+    const dim4 offsets = toOffset(seqs, dims);
+    const dim4 strides = calcStrides(dims);
+
+    dim_t steps[4];
+    getSeqSteps(seqs, steps);
+
+    // The leading dimensions that are read completely and the one after them
+    // are contiguous in the file when their step is 1, so they are read in
+    // one call
+    int contiguous = 0;
+    dim_t run      = 1;
+    if (steps[0] == 1) {
+        contiguous = 1;
+        run        = odims[0];
+        while (contiguous < 4 && steps[contiguous] == 1 &&
+               odims[contiguous - 1] == dims[contiguous - 1]) {
+            run *= odims[contiguous];
+            contiguous++;
+        }
+    }
+
+    vector<T> row;
+    for (dim_t l = 0; l < (contiguous > 3 ? 1 : odims[3]); l++) {
+        for (dim_t k = 0; k < (contiguous > 2 ? 1 : odims[2]); k++) {
+            for (dim_t j = 0; j < (contiguous > 1 ? 1 : odims[1]); j++) {
+                const intl first = offsets[0] +
+                                   (offsets[1] + j * steps[1]) * strides[1] +
+                                   (offsets[2] + k * steps[2]) * strides[2] +
+                                   (offsets[3] + l * steps[3]) * strides[3];
+                if (contiguous > 0) {
+                    read(first, run, out);
+                    out += run;
+                    continue;
+                }
+
+                // Read the range that holds the row and pick the elements
+                // unless they are far apart
+                const dim_t step = steps[0];
+                const dim_t n    = odims[0];
+                if (std::abs(step) * sizeof(T) <= STREAM_GATHER_BYTES) {
+                    const intl low = first + std::min(dim_t(0), step * (n - 1));
+                    row.resize(std::abs(step) * (n - 1) + 1);
+                    read(low, row.size(), row.data());
+                    for (dim_t i = 0; i < n; i++) {
+                        out[i] = row[first - low + i * step];
+                    }
+                } else {
+                    for (dim_t i = 0; i < n; i++) {
+                        read(first + i * step, 1, out + i);
+                    }
+                }
+                out += n;
+            }
+        }
+    }
+}
+
+template<typename T>
+static void readSeqElements(std::istream &is, const StreamArray &array,
+                            const vector<af_seq> &seqs, T *out) {
+    if (array.codec == STREAM_CODEC_NONE) {
+        readSeqData<T>(
+            array, seqs,
+            [&](intl first, dim_t count, T *dst) {
+                readElements(is, array, first, count, dst);
+            },
+            out);
+        return;
+    }
+
+    // Only the chunks that hold selected elements are decompressed. They
+    // are found first and each run of consecutive chunks is decompressed in
+    // one call.
+    const intl elements       = array.dims.elements();
+    const intl chunk_elements = readChunkBytes<T>(is, array) / sizeof(T);
+    const intl n_chunks       = divup(elements, chunk_elements);
+
+    vector<bool> used(n_chunks, false);
+    readSeqData<T>(
+        array, seqs,
+        [&](intl first, dim_t count, T *) {
+            const intl last = (first + count - 1) / chunk_elements;
+            for (intl c = first / chunk_elements; c <= last; c++) {
+                used[c] = true;
+            }
+        },
+        out);
+
+    vector<vector<T>> runs;
+    vector<const T *> chunks(n_chunks, nullptr);
+    for (intl begin = 0; begin < n_chunks; begin++) {
+        if (!used[begin]) { continue; }
+        intl end = begin + 1;
+        while (end < n_chunks && used[end]) { end++; }
+
+        const intl first = begin * chunk_elements;
+        const intl count = std::min(end * chunk_elements, elements) - first;
+        runs.emplace_back(count);
+        readCompressedElements(is, array, first, count, runs.back().data());
+        for (intl c = begin; c < end; c++) {
+            chunks[c] = runs.back().data() + (c - begin) * chunk_elements;
+        }
+        begin = end;
+    }
+
+    readSeqData<T>(
+        array, seqs,
+        [&](intl first, dim_t count, T *dst) {
+            while (count > 0) {
+                const intl chunk = first / chunk_elements;
+                const intl pos   = first - chunk * chunk_elements;
+                const intl n = std::min<intl>(count, chunk_elements - pos);
+                std::copy(chunks[chunk] + pos, chunks[chunk] + pos + n, dst);
+                first += n;
+                count -= n;
+                dst += n;
+            }
+        },
+        out);
+}
+
+template<typename T>
+static af_array readSeq(std::istream &is, const StreamArray &array,
+                        const vector<af_seq> &seqs) {
+    const dim4 odims = toDims(seqs, array.dims);
+#if defined(AF_CPU)
+    // The data is read into the buffer of the new array
+    detail::Array<T> out = detail::createEmptyArray<T>(odims);
+    readSeqElements<T>(is, array, seqs, static_cast<T *>(getRawPtr(out)));
+    return getHandle(out);
+#else
+    std::vector<T> data(odims.elements());
+    readSeqElements<T>(is, array, seqs, data.data());
+    return getHandle(createHostDataArray<T>(odims, data.data()));
+#endif
+}
+
+static af_array checkVersionAndRead(const char *filename,
+                                    const unsigned index) {
+    std::ifstream fs;
+    openStream(fs, filename);
+    StreamArray array = checkVersionAndLocate(fs, filename, index);
+
+    af_array out;
+    switch (array.type) {
+        case f32: out = readData<float>(fs, array); break;
+        case c32: out = readData<cfloat>(fs, array); break;
+        case f64: out = readData<double>(fs, array); break;
+        case c64: out = readData<cdouble>(fs, array); break;
+        case b8: out = readData<char>(fs, array); break;
+        case s32: out = readData<int>(fs, array); break;
+        case u32: out = readData<uint>(fs, array); break;
+        case u8: out = readData<uchar>(fs, array); break;
+        case s64: out = readData<intl>(fs, array); break;
+        case u64: out = readData<uintl>(fs, array); break;
+        case s16: out = readData<short>(fs, array); break;
+        case u16: out = readData<ushort>(fs, array); break;
+        default: TYPE_ERROR(1, array.type);
+    }
+    if (!fs) {
+        af_release_array(out);
+        AF_ERROR("File is truncated", AF_ERR_ARG);
     }
     fs.close();
 
-    switch (version) {
-        case 1: return readArrayV1(filename, index);
-        default: AF_ERROR("Invalid version", AF_ERR_ARG);
+    return out;
+}
+
+static af_array checkVersionAndReadSeq(const char *filename,
+                                       const unsigned index,
+                                       const unsigned ndims,
+                                       const af_seq *const index_seqs) {
+    std::ifstream fs;
+    openStream(fs, filename);
+    StreamArray array = checkVersionAndLocate(fs, filename, index);
+
+    vector<af_seq> seqs(4, af_span);
+    for (unsigned i = 0; i < ndims; i++) {
+        if (af::isSpan(index_seqs[i])) { continue; }
+        af_seq s = convert2Canonical(index_seqs[i], array.dims[i]);
+        ARG_ASSERT(4, s.step != 0);
+        ARG_ASSERT(4, s.begin >= 0 && s.begin < array.dims[i]);
+        ARG_ASSERT(4, s.end >= 0 && s.end < array.dims[i]);
+        ARG_ASSERT(4, s.step > 0 ? s.begin <= s.end : s.begin >= s.end);
+        seqs[i] = s;
     }
+
+    af_array out;
+    switch (array.type) {
+        case f32: out = readSeq<float>(fs, array, seqs); break;
+        case c32: out = readSeq<cfloat>(fs, array, seqs); break;
+        case f64: out = readSeq<double>(fs, array, seqs); break;
+        case c64: out = readSeq<cdouble>(fs, array, seqs); break;
+        case b8: out = readSeq<char>(fs, array, seqs); break;
+        case s32: out = readSeq<int>(fs, array, seqs); break;
+        case u32: out = readSeq<uint>(fs, array, seqs); break;
+        case u8: out = readSeq<uchar>(fs, array, seqs); break;
+        case s64: out = readSeq<intl>(fs, array, seqs); break;
+        case u64: out = readSeq<uintl>(fs, array, seqs); break;
+        case s16: out = readSeq<short>(fs, array, seqs); break;
+        case u16: out = readSeq<ushort>(fs, array, seqs); break;
+        default: TYPE_ERROR(1, array.type);
+    }
+    if (!fs) {
+        af_release_array(out);
+        AF_ERROR("File is truncated", AF_ERR_ARG);
+    }
+    fs.close();
+
+    return out;
 }
 
 int checkVersionAndFindIndex(const char *filename, const char *k) {
@@ -319,6 +897,8 @@ int checkVersionAndFindIndex(const char *filename, const char *k) {
                 fs.seekg(offset, std::ios_base::cur);
             }
         }
+    } else if (version == 2) {
+        index = findStreamEntry(fs, readStreamHeader(fs), key);
     } else {
         AF_ERROR("Invalid version", AF_ERR_ARG);
     }
@@ -359,6 +939,29 @@ af_err af_read_array_key(af_array *out, const char *filename, const char *key) {
     return AF_SUCCESS;
 }
 
+af_err af_read_array_key_seq(af_array *out, const char *filename,
+                             const char *key, const unsigned ndims,
+                             const af_seq *const index) {
+    try {
+        AF_CHECK(af_init());
+        ARG_ASSERT(0, out != NULL);
+        ARG_ASSERT(1, filename != NULL);
+        ARG_ASSERT(2, key != NULL);
+        ARG_ASSERT(3, ndims > 0 && ndims <= AF_MAX_DIMS);
+        ARG_ASSERT(4, index != NULL);
+
+        // Find index of key. Then read the elements by index
+        int id = checkVersionAndFindIndex(filename, key);
+
+        if (id == -1) AF_ERROR("Key not found", AF_ERR_INVALID_ARRAY);
+
+        af_array output = checkVersionAndReadSeq(filename, id, ndims, index);
+        std::swap(*out, output);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
 af_err af_read_array_key_check(int *index, const char *filename,
                                const char *key) {
     try {
@@ -374,3 +977,36 @@ af_err af_read_array_key_check(int *index, const char *filename,
     CATCHALL;
     return AF_SUCCESS;
 }
+
+#if defined(AF_CPU)
+af_err afcpu_map_array_key(af_array *out, const char *filename,
+                           const char *key, afcpu_map_mode mode) {
+    try {
+        ARG_ASSERT(0, out != NULL);
+        ARG_ASSERT(1, filename != NULL);
+        ARG_ASSERT(2, key != NULL);
+
+        std::ifstream fs(filename, std::ifstream::in | std::ifstream::binary);
+        if (!fs.is_open()) AF_ERROR("File failed to open", AF_ERR_ARG);
+        if (fs.peek() != 2) {
+            AF_ERROR("Only arrays saved in version 2 files can be mapped",
+                     AF_ERR_ARG);
+        }
+
+        StreamHeader header = readStreamHeader(fs);
+        int index           = findStreamEntry(fs, header, key);
+        if (index == -1) AF_ERROR("Key not found", AF_ERR_INVALID_ARRAY);
+        StreamEntry entry = readStreamEntry(fs, header, index);
+        fs.close();
+        if (entry.codec != STREAM_CODEC_NONE) {
+            AF_ERROR("Compressed arrays cannot be mapped",
+                     AF_ERR_NOT_SUPPORTED);
+        }
+
+        AF_CHECK(afcpu_map_array(out, filename, entry.data_offset, 4,
+                                 entry.dims, (af_dtype)entry.type, mode));
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+#endif
@@ -224,7 +224,8 @@ INSTANTIATE(af_half)
 array::~array() {
     af_array tmp = get();
     // THOU SHALL NOT THROW IN DESTRUCTORS
-    af_release_array(tmp);
+    // Arrays that were moved from have no handle
+    if (tmp) { af_release_array(tmp); }
 }
 
 af::dtype array::type() const {
@@ -399,6 +400,8 @@ array::array(const array &in) : arr(nullptr) {
     AF_THROW(af_retain_array(&arr, in.get()));
 }
 
+array::array(array &&in) noexcept : arr(in.arr) { in.arr = nullptr; }
+
 array::array(const array &input, const dim4 &dims) : arr(nullptr) {
     AF_THROW(af_moddims(&arr, input.get(), AF_MAX_DIMS, dims.get()));
 }
@@ -697,6 +700,15 @@ array &array::operator=(const array &other) {
     this->arr = temp;
     return *this;
 }
+
+array &array::operator=(array &&other) noexcept {
+    if (this == &other) { return *this; }
+    // The handle of other is taken over without retaining it
+    if (this->arr != nullptr) { af_release_array(this->arr); }
+    this->arr = other.arr;
+    other.arr = nullptr;
+    return *this;
+}
 #define ASSIGN_TYPE(TY, OP)                        \
     array &array::operator OP(const TY &value) {   \
         af::dim4 dims = this->dims();              \
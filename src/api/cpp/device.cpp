@@ -146,6 +146,14 @@ void deviceMemInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                                 lock_buffers));
 }
 
+af_memory_stats deviceMemStats() {
+    af_memory_stats stats;
+    AF_THROW(af_device_mem_stats(&stats));
+    return stats;
+}
+
+void resetMemStats() { AF_THROW(af_device_mem_stats_reset()); }
+
 void setMemStepSize(const size_t step_bytes) {
     AF_THROW(af_set_mem_step_size(step_bytes));
 }
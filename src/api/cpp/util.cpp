@@ -32,6 +32,18 @@ int saveArray(const char *key, const array &arr, const char *filename,
     return index;
 }
 
+int saveArray(const char *key, const array &arr, const char *filename,
+              const bool append, const bool compress) {
+    int index = -1;
+    if (compress) {
+        AF_THROW(af_save_array_compressed(&index, key, arr.get(), filename,
+                                          append));
+    } else {
+        AF_THROW(af_save_array(&index, key, arr.get(), filename, append));
+    }
+    return index;
+}
+
 array readArray(const char *filename, const unsigned index) {
     af_array out = 0;
     AF_THROW(af_read_array_index(&out, filename, index));
@@ -44,6 +56,14 @@ array readArray(const char *filename, const char *key) {
     return array(out);
 }
 
+array readArray(const char *filename, const char *key, const seq &s0,
+                const seq &s1, const seq &s2, const seq &s3) {
+    af_array out       = 0;
+    const af_seq idx[] = {s0.s, s1.s, s2.s, s3.s};
+    AF_THROW(af_read_array_key_seq(&out, filename, key, 4, idx));
+    return array(out);
+}
+
 int readArrayCheck(const char *filename, const char *key) {
     int out = -1;
     AF_THROW(af_read_array_key_check(&out, filename, key));
@@ -107,6 +107,12 @@ af_err af_print_mem_info(const char *msg, const int device_id) {
     return CALL(msg, device_id);
 }
 
+af_err af_device_mem_stats(af_memory_stats *stats) { return CALL(stats); }
+
+af_err af_device_mem_stats_reset() { return CALL_NO_PARAMS(); }
+
+af_err af_device_mem_stats_report(char **output) { return CALL(output); }
+
 af_err af_device_gc() { return CALL_NO_PARAMS(); }
 
 af_err af_set_mem_step_size(const size_t step_bytes) {
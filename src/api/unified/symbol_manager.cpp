@@ -19,6 +19,7 @@
 #include <functional>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #ifdef OS_WIN
 #include <Windows.h>
@@ -160,6 +161,8 @@ LibHandle openDynLibrary(const af_backend bknd_idx) {
 
 void closeDynLibrary(LibHandle handle) { unloadLibrary(handle); }
 
+std::atomic<size_t> Symbol::next_id(0);
+
 AFSymbolManager& AFSymbolManager::getInstance() {
     thread_local AFSymbolManager symbolManager;
     return symbolManager;
@@ -169,6 +172,7 @@ spdlog::logger* AFSymbolManager::getLogger() { return logger.get(); }
 
 AFSymbolManager::AFSymbolManager()
     : activeHandle(nullptr)
+    , activeIndex(0)
     , defaultHandle(nullptr)
     , numBackends(0)
     , backendsAvailable(0)
@@ -184,6 +188,7 @@ AFSymbolManager::AFSymbolManager()
         bkndHandles[backend] = openDynLibrary(order[i]);
         if (bkndHandles[backend]) {
             activeHandle  = bkndHandles[backend];
+            activeIndex   = backend;
             activeBackend = (af_backend)order[i];
             numBackends++;
             backendsAvailable += order[i];
@@ -214,6 +219,7 @@ af_err AFSymbolManager::setBackend(af::Backend bknd) {
     if (bknd == AF_BACKEND_DEFAULT) {
         if (defaultHandle) {
             activeHandle  = defaultHandle;
+            activeIndex   = backend_index(defaultBackend);
             activeBackend = defaultBackend;
             return AF_SUCCESS;
         } else {
@@ -223,6 +229,7 @@ af_err AFSymbolManager::setBackend(af::Backend bknd) {
     int idx = bknd >> 1;  // Convert 1, 2, 4 -> 0, 1, 2
     if (bkndHandles[idx]) {
         activeHandle  = bkndHandles[idx];
+        activeIndex   = idx;
         activeBackend = bknd;
         return AF_SUCCESS;
     } else {
@@ -230,6 +237,18 @@ af_err AFSymbolManager::setBackend(af::Backend bknd) {
     }
 }
 
+void* AFSymbolManager::loadSymbol(const Symbol& symbol) {
+    std::vector<void*>& table = funcTables[activeIndex];
+    if (table.size() <= symbol.id()) { table.resize(symbol.id() + 1); }
+
+    AF_TRACE("Loading: {}", symbol.name());
+    table[symbol.id()] = getFunctionPointer(activeHandle, symbol.name());
+    if (!table[symbol.id()]) {
+        AF_TRACE("Failed to load symbol: {}", symbol.name());
+    }
+    return table[symbol.id()];
+}
+
 bool checkArray(af_backend activeBackend, af_array a) {
     // Convert af_array into int to retrieve the backend info.
     // See ArrayInfo.hpp for more
@@ -241,8 +260,8 @@ bool checkArray(af_backend activeBackend, af_array a) {
     // AF_ERR_ARG instead of AF_ERR_ARR_BKND_MISMATCH
     if (a == 0) return true;
 
-    unified::AFSymbolManager::getInstance().call("af_get_backend_id", &backend,
-                                                 a);
+    static const Symbol symbol("af_get_backend_id");
+    unified::AFSymbolManager::getInstance().call(symbol, &backend, a);
     return backend == activeBackend;
 }
 
@@ -16,9 +16,10 @@
 
 #include <spdlog/spdlog.h>
 #include <array>
+#include <atomic>
 #include <cstdlib>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 namespace unified {
 
@@ -40,6 +41,24 @@ static inline int backend_index(af::Backend be) {
     }
 }
 
+/// A function of the backends called from the unified library
+///
+/// Each call site has its own symbol. Its id indexes the tables of the
+/// functions resolved from the backends, so calls do not look up the name.
+class Symbol {
+   public:
+    explicit Symbol(const char* name) : name_(name), id_(next_id++) {}
+
+    const char* name() const { return name_; }
+    size_t id() const { return id_; }
+
+   private:
+    static std::atomic<size_t> next_id;
+
+    const char* name_;
+    size_t id_;
+};
+
 class AFSymbolManager {
    public:
     static AFSymbolManager& getInstance();
@@ -55,29 +74,22 @@ class AFSymbolManager {
     af::Backend getActiveBackend() { return activeBackend; }
 
     template<typename... CalleeArgs>
-    af_err call(const char* symbolName, CalleeArgs... args) {
+    af_err call(const Symbol& symbol, CalleeArgs... args) {
         typedef af_err (*af_func)(CalleeArgs...);
         if (!activeHandle) { UNIFIED_ERROR_LOAD_LIB(); }
-        thread_local std::array<std::unordered_map<const char*, af_func>,
-                                NUM_BACKENDS>
-            funcHandles;
-
-        int index           = backend_index(getActiveBackend());
-        af_func& funcHandle = funcHandles[index][symbolName];
 
+        const std::vector<void*>& table = funcTables[activeIndex];
+        void* funcHandle                = symbol.id() < table.size()
+                                              ? table[symbol.id()]
+                                              : nullptr;
+        if (!funcHandle) { funcHandle = loadSymbol(symbol); }
         if (!funcHandle) {
-            AF_TRACE("Loading: {}", symbolName);
-            funcHandle =
-                (af_func)common::getFunctionPointer(activeHandle, symbolName);
-        }
-        if (!funcHandle) {
-            AF_TRACE("Failed to load symbol: {}", symbolName);
             std::string str = "Failed to load symbol: ";
-            str += symbolName;
+            str += symbol.name();
             AF_RETURN_ERROR(str.c_str(), AF_ERR_LOAD_SYM);
         }
 
-        return funcHandle(args...);
+        return ((af_func)funcHandle)(args...);
     }
 
     LibHandle getHandle() { return activeHandle; }
@@ -94,9 +106,17 @@ class AFSymbolManager {
     void operator=(AFSymbolManager const&);
 
    private:
+    /// Resolves \p symbol in the active backend and adds it to the table of
+    /// the backend. Returns nullptr if the backend does not have the symbol.
+    void* loadSymbol(const Symbol& symbol);
+
     LibHandle bkndHandles[NUM_BACKENDS];
 
+    /// The functions of each backend indexed by the ids of the symbols
+    std::array<std::vector<void*>, NUM_BACKENDS> funcTables;
+
     LibHandle activeHandle;
+    int activeIndex;
     LibHandle defaultHandle;
     unsigned numBackends;
     int backendsAvailable;
@@ -127,15 +147,27 @@ bool checkArrays(af_backend activeBackend, T a, Args... arg) {
                             AF_ERR_ARR_BKND_MISMATCH);                        \
     } while (0)
 
+// The symbol of the call site. The lambda gives each call site its own
+// static symbol.
+#define UNIFIED_SYMBOL(name)                                 \
+    ([](const char* symbol_name) -> const unified::Symbol& { \
+        static const unified::Symbol symbol(symbol_name);    \
+        return symbol;                                       \
+    }(name))
+
 #if defined(OS_WIN)
-#define CALL(...) \
-    unified::AFSymbolManager::getInstance().call(__FUNCTION__, __VA_ARGS__)
-#define CALL_NO_PARAMS() \
-    unified::AFSymbolManager::getInstance().call(__FUNCTION__)
+#define CALL(...)                                 \
+    unified::AFSymbolManager::getInstance().call( \
+        UNIFIED_SYMBOL(__FUNCTION__), __VA_ARGS__)
+#define CALL_NO_PARAMS()                          \
+    unified::AFSymbolManager::getInstance().call( \
+        UNIFIED_SYMBOL(__FUNCTION__))
 #else
-#define CALL(...) \
-    unified::AFSymbolManager::getInstance().call(__func__, __VA_ARGS__)
-#define CALL_NO_PARAMS() unified::AFSymbolManager::getInstance().call(__func__)
+#define CALL(...)                                 \
+    unified::AFSymbolManager::getInstance().call( \
+        UNIFIED_SYMBOL(__func__), __VA_ARGS__)
+#define CALL_NO_PARAMS() \
+    unified::AFSymbolManager::getInstance().call(UNIFIED_SYMBOL(__func__))
 #endif
 
 #define LOAD_SYMBOL()           \
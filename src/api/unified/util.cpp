@@ -28,6 +28,13 @@ af_err af_save_array(int *index, const char *key, const af_array arr,
     return CALL(index, key, arr, filename, append);
 }
 
+af_err af_save_array_compressed(int *index, const char *key,
+                                const af_array arr, const char *filename,
+                                const bool append) {
+    CHECK_ARRAYS(arr);
+    return CALL(index, key, arr, filename, append);
+}
+
 af_err af_read_array_index(af_array *out, const char *filename,
                            const unsigned index) {
     return CALL(out, filename, index);
@@ -37,6 +44,12 @@ af_err af_read_array_key(af_array *out, const char *filename, const char *key) {
     return CALL(out, filename, key);
 }
 
+af_err af_read_array_key_seq(af_array *out, const char *filename,
+                             const char *key, const unsigned ndims,
+                             const af_seq *const index) {
+    return CALL(out, filename, key, ndims, index);
+}
+
 af_err af_read_array_key_check(int *index, const char *filename,
                                const char *key) {
     return CALL(index, filename, key);
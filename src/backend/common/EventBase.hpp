@@ -62,8 +62,8 @@ class EventBase {
 
     /// \brief This function will block the calling thread until the event has
     ///        completed
-    ErrorType block() const noexcept {
-        return NativeEventPolicy::syncForEvent();
+    ErrorType block() noexcept {
+        return NativeEventPolicy::syncForEvent(&e_);
     }
 
     /// \brief Returns true if the event is a valid event.
@@ -14,10 +14,13 @@
 #include <common/dispatch.hpp>
 #include <common/err_common.hpp>
 #include <common/util.hpp>
+#include <af/device.h>
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <iomanip>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -33,6 +36,18 @@ using lock_guard_t = std::lock_guard<mutex_t>;
 
 constexpr unsigned MAX_BUFFERS = 1000;
 constexpr size_t ONE_GB        = 1 << 30;
+constexpr size_t ONE_MB        = 1 << 20;
+
+/// Allocations larger than this are rounded up to a size class
+constexpr size_t SIZE_CLASS_MIN_BYTES = ONE_MB;
+
+/// The default percentage of a request that may be wasted by reusing a larger
+/// free buffer
+constexpr unsigned MAX_FRAGMENTATION = 25;
+
+/// Half of the free buffers of a thread cache are returned to the shared pool
+/// when they exceed this size
+constexpr size_t THREAD_CACHE_MAX_BYTES = 16 * ONE_MB;
 
 struct MemoryEventPair {
     void *ptr;
@@ -54,21 +69,127 @@ class MemoryManager {
     using locked_t    = typename std::unordered_map<void *, locked_info>;
     using locked_iter = typename locked_t::iterator;
 
-    using free_t    = std::unordered_map<size_t, std::vector<MemoryEventPair>>;
+    // Ordered by size so that the smallest free buffer that fits a request
+    // can be found
+    using free_t    = std::map<size_t, std::vector<MemoryEventPair>>;
     using free_iter = typename free_t::iterator;
 
     using uptr_t = std::unique_ptr<void, std::function<void(void *)>>;
 
+    /// Buffers of up to SIZE_CLASS_MIN_BYTES used by a single thread
+    ///
+    /// The manager buffers allocated by a thread are kept in its cache instead
+    /// of locked_map and go back to the cache when they are freed by the same
+    /// thread. Neither operation takes memory_mutex. The cache_mutex is only
+    /// taken by other threads to collect garbage, to read the buffer info or
+    /// when they free a buffer of this thread, so it is not contended.
+    struct thread_cache {
+        MemoryManager *manager;
+        int device;
+        mutex_t cache_mutex;
+        std::unordered_map<void *, size_t> in_use;
+        free_t free_map;
+        size_t in_use_bytes;
+        size_t free_bytes;
+        size_t hits;
+
+        thread_cache(MemoryManager *manager_, int device_)
+            : manager(manager_)
+            , device(device_)
+            , in_use_bytes(0)
+            , free_bytes(0)
+            , hits(0) {}
+    };
+
+    using cached_t    = std::unordered_map<void *, thread_cache *>;
+    using cached_iter = typename cached_t::iterator;
+
+    /// The request counters of one thread
+    ///
+    /// Only the thread updates them, so allocations on different threads do
+    /// not contend for the counters. They are added up when they are read.
+    struct thread_stats {
+        std::atomic<size_t> alloc_count;
+        std::atomic<size_t> alloc_bytes;
+        std::atomic<size_t> class_count[AF_MEM_STATS_SIZE_CLASSES];
+        std::atomic<size_t> class_bytes[AF_MEM_STATS_SIZE_CLASSES];
+        std::atomic<size_t> reuse_count;
+        std::atomic<size_t> native_count;
+
+        // The number of requests and bytes of each function named by an
+        // AllocationScope. The mutex is only contended while the stats are
+        // read.
+        mutex_t callers_mutex;
+        std::unordered_map<const char *, std::pair<size_t, size_t>> callers;
+
+        thread_stats() { reset(); }
+
+        void reset();
+    };
+
+    /// The statistics returned by memoryStats
+    ///
+    /// The counters are atomic because the thread caches update them without
+    /// memory_mutex.
+    struct memory_stats {
+        std::atomic<size_t> used_bytes;
+        std::atomic<size_t> peak_used_bytes;
+        std::atomic<size_t> peak_total_bytes;
+        std::atomic<size_t> gc_count;
+        std::atomic<long long> gc_nanoseconds;
+
+        // The counters of the threads that allocated buffers
+        mutex_t threads_mutex;
+        std::vector<std::unique_ptr<thread_stats>> threads;
+
+        // Identifies the stats in the thread local lists of the threads
+        const size_t id;
+
+        memory_stats() : used_bytes(0), id(nextStatsId()) { reset(0); }
+
+        /// Returns the counters of the calling thread
+        thread_stats &local();
+
+        /// Clears the counters. The peaks start at the current usage.
+        void reset(size_t total_bytes);
+
+       private:
+        static size_t nextStatsId() {
+            static std::atomic<size_t> next(0);
+            return next++;
+        }
+    };
+
     struct memory_info {
         locked_t locked_map;
         free_t free_map;
 
+        // The thread caches of the device and the buffers they own
+        std::vector<thread_cache *> caches;
+        cached_t cached_map;
+
+        // Buffers created outside the manager, such as mapped files
+        std::unordered_map<void *, size_t> external_map;
+        size_t external_bytes;
+
         size_t lock_bytes;
         size_t lock_buffers;
+        // The bytes of the buffers used from the thread caches. It is atomic
+        // because the caches update it without memory_mutex.
+        std::unique_ptr<std::atomic<size_t>> cached_bytes;
         size_t total_bytes;
         size_t total_buffers;
         size_t max_bytes;
 
+        // Allocation statistics
+        size_t exact_hits;
+        size_t fit_hits;
+        size_t fit_waste_bytes;
+        size_t native_allocs;
+
+        // Statistics since the last reset
+        std::unique_ptr<memory_stats> stats;
+
         memory_info()
             // Calling getMaxMemorySize() here calls the virtual function
             // that returns 0 Call it from outside the constructor.
@@ -76,7 +197,14 @@ class MemoryManager {
             , total_bytes(0)
             , total_buffers(0)
             , lock_bytes(0)
-            , lock_buffers(0) {}
+            , lock_buffers(0)
+            , cached_bytes(new std::atomic<size_t>(0))
+            , external_bytes(0)
+            , exact_hits(0)
+            , fit_hits(0)
+            , fit_waste_bytes(0)
+            , native_allocs(0)
+            , stats(new memory_stats()) {}
 
         memory_info(memory_info &other)  = delete;
         memory_info(memory_info &&other) = default;
@@ -86,6 +214,7 @@ class MemoryManager {
 
     size_t mem_step_size;
     unsigned max_buffers;
+    unsigned max_fragmentation;
     std::vector<memory_info> memory;
     std::shared_ptr<spdlog::logger> logger;
     bool debug_mode;
@@ -96,6 +225,48 @@ class MemoryManager {
     inline size_t getMaxMemorySize(int id);
     void cleanDeviceMemoryManager(int device);
 
+    /// Returns the size of the buffer allocated for a request of \p bytes
+    ///
+    /// Small requests are rounded up to the step size. Large requests are
+    /// rounded up to one of eight size classes between consecutive powers of
+    /// two so that arrays of slightly different sizes share buffers.
+    size_t getAllocSize(size_t bytes);
+
+    /// Returns the caches of the calling thread
+    static std::vector<std::unique_ptr<thread_cache>> &threadCaches();
+
+    /// Returns the cache of the calling thread for \p device or nullptr if
+    /// the thread has not allocated from the device
+    thread_cache *findThreadCache(int device);
+
+    /// Returns the cache of the calling thread for \p device. The cache is
+    /// created if it does not exist.
+    thread_cache *getThreadCache(int device);
+
+    /// Returns the buffers of a thread that exits to the shared pool
+    void releaseThreadCache(thread_cache &cache);
+
+    /// Returns the largest free buffers of \p cache to the shared pool
+    void trimThreadCache(thread_cache &cache);
+
+    /// Frees \p ptr into the cache of the calling thread. Returns false if the
+    /// buffer was not allocated from that cache.
+    bool unlockCached(void *ptr, detail::Event &e, bool user_unlock);
+
+    /// Moves a buffer of a thread cache to locked_map. memory_mutex must be
+    /// held by the caller.
+    locked_iter detachCached(memory_info &current, cached_iter iter);
+
+    /// Returns the entry of \p ptr in the locked_map of \p current. A buffer
+    /// of a thread cache is moved to locked_map first. memory_mutex must be
+    /// held by the caller.
+    locked_iter findLocked(memory_info &current, void *ptr);
+
+    /// Records a request of \p bytes that is served by a buffer of
+    /// \p buffer_bytes
+    void recordAlloc(memory_info &current, size_t bytes, size_t buffer_bytes,
+                     bool reused);
+
    public:
     MemoryManager(int num_devices, unsigned max_buffers, bool debug);
 
@@ -115,8 +286,11 @@ class MemoryManager {
     ///
     /// This funciton will return a memory location of at least \p size
     /// bytes. If there is already a free buffer available, it will use
-    /// that buffer. Otherwise, it will allocate a new buffer using the
-    /// nativeAlloc function.
+    /// that buffer. Large requests may use the smallest free buffer that
+    /// does not waste more than AF_MEM_MAX_FRAGMENTATION percent of the
+    /// request. Otherwise, it will allocate a new buffer using the
+    /// nativeAlloc function. Small buffers are first looked up in the cache
+    /// of the calling thread.
     MemoryEventPair alloc(const size_t size, bool user_lock);
 
     /// returns the size of the buffer at the pointer allocated by the memory
@@ -134,9 +308,27 @@ class MemoryManager {
     void printInfo(const char *msg, const int device);
     void bufferInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                     size_t *lock_bytes, size_t *lock_buffers);
+
+    /// Returns the statistics of the active device since the last reset
+    void memoryStats(af_memory_stats *stats);
+
+    /// Clears the counters and the peaks of the active device
+    void resetMemoryStats();
+
+    /// Returns a table of the statistics of the active device and of the
+    /// requests of each function named by an AllocationScope
+    std::string memoryStatsReport();
     void userLock(const void *ptr);
     void userUnlock(const void *ptr);
     bool isUserLocked(const void *ptr);
+
+    /// Records \p bytes at \p ptr that are used by an array but were not
+    /// allocated by the manager. They are reported as allocated and locked
+    /// by bufferInfo but do not count towards the memory limit.
+    void addExternalBuffer(void *ptr, size_t bytes);
+
+    /// Removes a buffer added with addExternalBuffer before it is released
+    void removeExternalBuffer(void *ptr);
     size_t getMemStepSize();
     size_t getMaxBytes();
     unsigned getMaxBuffers();
@@ -9,7 +9,10 @@
 
 #include <common/Logger.hpp>
 #include <common/MemoryManager.hpp>
+#include <common/allocation_scope.hpp>
 
+#include <chrono>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -65,21 +68,125 @@ void MemoryManager<T>::cleanDeviceMemoryManager(int device) {
             current.total_buffers -= num_ptrs;
         }
         current.free_map.clear();
+
+        // The free buffers of the threads are also released
+        for (thread_cache *cache : current.caches) {
+            lock_guard_t cache_lock(cache->cache_mutex);
+            for (auto &kv : cache->free_map) {
+                for (auto &p : kv.second) {
+                    current.cached_map.erase(p.ptr);
+                    free_ptrs.emplace_back(
+                        MemoryEventPair{p.ptr, std::move(p.e)});
+                }
+                current.total_bytes -= kv.second.size() * kv.first;
+                bytes_freed += kv.second.size() * kv.first;
+                current.total_buffers -= kv.second.size();
+            }
+            cache->free_map.clear();
+            cache->free_bytes = 0;
+        }
     }
 
     AF_TRACE("GC: Clearing {} buffers {}", free_ptrs.size(),
              bytesToString(bytes_freed));
-    // Free memory outside of the lock
+    // Free memory outside of the lock. The last use of a buffer may still be
+    // pending on another queue, so its event is waited for first.
     for (auto &ptr : free_ptrs) {
+        if (ptr.e) { ptr.e.block(); }
         this->nativeFree(ptr.ptr);
     }
 }
 
+/// Returns the size class of a request of \p bytes in af_memory_stats
+inline int memorySizeClass(size_t bytes) {
+    int size_class = 0;
+    for (size_t limit = 1024;
+         bytes > limit && size_class < AF_MEM_STATS_SIZE_CLASSES - 1;
+         limit *= 2) {
+        size_class++;
+    }
+    return size_class;
+}
+
+/// Raises \p peak to \p value if it is larger
+inline void updatePeak(std::atomic<size_t> &peak, size_t value) {
+    size_t current = peak.load();
+    while (value > current && !peak.compare_exchange_weak(current, value)) {}
+}
+
+template<typename T>
+void MemoryManager<T>::thread_stats::reset() {
+    alloc_count = 0;
+    alloc_bytes = 0;
+    for (int i = 0; i < AF_MEM_STATS_SIZE_CLASSES; i++) {
+        class_count[i] = 0;
+        class_bytes[i] = 0;
+    }
+    reuse_count  = 0;
+    native_count = 0;
+
+    lock_guard_t lock(callers_mutex);
+    callers.clear();
+}
+
+template<typename T>
+typename MemoryManager<T>::thread_stats &
+MemoryManager<T>::memory_stats::local() {
+    // The counters of the calling thread in each memory_stats it used. The
+    // counters are owned by the memory_stats so that they outlive the thread.
+    thread_local vector<std::pair<size_t, thread_stats *>> owned;
+    for (auto &entry : owned) {
+        if (entry.first == id) { return *entry.second; }
+    }
+
+    lock_guard_t lock(threads_mutex);
+    threads.emplace_back(new thread_stats());
+    owned.emplace_back(id, threads.back().get());
+    return *threads.back();
+}
+
+template<typename T>
+void MemoryManager<T>::memory_stats::reset(size_t total_bytes) {
+    peak_used_bytes  = used_bytes.load();
+    peak_total_bytes = total_bytes;
+    gc_count         = 0;
+    gc_nanoseconds   = 0;
+
+    lock_guard_t lock(threads_mutex);
+    for (auto &thread : threads) { thread->reset(); }
+}
+
+template<typename T>
+void MemoryManager<T>::recordAlloc(memory_info &current, size_t bytes,
+                                   size_t buffer_bytes, bool reused) {
+    memory_stats &stats = *current.stats;
+    updatePeak(stats.peak_used_bytes, stats.used_bytes += buffer_bytes);
+
+    thread_stats &local = stats.local();
+    local.alloc_count++;
+    local.alloc_bytes += bytes;
+
+    const int size_class = memorySizeClass(bytes);
+    local.class_count[size_class]++;
+    local.class_bytes[size_class] += bytes;
+    if (reused) {
+        local.reuse_count++;
+    } else {
+        local.native_count++;
+    }
+
+    lock_guard_t lock(local.callers_mutex);
+    auto &caller = local.callers[allocationCaller()];
+    caller.first++;
+    caller.second += bytes;
+}
+
 template<typename T>
 MemoryManager<T>::MemoryManager(int num_devices, unsigned max_buffers,
                                 bool debug)
     : mem_step_size(1024)
     , max_buffers(max_buffers)
+    , max_fragmentation(MAX_FRAGMENTATION)
     , memory(num_devices)
     , logger(loggerFactory("mem"))
     , debug_mode(debug) {
@@ -93,6 +200,179 @@ MemoryManager<T>::MemoryManager(int num_devices, unsigned max_buffers,
     // Max Buffer count
     env_var = getEnvVar("AF_MAX_BUFFERS");
     if (!env_var.empty()) this->max_buffers = max(1, stoi(env_var));
+
+    // Percentage of a request that may be wasted by reusing a larger buffer
+    env_var = getEnvVar("AF_MEM_MAX_FRAGMENTATION");
+    if (!env_var.empty()) this->max_fragmentation = max(0, stoi(env_var));
+}
+
+template<typename T>
+size_t MemoryManager<T>::getAllocSize(size_t bytes) {
+    if (this->debug_mode) return bytes;
+
+    size_t step = mem_step_size;
+    if (bytes > SIZE_CLASS_MIN_BYTES) {
+        // Use 1/8th of the largest power of two below the request as the
+        // step. At most 12.5% of the buffer is unused.
+        size_t pow2 = SIZE_CLASS_MIN_BYTES;
+        while (pow2 <= bytes / 2) pow2 *= 2;
+        step = max(step, pow2 / 8);
+    }
+    return divup(bytes, step) * step;
+}
+
+template<typename T>
+std::vector<std::unique_ptr<typename MemoryManager<T>::thread_cache>>
+    &MemoryManager<T>::threadCaches() {
+    // The caches are returned to the shared pool when the thread exits
+    struct cache_list {
+        std::vector<std::unique_ptr<thread_cache>> caches;
+        ~cache_list() {
+            for (auto &cache : caches) {
+                cache->manager->releaseThreadCache(*cache);
+            }
+        }
+    };
+    thread_local cache_list list;
+    return list.caches;
+}
+
+template<typename T>
+typename MemoryManager<T>::thread_cache *MemoryManager<T>::findThreadCache(
+    int device) {
+    for (auto &cache : threadCaches()) {
+        if (cache->manager == this && cache->device == device) {
+            return cache.get();
+        }
+    }
+    return nullptr;
+}
+
+template<typename T>
+typename MemoryManager<T>::thread_cache *MemoryManager<T>::getThreadCache(
+    int device) {
+    if (thread_cache *cache = this->findThreadCache(device)) { return cache; }
+
+    auto &caches = threadCaches();
+    caches.emplace_back(new thread_cache(this, device));
+    thread_cache *cache = caches.back().get();
+    lock_guard_t lock(this->memory_mutex);
+    memory[device].caches.push_back(cache);
+    return cache;
+}
+
+template<typename T>
+void MemoryManager<T>::releaseThreadCache(thread_cache &cache) {
+    lock_guard_t lock(this->memory_mutex);
+    lock_guard_t cache_lock(cache.cache_mutex);
+    memory_info &current = memory[cache.device];
+
+    // Buffers that are still used are managed by locked_map from now on
+    for (auto &kv : cache.in_use) {
+        current.cached_map.erase(kv.first);
+        current.locked_map[kv.first] = locked_info{true, false, kv.second};
+        *current.cached_bytes -= kv.second;
+        current.lock_bytes += kv.second;
+        current.lock_buffers++;
+    }
+    for (auto &kv : cache.free_map) {
+        for (auto &p : kv.second) {
+            current.cached_map.erase(p.ptr);
+            current.free_map[kv.first].emplace_back(std::move(p));
+        }
+    }
+    cache.in_use.clear();
+    cache.free_map.clear();
+
+    auto &caches = current.caches;
+    caches.erase(std::remove(caches.begin(), caches.end(), &cache),
+                 caches.end());
+}
+
+template<typename T>
+void MemoryManager<T>::trimThreadCache(thread_cache &cache) {
+    lock_guard_t lock(this->memory_mutex);
+    lock_guard_t cache_lock(cache.cache_mutex);
+    memory_info &current = memory[cache.device];
+
+    // The largest buffers are the most expensive to keep in a single thread
+    while (cache.free_bytes > THREAD_CACHE_MAX_BYTES / 2) {
+        auto iter = std::prev(cache.free_map.end());
+        for (auto &p : iter->second) {
+            current.cached_map.erase(p.ptr);
+            current.free_map[iter->first].emplace_back(std::move(p));
+        }
+        cache.free_bytes -= iter->second.size() * iter->first;
+        cache.free_map.erase(iter);
+    }
+}
+
+template<typename T>
+bool MemoryManager<T>::unlockCached(void *ptr, detail::Event &e,
+                                    bool user_unlock) {
+    // Threads that only free buffers, such as the queue workers, do not need
+    // a cache
+    thread_cache *found = this->findThreadCache(this->getActiveDeviceId());
+    if (!found) return false;
+
+    thread_cache &cache = *found;
+    {
+        lock_guard_t cache_lock(cache.cache_mutex);
+        auto iter = cache.in_use.find(ptr);
+        if (iter == cache.in_use.end()) return false;
+
+        // Cached buffers are never locked by the user
+        if (user_unlock) return true;
+
+        size_t bytes = iter->second;
+        cache.in_use.erase(iter);
+        cache.in_use_bytes -= bytes;
+        *this->memory[cache.device].cached_bytes -= bytes;
+        this->memory[cache.device].stats->used_bytes -= bytes;
+        cache.free_map[bytes].emplace_back(MemoryEventPair{ptr, std::move(e)});
+        cache.free_bytes += bytes;
+        if (cache.free_bytes <= THREAD_CACHE_MAX_BYTES) return true;
+    }
+    this->trimThreadCache(cache);
+    return true;
+}
+
+template<typename T>
+typename MemoryManager<T>::locked_iter MemoryManager<T>::detachCached(
+    memory_info &current, cached_iter iter) {
+    void *ptr           = iter->first;
+    thread_cache &owner = *iter->second;
+
+    lock_guard_t cache_lock(owner.cache_mutex);
+    auto used = owner.in_use.find(ptr);
+    if (used == owner.in_use.end()) return current.locked_map.end();
+
+    current.cached_map.erase(iter);
+    size_t bytes = used->second;
+    owner.in_use.erase(used);
+    owner.in_use_bytes -= bytes;
+    *current.cached_bytes -= bytes;
+
+    current.lock_bytes += bytes;
+    current.lock_buffers++;
+    return current.locked_map
+        .emplace(ptr, locked_info{true, false, bytes})
+        .first;
+}
+
+template<typename T>
+typename MemoryManager<T>::locked_iter MemoryManager<T>::findLocked(
+    memory_info &current, void *ptr) {
+    locked_iter iter = current.locked_map.find(ptr);
+
+    // Buffer of another thread's cache. It is returned to the shared pool.
+    if (iter == current.locked_map.end()) {
+        cached_iter cached = current.cached_map.find(ptr);
+        if (cached != current.cached_map.end()) {
+            iter = this->detachCached(current, cached);
+        }
+    }
+    return iter;
 }
 
 template<typename T>
@@ -133,14 +413,51 @@ void MemoryManager<T>::setMaxMemorySize() {
 template<typename T>
 MemoryEventPair MemoryManager<T>::alloc(const size_t bytes, bool user_lock) {
     MemoryEventPair ptr = {nullptr, detail::Event()};
-    size_t alloc_bytes = this->debug_mode
-                             ? bytes
-                             : (divup(bytes, mem_step_size) * mem_step_size);
+    size_t alloc_bytes  = this->getAllocSize(bytes);
 
     if (bytes > 0) {
         memory_info &current = this->getCurrentMemoryInfo();
         locked_info info     = {!user_lock, user_lock, alloc_bytes};
 
+        // Small buffers of the manager are reused by the same thread without
+        // taking memory_mutex
+        thread_cache *cache = nullptr;
+        if (!this->debug_mode && !user_lock &&
+            alloc_bytes <= SIZE_CLASS_MIN_BYTES) {
+            cache = this->getThreadCache(this->getActiveDeviceId());
+            lock_guard_t cache_lock(cache->cache_mutex);
+            free_iter iter = cache->free_map.find(alloc_bytes);
+            if (iter != cache->free_map.end()) {
+                ptr = std::move(iter->second.back());
+                iter->second.pop_back();
+                if (iter->second.empty()) cache->free_map.erase(iter);
+
+                cache->free_bytes -= alloc_bytes;
+                cache->in_use[ptr.ptr] = alloc_bytes;
+                cache->in_use_bytes += alloc_bytes;
+                *current.cached_bytes += alloc_bytes;
+                cache->hits++;
+                this->recordAlloc(current, bytes, alloc_bytes, true);
+                return ptr;
+            }
+        }
+
+        // Adds a buffer to the thread cache or locked_map. memory_mutex must
+        // be held.
+        auto lockBuffer = [&](void *buffer) {
+            if (cache) {
+                lock_guard_t cache_lock(cache->cache_mutex);
+                cache->in_use[buffer] = info.bytes;
+                cache->in_use_bytes += info.bytes;
+                *current.cached_bytes += info.bytes;
+                current.cached_map[buffer] = cache;
+            } else {
+                current.locked_map[buffer] = info;
+                current.lock_bytes += info.bytes;
+                current.lock_buffers++;
+            }
+        };
+
         // There is no memory cache in debug mode
         if (!this->debug_mode) {
             // FIXME: Add better checks for garbage collection
@@ -148,14 +465,30 @@ MemoryEventPair MemoryManager<T>::alloc(const size_t bytes, bool user_lock) {
             if (this->checkMemoryLimit()) { this->garbageCollect(); }
 
             lock_guard_t lock(this->memory_mutex);
-            free_iter iter = current.free_map.find(alloc_bytes);
-
-            if (iter != current.free_map.end() && !iter->second.empty()) {
-                ptr = std::move(iter->second.back());
-                iter->second.pop_back();
-                current.locked_map[ptr.ptr] = info;
-                current.lock_bytes += alloc_bytes;
-                current.lock_buffers++;
+            // Small requests only reuse buffers of the same size. Large
+            // requests take the smallest free buffer that is large enough if
+            // it does not waste too much memory.
+            free_iter iter = alloc_bytes > SIZE_CLASS_MIN_BYTES
+                                 ? current.free_map.lower_bound(alloc_bytes)
+                                 : current.free_map.find(alloc_bytes);
+
+            if (iter != current.free_map.end()) {
+                size_t waste = iter->first - alloc_bytes;
+                if (waste * 100 <= alloc_bytes * this->max_fragmentation) {
+                    ptr = std::move(iter->second.back());
+                    iter->second.pop_back();
+                    info.bytes = iter->first;
+                    if (iter->second.empty()) current.free_map.erase(iter);
+
+                    lockBuffer(ptr.ptr);
+                    this->recordAlloc(current, bytes, info.bytes, true);
+                    if (waste == 0) {
+                        current.exact_hits++;
+                    } else {
+                        current.fit_hits++;
+                        current.fit_waste_bytes += waste;
+                    }
+                }
             }
         }
 
@@ -175,9 +508,10 @@ MemoryEventPair MemoryManager<T>::alloc(const size_t bytes, bool user_lock) {
             // Increment these two only when it succeeds to come here.
             current.total_bytes += alloc_bytes;
             current.total_buffers += 1;
-            current.locked_map[ptr.ptr] = info;
-            current.lock_bytes += alloc_bytes;
-            current.lock_buffers++;
+            current.native_allocs++;
+            lockBuffer(ptr.ptr);
+            updatePeak(current.stats->peak_total_bytes, current.total_bytes);
+            this->recordAlloc(current, bytes, alloc_bytes, false);
         }
     }
     return ptr;
@@ -187,9 +521,18 @@ template<typename T>
 size_t MemoryManager<T>::allocated(void *ptr) {
     if (!ptr) return 0;
     memory_info &current = this->getCurrentMemoryInfo();
-    locked_iter iter     = current.locked_map.find((void *)ptr);
-    if (iter == current.locked_map.end()) return 0;
-    return (iter->second).bytes;
+    lock_guard_t lock(this->memory_mutex);
+    locked_iter iter = current.locked_map.find((void *)ptr);
+    if (iter != current.locked_map.end()) return (iter->second).bytes;
+
+    auto external = current.external_map.find(ptr);
+    if (external != current.external_map.end()) return external->second;
+
+    cached_iter cached = current.cached_map.find(ptr);
+    if (cached == current.cached_map.end()) return 0;
+    lock_guard_t cache_lock(cached->second->cache_mutex);
+    auto used = cached->second->in_use.find(ptr);
+    return used == cached->second->in_use.end() ? 0 : used->second;
 }
 
 template<typename T>
@@ -197,13 +540,25 @@ void MemoryManager<T>::unlock(void *ptr, detail::Event &&e, bool user_unlock) {
     // Shortcut for empty arrays
     if (!ptr) return;
 
-    // Frees the pointer outside the lock.
-    uptr_t freed_ptr(nullptr, [this](void *p) { this->nativeFree(p); });
+    if (!this->debug_mode && this->unlockCached(ptr, e, user_unlock)) return;
+
+    // Frees the pointer outside the lock after the functions that use it
+    uptr_t freed_ptr(nullptr, [this, &e](void *p) {
+        if (e) { e.block(); }
+        this->nativeFree(p);
+    });
     {
         lock_guard_t lock(this->memory_mutex);
-        memory_info &current = this->getCurrentMemoryInfo();
 
-        locked_iter iter = current.locked_map.find((void *)ptr);
+        // The buffer may have been allocated while another device was active
+        memory_info *owner = &this->getCurrentMemoryInfo();
+        locked_iter iter   = this->findLocked(*owner, ptr);
+        for (size_t n = 0;
+             iter == owner->locked_map.end() && n < memory.size(); n++) {
+            owner = &memory[n];
+            iter  = this->findLocked(*owner, ptr);
+        }
+        memory_info &current = *owner;
 
         // Pointer not found in locked map
         if (iter == current.locked_map.end()) {
@@ -226,6 +581,7 @@ void MemoryManager<T>::unlock(void *ptr, detail::Event &&e, bool user_unlock) {
         size_t bytes = iter->second.bytes;
         current.lock_bytes -= iter->second.bytes;
         current.lock_buffers--;
+        current.stats->used_bytes -= bytes;
 
         if (this->debug_mode) {
             // Just free memory in debug mode
@@ -243,7 +599,18 @@ void MemoryManager<T>::unlock(void *ptr, detail::Event &&e, bool user_unlock) {
 
 template<typename T>
 void MemoryManager<T>::garbageCollect() {
-    cleanDeviceMemoryManager(this->getActiveDeviceId());
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+    using std::chrono::steady_clock;
+
+    const int device                     = this->getActiveDeviceId();
+    const steady_clock::time_point start = steady_clock::now();
+    cleanDeviceMemoryManager(device);
+
+    memory_stats &stats = *memory[device].stats;
+    stats.gc_count++;
+    stats.gc_nanoseconds +=
+        duration_cast<nanoseconds>(steady_clock::now() - start).count();
 }
 
 template<typename T>
@@ -256,44 +623,55 @@ void MemoryManager<T>::printInfo(const char *msg, const int device) {
         "|     POINTER      |    SIZE    |  AF LOCK  | USER LOCK |\n"
         "---------------------------------------------------------\n");
 
-    lock_guard_t lock(this->memory_mutex);
-    for (auto &kv : current.locked_map) {
-        const char *status_mngr = "Yes";
-        const char *status_user = "Unknown";
-        if (kv.second.user_lock)
-            status_user = "Yes";
-        else
-            status_user = " No";
-
+    auto printBuffer = [](const void *ptr, size_t bytes,
+                          const char *status_mngr, const char *status_user) {
         const char *unit = "KB";
-        double size      = (double)(kv.second.bytes) / 1024;
+        double size      = (double)(bytes) / 1024;
         if (size >= 1024) {
             size = size / 1024;
             unit = "MB";
         }
 
-        printf("|  %14p  |  %6.f %s | %9s | %9s |\n", kv.first, size, unit,
+        printf("|  %14p  |  %6.f %s | %9s | %9s |\n", ptr, size, unit,
                status_mngr, status_user);
+    };
+
+    lock_guard_t lock(this->memory_mutex);
+    for (auto &kv : current.locked_map) {
+        printBuffer(kv.first, kv.second.bytes, "Yes",
+                    kv.second.user_lock ? "Yes" : " No");
     }
 
     for (auto &kv : current.free_map) {
-        const char *status_mngr = "No";
-        const char *status_user = "No";
-
-        const char *unit = "KB";
-        double size      = (double)(kv.first) / 1024;
-        if (size >= 1024) {
-            size = size / 1024;
-            unit = "MB";
+        for (auto &ptr : kv.second) {
+            printBuffer(ptr.ptr, kv.first, "No", "No");
         }
+    }
 
-        for (auto &ptr : kv.second) {
-            printf("|  %14p  |  %6.f %s | %9s | %9s |\n", ptr.ptr, size, unit,
-                   status_mngr, status_user);
+    size_t cache_hits = 0;
+    for (thread_cache *cache : current.caches) {
+        lock_guard_t cache_lock(cache->cache_mutex);
+        for (auto &kv : cache->in_use) {
+            printBuffer(kv.first, kv.second, "Yes", " No");
+        }
+        for (auto &kv : cache->free_map) {
+            for (auto &ptr : kv.second) {
+                printBuffer(ptr.ptr, kv.first, "No", "No");
+            }
         }
+        cache_hits += cache->hits;
     }
 
     printf("---------------------------------------------------------\n");
+    printf(
+        "Reused buffers: %zu exact, %zu larger (%s unused). New buffers: "
+        "%zu\n",
+        current.exact_hits + cache_hits, current.fit_hits,
+        bytesToString(current.fit_waste_bytes).c_str(), current.native_allocs);
+    if (!current.external_map.empty()) {
+        printf("External buffers: %zu (%s)\n", current.external_map.size(),
+               bytesToString(current.external_bytes).c_str());
+    }
 }
 
 template<typename T>
@@ -301,10 +679,130 @@ void MemoryManager<T>::bufferInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                                   size_t *lock_bytes, size_t *lock_buffers) {
     const memory_info &current = this->getCurrentMemoryInfo();
     lock_guard_t lock(this->memory_mutex);
-    if (alloc_bytes) *alloc_bytes = current.total_bytes;
-    if (alloc_buffers) *alloc_buffers = current.total_buffers;
-    if (lock_bytes) *lock_bytes = current.lock_bytes;
-    if (lock_buffers) *lock_buffers = current.lock_buffers;
+
+    // The buffers used from the thread caches are not in locked_map
+    size_t cached_bytes   = 0;
+    size_t cached_buffers = 0;
+    for (thread_cache *cache : current.caches) {
+        lock_guard_t cache_lock(cache->cache_mutex);
+        cached_bytes += cache->in_use_bytes;
+        cached_buffers += cache->in_use.size();
+    }
+
+    // External buffers are in use as long as they are known to the manager
+    const size_t external_bytes   = current.external_bytes;
+    const size_t external_buffers = current.external_map.size();
+
+    if (alloc_bytes) *alloc_bytes = current.total_bytes + external_bytes;
+    if (alloc_buffers) {
+        *alloc_buffers = current.total_buffers + external_buffers;
+    }
+    if (lock_bytes) {
+        *lock_bytes = current.lock_bytes + cached_bytes + external_bytes;
+    }
+    if (lock_buffers) {
+        *lock_buffers =
+            current.lock_buffers + cached_buffers + external_buffers;
+    }
+}
+
+template<typename T>
+void MemoryManager<T>::memoryStats(af_memory_stats *out) {
+    memory_stats &stats   = *this->getCurrentMemoryInfo().stats;
+    out->used_bytes       = stats.used_bytes;
+    out->peak_used_bytes  = stats.peak_used_bytes;
+    out->peak_alloc_bytes = stats.peak_total_bytes;
+    out->alloc_count      = 0;
+    out->alloc_bytes      = 0;
+    for (int i = 0; i < AF_MEM_STATS_SIZE_CLASSES; i++) {
+        out->class_count[i] = 0;
+        out->class_bytes[i] = 0;
+    }
+    out->reuse_count  = 0;
+    out->native_count = 0;
+    out->gc_count     = stats.gc_count;
+    out->gc_seconds   = stats.gc_nanoseconds * 1e-9;
+
+    lock_guard_t lock(stats.threads_mutex);
+    for (auto &thread : stats.threads) {
+        out->alloc_count += thread->alloc_count;
+        out->alloc_bytes += thread->alloc_bytes;
+        for (int i = 0; i < AF_MEM_STATS_SIZE_CLASSES; i++) {
+            out->class_count[i] += thread->class_count[i];
+            out->class_bytes[i] += thread->class_bytes[i];
+        }
+        out->reuse_count += thread->reuse_count;
+        out->native_count += thread->native_count;
+    }
+}
+
+template<typename T>
+void MemoryManager<T>::resetMemoryStats() {
+    memory_info &current = this->getCurrentMemoryInfo();
+    size_t total_bytes;
+    {
+        lock_guard_t lock(this->memory_mutex);
+        total_bytes = current.total_bytes;
+    }
+    current.stats->reset(total_bytes);
+}
+
+template<typename T>
+string MemoryManager<T>::memoryStatsReport() {
+    af_memory_stats stats;
+    this->memoryStats(&stats);
+
+    // The names of the same function may be stored at several addresses
+    std::map<string, std::pair<size_t, size_t>> by_name;
+    {
+        memory_stats &current = *this->getCurrentMemoryInfo().stats;
+        lock_guard_t lock(current.threads_mutex);
+        for (auto &thread : current.threads) {
+            lock_guard_t callers_lock(thread->callers_mutex);
+            for (auto &kv : thread->callers) {
+                auto &entry = by_name[kv.first ? kv.first : "(other)"];
+                entry.first += kv.second.first;
+                entry.second += kv.second.second;
+            }
+        }
+    }
+    vector<std::pair<string, std::pair<size_t, size_t>>> callers(
+        by_name.begin(), by_name.end());
+    std::sort(callers.begin(), callers.end(),
+              [](const std::pair<string, std::pair<size_t, size_t>> &a,
+                 const std::pair<string, std::pair<size_t, size_t>> &b) {
+                  return a.second.second > b.second.second;
+              });
+
+    std::ostringstream out;
+    out << "In use: " << bytesToString(stats.used_bytes)
+        << " (peak " << bytesToString(stats.peak_used_bytes) << ")\n"
+        << "Allocated peak: " << bytesToString(stats.peak_alloc_bytes) << "\n"
+        << "Requests: " << stats.alloc_count << " ("
+        << bytesToString(stats.alloc_bytes) << "), reused "
+        << stats.reuse_count << ", new " << stats.native_count << "\n"
+        << "Garbage collections: " << stats.gc_count << " ("
+        << stats.gc_seconds * 1000 << " ms)\n";
+
+    out << "\n" << std::left << std::setw(24) << "Size class" << std::right
+        << std::setw(12) << "Requests" << std::setw(14) << "Bytes" << "\n";
+    for (int i = 0; i < AF_MEM_STATS_SIZE_CLASSES; i++) {
+        if (stats.class_count[i] == 0) continue;
+        const bool last    = i == AF_MEM_STATS_SIZE_CLASSES - 1;
+        const string limit = bytesToString(size_t(1024) << (last ? i - 1 : i));
+        out << std::left << std::setw(24) << (last ? "> " : "<= ") + limit
+            << std::right << std::setw(12) << stats.class_count[i]
+            << std::setw(14) << bytesToString(stats.class_bytes[i]) << "\n";
+    }
+
+    out << "\n" << std::left << std::setw(24) << "Function" << std::right
+        << std::setw(12) << "Requests" << std::setw(14) << "Bytes" << "\n";
+    for (auto &caller : callers) {
+        out << std::left << std::setw(24) << caller.first << std::right
+            << std::setw(12) << caller.second.first << std::setw(14)
+            << bytesToString(caller.second.second) << "\n";
+    }
+    return out.str();
 }
 
 template<typename T>
@@ -314,10 +812,19 @@ void MemoryManager<T>::userLock(const void *ptr) {
     lock_guard_t lock(this->memory_mutex);
 
     locked_iter iter = current.locked_map.find(const_cast<void *>(ptr));
+    if (iter == current.locked_map.end()) {
+        // Buffers locked by the user are managed by locked_map
+        cached_iter cached = current.cached_map.find(const_cast<void *>(ptr));
+        if (cached != current.cached_map.end()) {
+            iter = this->detachCached(current, cached);
+        }
+    }
     if (iter != current.locked_map.end()) {
         iter->second.user_lock = true;
     } else {
-        locked_info info = {false, true, 100};  // This number is not relevant
+        // The buffer was not allocated by the manager and holds no bytes of
+        // the manager
+        locked_info info = {false, true, 0};
 
         current.locked_map[(void *)ptr] = info;
     }
@@ -341,6 +848,28 @@ bool MemoryManager<T>::isUserLocked(const void *ptr) {
     }
 }
 
+template<typename T>
+void MemoryManager<T>::addExternalBuffer(void *ptr, size_t bytes) {
+    memory_info &current = this->getCurrentMemoryInfo();
+    lock_guard_t lock(this->memory_mutex);
+    current.external_map[ptr] = bytes;
+    current.external_bytes += bytes;
+}
+
+template<typename T>
+void MemoryManager<T>::removeExternalBuffer(void *ptr) {
+    memory_info &current = this->getCurrentMemoryInfo();
+    lock_guard_t lock(this->memory_mutex);
+    auto iter = current.external_map.find(ptr);
+    if (iter == current.external_map.end()) return;
+    current.external_bytes -= iter->second;
+    current.external_map.erase(iter);
+
+    // A lock taken with af_lock_array must not outlive the buffer because the
+    // address may be reused by another allocation
+    current.locked_map.erase(ptr);
+}
+
 template<typename T>
 size_t MemoryManager<T>::getMemStepSize() {
     lock_guard_t lock(this->memory_mutex);
@@ -382,7 +911,7 @@ inline void MemoryManager<T>::nativeFree(void *ptr) {
 template<typename T>
 bool MemoryManager<T>::checkMemoryLimit() {
     const memory_info &current = this->getCurrentMemoryInfo();
-    return current.lock_bytes >= current.max_bytes ||
+    return current.lock_bytes + *current.cached_bytes >= current.max_bytes ||
            current.total_buffers >= this->max_buffers;
 }
 }  // namespace common
@@ -0,0 +1,37 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+namespace common {
+
+/// Returns the name of the function the memory manager attributes the
+/// allocations of the calling thread to, or nullptr
+inline const char *&allocationCaller() noexcept {
+    thread_local const char *caller = nullptr;
+    return caller;
+}
+
+/// Attributes the allocations of the calling thread to \p caller while the
+/// object exists
+class AllocationScope {
+    const char *previous_;
+
+   public:
+    explicit AllocationScope(const char *caller) noexcept
+        : previous_(allocationCaller()) {
+        allocationCaller() = caller;
+    }
+    ~AllocationScope() noexcept { allocationCaller() = previous_; }
+
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+};
+
+}  // namespace common
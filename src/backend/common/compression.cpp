@@ -0,0 +1,202 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <common/compression.hpp>
+
+#include <common/err_common.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using std::min;
+using std::vector;
+
+namespace common {
+
+namespace {
+
+// The compressed data is a list of sequences. Each sequence is
+//
+// (uchar  )   Token. The number of literals in the high 4 bits and the length
+//             of the match minus 4 in the low 4 bits.
+// (uchar  )   Extra literal count bytes (if the count is 15 or more)
+// (char   )   Literals (x count)
+// (ushort )   Distance from the match to the current position
+// (uchar  )   Extra match length bytes (if the length is 19 or more)
+//
+// A count of 15 is followed by bytes that are added to it until a byte is
+// less than 255. The last sequence only holds literals.
+
+const size_t MIN_MATCH  = 4;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS     = 14;
+
+uint32_t read32(const unsigned char *ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+uint32_t hashSequence(uint32_t value) {
+    return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void writeLength(vector<char> &out, size_t length) {
+    for (; length >= 255; length -= 255) { out.push_back(char(255)); }
+    out.push_back(static_cast<char>(length));
+}
+
+/// Writes the literals and the match that follows them. A match length of 0
+/// writes the last sequence.
+void writeSequence(vector<char> &out, const unsigned char *literals,
+                   size_t n_literals, size_t offset, size_t match_length) {
+    const size_t extra = match_length ? match_length - MIN_MATCH : 0;
+    out.push_back(static_cast<char>((min<size_t>(n_literals, 15) << 4) |
+                                    min<size_t>(extra, 15)));
+    if (n_literals >= 15) { writeLength(out, n_literals - 15); }
+    out.insert(out.end(), literals, literals + n_literals);
+    if (match_length == 0) { return; }
+
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (extra >= 15) { writeLength(out, extra - 15); }
+}
+
+vector<char> compressBytes(const unsigned char *in, size_t bytes) {
+    vector<char> out;
+    out.reserve(bytes);
+    vector<int> table(size_t(1) << HASH_BITS, -1);
+
+    size_t pos    = 0;
+    size_t anchor = 0;
+    while (pos + MIN_MATCH <= bytes) {
+        const uint32_t value = read32(in + pos);
+        const uint32_t hash  = hashSequence(value);
+        const int candidate  = table[hash];
+        table[hash]          = static_cast<int>(pos);
+
+        if (candidate >= 0 && pos - candidate <= MAX_OFFSET &&
+            read32(in + candidate) == value) {
+            size_t length = MIN_MATCH;
+            while (pos + length < bytes &&
+                   in[candidate + length] == in[pos + length]) {
+                length++;
+            }
+            writeSequence(out, in + anchor, pos - anchor, pos - candidate,
+                          length);
+            pos += length;
+            anchor = pos;
+            if (out.size() >= bytes) { return vector<char>(); }
+        } else {
+            // Skip through data that does not compress faster the longer
+            // no match is found
+            pos += 1 + ((pos - anchor) >> 6);
+        }
+    }
+    writeSequence(out, in + anchor, bytes - anchor, 0, 0);
+    if (out.size() >= bytes) { return vector<char>(); }
+    return out;
+}
+
+void decompressBytes(const unsigned char *in, size_t in_bytes,
+                     unsigned char *out, size_t bytes) {
+    const unsigned char *ip   = in;
+    const unsigned char *iend = in + in_bytes;
+    unsigned char *op         = out;
+    unsigned char *oend       = out + bytes;
+
+    auto readLength = [&](size_t length) {
+        if (length == 15) {
+            unsigned char extra = 255;
+            while (extra == 255) {
+                if (ip == iend) {
+                    AF_ERROR("Invalid compressed data", AF_ERR_ARG);
+                }
+                extra = *ip++;
+                length += extra;
+            }
+        }
+        return length;
+    };
+
+    while (true) {
+        if (ip == iend) { AF_ERROR("Invalid compressed data", AF_ERR_ARG); }
+        const unsigned token = *ip++;
+
+        const size_t n_literals = readLength(token >> 4);
+        if (n_literals > size_t(iend - ip) || n_literals > size_t(oend - op)) {
+            AF_ERROR("Invalid compressed data", AF_ERR_ARG);
+        }
+        memcpy(op, ip, n_literals);
+        ip += n_literals;
+        op += n_literals;
+        if (ip == iend) { break; }
+
+        if (iend - ip < 2) { AF_ERROR("Invalid compressed data", AF_ERR_ARG); }
+        const size_t offset = ip[0] | (size_t(ip[1]) << 8);
+        ip += 2;
+        const size_t length = readLength(token & 15) + MIN_MATCH;
+        if (offset == 0 || offset > size_t(op - out) ||
+            length > size_t(oend - op)) {
+            AF_ERROR("Invalid compressed data", AF_ERR_ARG);
+        }
+        // A match that overlaps the bytes it writes repeats its first offset
+        // bytes. The bytes are copied in pieces that double in length so that
+        // the pieces do not overlap.
+        const unsigned char *match = op - offset;
+        for (size_t copied = 0; copied < length;) {
+            const size_t piece = min(length - copied, copied + offset);
+            memcpy(op + copied, match, piece);
+            copied += piece;
+        }
+        op += length;
+    }
+    if (op != oend) { AF_ERROR("Invalid compressed data", AF_ERR_ARG); }
+}
+
+}  // namespace
+
+vector<char> compressChunk(const char *in, size_t bytes, size_t element_size) {
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(in);
+    if (element_size <= 1) { return compressBytes(data, bytes); }
+
+    // Byte b of element i is moved to b * count + i
+    const size_t count = bytes / element_size;
+    vector<unsigned char> shuffled(bytes);
+    for (size_t b = 0; b < element_size; b++) {
+        unsigned char *group = shuffled.data() + b * count;
+        for (size_t i = 0; i < count; i++) {
+            group[i] = data[i * element_size + b];
+        }
+    }
+    return compressBytes(shuffled.data(), bytes);
+}
+
+void decompressChunk(const char *in, size_t in_bytes, char *out, size_t bytes,
+                     size_t element_size) {
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(in);
+    unsigned char *result     = reinterpret_cast<unsigned char *>(out);
+    if (element_size <= 1) {
+        decompressBytes(data, in_bytes, result, bytes);
+        return;
+    }
+
+    const size_t count = bytes / element_size;
+    vector<unsigned char> shuffled(bytes);
+    decompressBytes(data, in_bytes, shuffled.data(), bytes);
+    for (size_t b = 0; b < element_size; b++) {
+        const unsigned char *group = shuffled.data() + b * count;
+        for (size_t i = 0; i < count; i++) {
+            result[i * element_size + b] = group[i];
+        }
+    }
+}
+
+}  // namespace common
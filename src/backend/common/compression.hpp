@@ -0,0 +1,36 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+/// This file contains the codec used to compress the data of saved arrays
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace common {
+
+/// Compresses \p bytes bytes of elements that are \p element_size bytes long
+///
+/// The bytes of the elements are grouped by their position in the element
+/// before they are compressed with an LZ77 codec. The high bytes of
+/// neighbouring elements are often equal, so the groups compress better
+/// than the elements.
+///
+/// \returns the compressed data, or an empty vector if the data does not
+///          compress
+std::vector<char> compressChunk(const char *in, size_t bytes,
+                                size_t element_size);
+
+/// Decompresses \p in_bytes bytes created by compressChunk into the \p bytes
+/// bytes at \p out. Throws if the data is corrupt.
+void decompressChunk(const char *in, size_t in_bytes, char *out, size_t bytes,
+                     size_t element_size);
+
+}  // namespace common
@@ -25,6 +25,19 @@ inline std::string clipFilePath(std::string path, std::string str) {
 #define UNUSED(expr) \
     do { (void)(expr); } while (0)
 
+/// The name of the function that calls the function whose default argument
+/// uses this macro, or nullptr if the compiler does not provide it
+#if defined(__clang__)
+#if defined(__has_builtin) && __has_builtin(__builtin_FUNCTION)
+#define AF_CALLER_FUNCTION __builtin_FUNCTION()
+#endif
+#elif defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+#define AF_CALLER_FUNCTION __builtin_FUNCTION()
+#endif
+#ifndef AF_CALLER_FUNCTION
+#define AF_CALLER_FUNCTION nullptr
+#endif
+
 #if defined(_WIN32) || defined(_MSC_VER)
 #define __PRETTY_FUNCTION__ __FUNCSIG__
 #if _MSC_VER < 1900
@@ -12,15 +12,20 @@
 
 #include <Param.hpp>
 #include <common/ArrayInfo.hpp>
+#include <common/allocation_scope.hpp>
 #include <common/err_common.hpp>
 #include <common/jit/NodeIterator.hpp>
 #include <common/traits.hpp>
 #include <copy.hpp>
+#include <jit.hpp>
 #include <jit/BufferNode.hpp>
+#include <kernel/copy.hpp>
 #include <jit/Node.hpp>
+#include <jit/NodePool.hpp>
 #include <jit/ScalarNode.hpp>
 #include <memory.hpp>
 #include <platform.hpp>
+#include <profiler.hpp>
 #include <queue.hpp>
 #include <traits.hpp>
 
@@ -33,12 +38,16 @@
 #include <algorithm>  // IWYU pragma: keep
 #include <cstddef>
 #include <cstring>
+#include <functional>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 using af::dim4;
 using common::half;
 using common::NodeIterator;
 using cpu::jit::BufferNode;
+using cpu::jit::JitCost;
 using cpu::jit::Node;
 using cpu::jit::Node_map_t;
 using cpu::jit::Node_ptr;
@@ -50,7 +59,7 @@ namespace cpu {
 
 template<typename T>
 Node_ptr bufferNodePtr() {
-    return Node_ptr(reinterpret_cast<Node *>(new BufferNode<T>()));
+    return jit::makeNode<BufferNode<T>>();
 }
 
 template<typename T>
@@ -126,6 +135,90 @@ Array<T>::Array(const dim4 &dims, const dim4 &strides, dim_t offset_,
     }
 }
 
+template<typename T>
+Array<T>::Array(const dim4 &dims, T *const in_data,
+                std::function<void(T *)> deleter, bool is_owner)
+    : info(getActiveDeviceId(), dims, 0, calcStrides(dims),
+           (af_dtype)dtype_traits<T>::af_type)
+    , data(in_data, std::move(deleter))
+    , data_dims(dims)
+    , node(bufferNodePtr<T>())
+    , ready(true)
+    , owner(is_owner) {}
+
+/// Returns a buffer that the output of the tree can be written to, or nullptr
+///
+/// The buffer of a temporary array that was released before the tree is
+/// evaluated is only held by its node in the tree. It can be reused for the
+/// output if every node on the paths from the root to the buffer is only
+/// held by the tree, the root is only held by the evaluated array, and the
+/// user has not locked the buffer. A node that is also held by another array
+/// or tree is still read after this tree is evaluated.
+template<typename T>
+static shared_ptr<T> findDonorBuffer(const Node_ptr &root, const dim4 &dims) {
+    if (root.use_count() != 1) { return nullptr; }
+
+    struct Refs {
+        long parents           = 0;  // references from the nodes of the tree
+        long exclusive_parents = 0;  // references from exclusive nodes
+        const Node_ptr *ptr    = nullptr;
+    };
+
+    // The number of references to each node from its parents in the tree
+    std::unordered_map<Node *, Refs> refs;
+    vector<Node *> stack(1, root.get());
+    while (!stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+        for (int i = 0; i < Node::kMaxChildren && node->getChild(i); i++) {
+            const Node_ptr &child = node->getChild(i);
+            Refs &entry           = refs[child.get()];
+            if (entry.parents++ == 0) {
+                entry.ptr = &child;
+                stack.push_back(child.get());
+            }
+        }
+    }
+
+    // Visits the exclusive nodes. A node is exclusive once all of its
+    // references come from exclusive parents.
+    const af_dtype type = static_cast<af_dtype>(dtype_traits<T>::af_type);
+    vector<Node *> exclusive(1, root.get());
+    while (!exclusive.empty()) {
+        Node *node = exclusive.back();
+        exclusive.pop_back();
+        if (node->isBuffer() && node->getType() == type) {
+            shared_ptr<T> buffer =
+                static_cast<BufferNode<T> *>(node)->getDonorBuffer(
+                    dims.get());
+            // The user may still read a locked buffer through its pointer
+            if (buffer && !isLocked(buffer.get())) { return buffer; }
+        }
+        for (int i = 0; i < Node::kMaxChildren && node->getChild(i); i++) {
+            Refs &entry = refs[node->getChild(i).get()];
+            if (++entry.exclusive_parents == entry.parents &&
+                entry.ptr->use_count() == entry.parents) {
+                exclusive.push_back(node->getChild(i).get());
+            }
+        }
+    }
+    return nullptr;
+}
+
+/// Describes the trees evaluated by a JIT kernel for the profile
+static std::string describeTrees(const vector<Node_ptr> &roots,
+                                 dim_t elements) {
+    size_t nodes = 0;
+    for (const Node_ptr &root : roots) {
+        NodeIterator<jit::Node> it(root.get());
+        NodeIterator<jit::Node> end_node;
+        nodes += std::distance(it, end_node);
+    }
+    return "nodes " + std::to_string(nodes) + ", outputs " +
+           std::to_string(roots.size()) + ", elements " +
+           std::to_string(elements);
+}
+
 template<typename T>
 void Array<T>::eval() {
     if (isReady()) return;
@@ -134,8 +227,17 @@ void Array<T>::eval() {
 
     this->setId(getActiveDeviceId());
 
-    data = shared_ptr<T>(memAlloc<T>(elements()).release(), memFree<T>);
+    // The buffers of evaluated JIT trees are attributed to "jit"
+    common::AllocationScope scope("jit");
+    data = findDonorBuffer<T>(node, dims());
+    if (!data) {
+        data = shared_ptr<T>(memAlloc<T>(elements()).release(), memFree<T>);
+    }
 
+    if (profiler::enabled()) {
+        profiler::setNextFunction("jit",
+                                  describeTrees({this->node}, elements()));
+    }
     getQueue().enqueue(kernel::evalArray<T>, *this, this->node);
     // Reset shared_ptr
     this->node = bufferNodePtr<T>();
@@ -148,10 +250,38 @@ void Array<T>::eval() const {
     const_cast<Array<T> *>(this)->eval();
 }
 
+template<typename T>
+int Array<T>::useCount() const {
+    if (!data.get()) eval();
+
+    // The buffer node of this array keeps a reference to the buffer after the
+    // array is used in a JIT tree. It only reads the buffer again if another
+    // tree still uses the node.
+    auto count = [this] {
+        long references = data.use_count();
+        if (node->isBuffer() && node.use_count() == 1 &&
+            static_cast<BufferNode<T> *>(node.get())->holds(data)) {
+            references--;
+        }
+        return static_cast<int>(references);
+    };
+
+    // The tasks on the queue hold references to the arrays they use until
+    // they finish. Only the references that remain after them are readers,
+    // so the queue is only waited for when it has unfinished functions.
+    int references = count();
+    queue &q       = getQueue();
+    if (references > 1 && !q.is_worker() && q.busy()) {
+        q.sync();
+        references = count();
+    }
+    return references;
+}
+
 template<typename T>
 T *Array<T>::device() {
     getQueue().sync();
-    if (!isOwner() || getOffset() || data.use_count() > 1) {
+    if (!isOwner() || getOffset() || useCount() > 1) {
         *this = copyArray<T>(*this);
     }
     return this->get();
@@ -164,6 +294,8 @@ void evalMultiple(vector<Array<T> *> array_ptrs) {
     vector<Param<T>> params;
     if (getQueue().is_worker())
         AF_ERROR("Array not evaluated", AF_ERR_INTERNAL);
+    // The buffers of evaluated JIT trees are attributed to "jit"
+    common::AllocationScope scope("jit");
     for (Array<T> *array : array_ptrs) {
         if (array->ready) continue;
 
@@ -177,6 +309,13 @@ void evalMultiple(vector<Array<T> *> array_ptrs) {
     }
 
     if (output_arrays.size() > 0) {
+        if (profiler::enabled()) {
+            dim_t elements = 0;
+            for (Array<T> *array : output_arrays) {
+                elements += array->elements();
+            }
+            profiler::setNextFunction("jit", describeTrees(nodes, elements));
+        }
         getQueue().enqueue(kernel::evalMultiple<T>, params, nodes);
         for (Array<T> *array : output_arrays) {
             array->ready = true;
@@ -186,8 +325,35 @@ void evalMultiple(vector<Array<T> *> array_ptrs) {
     return;
 }
 
+/// The number of input buffers a tree can stream from memory before the
+/// hardware prefetchers stop following them
+static const size_t MAX_JIT_STREAMS = 16;
+
+/// The cost of a shared tree, in element reads, above which the tree is
+/// evaluated once instead of in each tree that uses it. Writing and reading
+/// the values of the tree costs about two reads.
+static const size_t MIN_SHARED_JIT_COST = 4;
+
+/// The number of operations that cost as much as reading an element
+static const size_t JIT_OPS_PER_READ = 4;
+
+/// Returns true if a tree that is already used by another tree computes
+/// enough that evaluating it once is cheaper than computing it again in each
+/// tree
+static bool isWorthSharing(Node *node) {
+    const JitCost cost = node->getCost();
+    return cost.buffers + cost.ops / JIT_OPS_PER_READ >= MIN_SHARED_JIT_COST;
+}
+
 template<typename T>
 Node_ptr Array<T>::getNode() const {
+    // The array is used by another tree if its node has other owners. The
+    // trees that use it after it is evaluated read its values instead of
+    // computing them again.
+    if (!isReady() && node.use_count() > 1 && evalFlag() &&
+        !getQueue().is_worker() && isWorthSharing(node.get())) {
+        eval();
+    }
     if (node->isBuffer()) {
         BufferNode<T> *bufNode = reinterpret_cast<BufferNode<T> *>(node.get());
         unsigned bytes         = this->getDataDims().elements() * sizeof(T);
@@ -207,22 +373,46 @@ Array<T> createDeviceDataArray(const dim4 &dims, void *data) {
     return Array<T>(dims, static_cast<T *>(data), true);
 }
 
+template<typename T>
+Array<T> createExternalArray(const dim4 &dims, T *const data,
+                             std::function<void(T *)> deleter, bool read_only) {
+    return Array<T>(dims, data, std::move(deleter), !read_only);
+}
+
 template<typename T>
 Array<T> createValueArray(const dim4 &dims, const T &value) {
-    auto *node = new jit::ScalarNode<T>(value);
-    return createNodeArray<T>(dims, Node_ptr(node));
+    return createNodeArray<T>(dims, jit::createScalarNode<T>(value));
 }
 
 template<typename T>
-Array<T> createEmptyArray(const dim4 &dims) {
+Array<T> createEmptyArray(const dim4 &dims, const char *caller) {
+    common::AllocationScope scope(caller);
     return Array<T>(dims);
 }
 
 template<typename T>
 bool passesJitHeuristics(Node *root_node) {
     if (!evalFlag()) return true;
+    // Bounds the recursion over the tree when the tree is evaluated
     if (root_node->getHeight() >= (int)getMaxJitSize()) { return false; }
 
+    const JitCost cost       = root_node->getCost();
+    const size_t cache_bytes = getJitCacheSize();
+
+    // The interpreted trees keep a chunk of values for each node. Trees whose
+    // chunks do not fit in the cache evict their own values. The compiled
+    // trees keep their values in registers.
+    const size_t chunk_bytes = jit::VECTOR_LENGTH * sizeof(compute_t<T>);
+    if (!jit::isCompileEnabled() && cost.nodes * chunk_bytes > cache_bytes) {
+        return false;
+    }
+
+    // Wide trees that read more buffers than the cache holds and than the
+    // prefetchers follow wait on memory for each chunk
+    if (cost.buffers > MAX_JIT_STREAMS && cost.bytes > cache_bytes) {
+        return false;
+    }
+
     size_t alloc_bytes, alloc_buffers;
     size_t lock_bytes, lock_buffers;
 
@@ -230,17 +420,7 @@ bool passesJitHeuristics(Node *root_node) {
 
     // Check if approaching the memory limit
     if (lock_bytes > getMaxBytes() || lock_buffers > getMaxBuffers()) {
-        NodeIterator<jit::Node> it(root_node);
-        NodeIterator<jit::Node> end_node;
-        size_t bytes = accumulate(it, end_node, size_t(0),
-                                  [=](const size_t prev, const Node &n) {
-                                      // getBytes returns the size of the data
-                                      // Array. Sub arrays will be represented
-                                      // by their parent size.
-                                      return prev + n.getBytes();
-                                  });
-
-        if (2 * bytes > lock_bytes) { return false; }
+        if (2 * cost.bytes > lock_bytes) { return false; }
     }
     return true;
 }
@@ -248,6 +428,7 @@ bool passesJitHeuristics(Node *root_node) {
 template<typename T>
 Array<T> createNodeArray(const dim4 &dims, Node_ptr node) {
     Array<T> out = Array<T>(dims, node);
+    if (!passesJitHeuristics<T>(node.get())) { out.eval(); }
     return out;
 }
 
@@ -300,6 +481,18 @@ void writeHostDataArray(Array<T> &arr, const T *const data,
     memcpy(arr.get(), data, bytes);
 }
 
+template<typename T>
+void writeHostDataArrayAsync(Array<T> &arr, const T *const data,
+                             const size_t bytes) {
+    arr.eval();
+    // Arrays that share the buffer keep their data
+    if (!arr.isOwner() || arr.getOffset() || arr.useCount() > 1) {
+        arr = copyArray<T>(arr);
+    }
+    // The copy is ordered after the functions that use the memory
+    getQueue().enqueue(kernel::copyFromHost<T>, arr, data, bytes);
+}
+
 template<typename T>
 void writeDeviceDataArray(Array<T> &arr, const void *const data,
                           const size_t bytes) {
@@ -318,14 +511,19 @@ void Array<T>::setDataDims(const dim4 &new_dims) {
     template Array<T> createHostDataArray<T>(const dim4 &dims,                \
                                              const T *const data);            \
     template Array<T> createDeviceDataArray<T>(const dim4 &dims, void *data); \
+    template Array<T> createExternalArray<T>(                                 \
+        const dim4 &dims, T *const data, std::function<void(T *)> deleter,    \
+        bool read_only);                                                      \
     template Array<T> createValueArray<T>(const dim4 &dims, const T &value);  \
-    template Array<T> createEmptyArray<T>(const dim4 &dims);                  \
+    template Array<T> createEmptyArray<T>(const dim4 &dims,                   \
+                                          const char *caller);                \
     template Array<T> createSubArray<T>(                                      \
         const Array<T> &parent, const vector<af_seq> &index, bool copy);      \
     template void destroyArray<T>(Array<T> * A);                              \
     template Array<T> createNodeArray<T>(const dim4 &dims, Node_ptr node);    \
     template void Array<T>::eval();                                           \
     template void Array<T>::eval() const;                                     \
+    template int Array<T>::useCount() const;                                  \
     template T *Array<T>::device();                                           \
     template Array<T>::Array(const af::dim4 &dims, T *const in_data,          \
                              bool is_device, bool copy_device);               \
@@ -334,6 +532,8 @@ void Array<T>::setDataDims(const dim4 &new_dims) {
     template Node_ptr Array<T>::getNode() const;                              \
     template void writeHostDataArray<T>(Array<T> & arr, const T *const data,  \
                                         const size_t bytes);                  \
+    template void writeHostDataArrayAsync<T>(                                 \
+        Array<T> & arr, const T *const data, const size_t bytes);             \
     template void writeDeviceDataArray<T>(                                    \
         Array<T> & arr, const void *const data, const size_t bytes);          \
     template void evalMultiple<T>(vector<Array<T> *> arrays);                 \
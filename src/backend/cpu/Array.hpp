@@ -11,6 +11,7 @@
 #pragma once
 #include <Param.hpp>
 #include <common/ArrayInfo.hpp>
+#include <common/defines.hpp>
 #include <jit/Node.hpp>
 #include <memory.hpp>
 #include <platform.hpp>
@@ -21,6 +22,7 @@
 #include <af/seq.h>
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -61,6 +63,16 @@ Array<T> createHostDataArray(const af::dim4 &dims, const T *const data);
 template<typename T>
 Array<T> createDeviceDataArray(const af::dim4 &dims, void *data);
 
+/// Creates an array that uses \p data without copying it
+///
+/// \param[in] dims      The dimension of the array
+/// \param[in] data      The data of the array
+/// \param[in] deleter   Releases \p data once no array uses it
+/// \param[in] read_only The data is copied before it is modified if true
+template<typename T>
+Array<T> createExternalArray(const af::dim4 &dims, T *const data,
+                             std::function<void(T *)> deleter, bool read_only);
+
 template<typename T>
 Array<T> createStridedArray(af::dim4 dims, af::dim4 strides, dim_t offset,
                             T *const in_data, bool is_device) {
@@ -71,6 +83,12 @@ Array<T> createStridedArray(af::dim4 dims, af::dim4 strides, dim_t offset,
 template<typename T>
 void writeHostDataArray(Array<T> &arr, const T *const data, const size_t bytes);
 
+/// Enqueues a copy of data from a host pointer to an existing Array object.
+/// \p data must stay valid until the queue reaches the copy.
+template<typename T>
+void writeHostDataArrayAsync(Array<T> &arr, const T *const data,
+                             const size_t bytes);
+
 /// Copies data to an existing Array object from a device pointer
 template<typename T>
 void writeDeviceDataArray(Array<T> &arr, const void *const data,
@@ -79,8 +97,11 @@ void writeDeviceDataArray(Array<T> &arr, const void *const data,
 /// Creates an empty array of a given size. No data is initialized
 ///
 /// \param[in] size The dimension of the output array
+/// \param[in] caller The function the allocation is attributed to in the
+///                   memory statistics
 template<typename T>
-Array<T> createEmptyArray(const af::dim4 &dims);
+Array<T> createEmptyArray(const af::dim4 &dims,
+                          const char *caller = AF_CALLER_FUNCTION);
 
 template<typename T>
 Array<T> createSubArray(const Array<T> &parent,
@@ -130,6 +151,8 @@ class Array {
     explicit Array(const af::dim4 &dims, jit::Node_ptr n);
     Array(const af::dim4 &dims, const af::dim4 &strides, dim_t offset,
           T *const in_data, bool is_device = false);
+    Array(const af::dim4 &dims, T *const in_data,
+          std::function<void(T *)> deleter, bool is_owner);
 
    public:
     void resetInfo(const af::dim4 &dims) { info.resetInfo(dims); }
@@ -212,10 +235,9 @@ class Array {
         return data.get() + (withOffset ? getOffset() : 0);
     }
 
-    int useCount() const {
-        if (!data.get()) eval();
-        return static_cast<int>(data.use_count());
-    }
+    /// Returns the number of arrays and JIT trees that use the buffer of
+    /// this array. A write to the buffer needs a copy if it is more than 1.
+    int useCount() const;
 
     operator Param<T>() {
         return Param<T>(this->get(), this->dims(), this->strides());
@@ -233,11 +255,16 @@ class Array {
     friend Array<T> createHostDataArray<T>(const af::dim4 &dims,
                                            const T *const data);
     friend Array<T> createDeviceDataArray<T>(const af::dim4 &dims, void *data);
+    friend Array<T> createExternalArray<T>(const af::dim4 &dims,
+                                           T *const data,
+                                           std::function<void(T *)> deleter,
+                                           bool read_only);
     friend Array<T> createStridedArray<T>(af::dim4 dims, af::dim4 strides,
                                           dim_t offset, T *const in_data,
                                           bool is_device);
 
-    friend Array<T> createEmptyArray<T>(const af::dim4 &dims);
+    friend Array<T> createEmptyArray<T>(const af::dim4 &dims,
+                                        const char *caller);
     friend Array<T> createNodeArray<T>(const af::dim4 &dims,
                                        jit::Node_ptr node);
 
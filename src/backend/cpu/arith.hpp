@@ -11,6 +11,7 @@
 #include <err_cpu.hpp>
 #include <jit/BinaryNode.hpp>
 #include <optypes.hpp>
+#include <simd.hpp>
 #include <af/dim4.hpp>
 #include <cmath>
 
@@ -22,6 +23,12 @@ namespace cpu {
         void eval(jit::array<compute_t<T>> &out,                         \
                   const jit::array<compute_t<T>> &lhs,                   \
                   const jit::array<compute_t<T>> &rhs, int lim) const {  \
+            static const auto simd_func =                                \
+                simd::getBinaryFunc<compute_t<T>, compute_t<T>>(OP);     \
+            if (simd_func) {                                             \
+                simd_func(out.data(), lhs.data(), rhs.data(), lim);      \
+                return;                                                  \
+            }                                                            \
             for (int i = 0; i < lim; i++) { out[i] = lhs[i] op rhs[i]; } \
         }                                                                \
     };
@@ -67,6 +74,12 @@ STATIC_ double __rem<double>(double lhs, double rhs) {
         void eval(jit::array<compute_t<T>> &out,                           \
                   const jit::array<compute_t<T>> &lhs,                     \
                   const jit::array<compute_t<T>> &rhs, int lim) {          \
+            static const auto simd_func =                                  \
+                simd::getBinaryFunc<compute_t<T>, compute_t<T>>(OP);       \
+            if (simd_func) {                                               \
+                simd_func(out.data(), lhs.data(), rhs.data(), lim);        \
+                return;                                                    \
+            }                                                              \
             for (int i = 0; i < lim; i++) { out[i] = FN(lhs[i], rhs[i]); } \
         }                                                                  \
     };
@@ -85,10 +98,9 @@ Array<T> arithOp(const Array<T> &lhs, const Array<T> &rhs,
     jit::Node_ptr lhs_node = lhs.getNode();
     jit::Node_ptr rhs_node = rhs.getNode();
 
-    jit::BinaryNode<T, T, op> *node =
-        new jit::BinaryNode<T, T, op>(lhs_node, rhs_node);
+    jit::Node_ptr node = jit::createBinaryNode<T, T, op>(lhs_node, rhs_node);
 
-    return createNodeArray<T>(odims, jit::Node_ptr(node));
+    return createNodeArray<T>(odims, node);
 }
 
 }  // namespace cpu
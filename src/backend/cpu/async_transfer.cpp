@@ -0,0 +1,189 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <Array.hpp>
+#include <Event.hpp>
+#include <common/ArrayInfo.hpp>
+#include <common/half.hpp>
+#include <copy.hpp>
+#include <err_cpu.hpp>
+#include <handle.hpp>
+#include <platform.hpp>
+#include <queue.hpp>
+#include <type_util.hpp>
+#include <types.hpp>
+#include <af/array.h>
+#include <af/cpu.h>
+#include <af/defines.h>
+#include <af/dim4.hpp>
+
+#include <utility>
+
+using af::dim4;
+using common::half;
+using cpu::Array;
+using cpu::cdouble;
+using cpu::cfloat;
+using cpu::createEmptyArray;
+using cpu::Event;
+using cpu::getQueue;
+using cpu::uchar;
+
+/// Marks the functions enqueued so far on the queue of the calling thread
+static afcpu_event markEvent() {
+    Event event = cpu::make_event(getQueue());
+    if (!event) { AF_ERROR("Failed to create the event", AF_ERR_RUNTIME); }
+    return static_cast<afcpu_event>(new Event(std::move(event)));
+}
+
+template<typename T>
+static void copyDataAsync(void *data, const af_array arr) {
+    cpu::copyDataAsync(static_cast<T *>(data), getArray<T>(arr));
+}
+
+template<typename T>
+static void writeArrayAsync(af_array arr, const void *data,
+                            const size_t bytes) {
+    cpu::writeHostDataArrayAsync(getArray<T>(arr),
+                                 static_cast<const T *>(data), bytes);
+}
+
+template<typename T>
+static af_array createArrayAsync(const dim4 &dims, const void *data) {
+    Array<T> out = createEmptyArray<T>(dims);
+    cpu::writeHostDataArrayAsync(out, static_cast<const T *>(data),
+                                 dims.elements() * sizeof(T));
+    return getHandle(out);
+}
+
+af_err afcpu_get_data_ptr_async(afcpu_event *event, void *data,
+                                const af_array arr) {
+    try {
+        ARG_ASSERT(0, event != nullptr);
+        ARG_ASSERT(1, data != nullptr);
+        af_dtype type = getInfo(arr).getType();
+        switch (type) {
+            case f32: copyDataAsync<float>(data, arr); break;
+            case c32: copyDataAsync<cfloat>(data, arr); break;
+            case f64: copyDataAsync<double>(data, arr); break;
+            case c64: copyDataAsync<cdouble>(data, arr); break;
+            case b8: copyDataAsync<char>(data, arr); break;
+            case s32: copyDataAsync<int>(data, arr); break;
+            case u32: copyDataAsync<uint>(data, arr); break;
+            case u8: copyDataAsync<uchar>(data, arr); break;
+            case s64: copyDataAsync<intl>(data, arr); break;
+            case u64: copyDataAsync<uintl>(data, arr); break;
+            case s16: copyDataAsync<short>(data, arr); break;
+            case u16: copyDataAsync<ushort>(data, arr); break;
+            case f16: copyDataAsync<half>(data, arr); break;
+            default: TYPE_ERROR(2, type);
+        }
+        *event = markEvent();
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_write_array_async(afcpu_event *event, af_array arr,
+                               const void *data, const size_t bytes) {
+    try {
+        ARG_ASSERT(0, event != nullptr);
+        ARG_ASSERT(2, data != nullptr);
+        const ArrayInfo &info = getInfo(arr);
+        af_dtype type         = info.getType();
+        ARG_ASSERT(3, bytes <= info.elements() * size_of(type));
+        switch (type) {
+            case f32: writeArrayAsync<float>(arr, data, bytes); break;
+            case c32: writeArrayAsync<cfloat>(arr, data, bytes); break;
+            case f64: writeArrayAsync<double>(arr, data, bytes); break;
+            case c64: writeArrayAsync<cdouble>(arr, data, bytes); break;
+            case b8: writeArrayAsync<char>(arr, data, bytes); break;
+            case s32: writeArrayAsync<int>(arr, data, bytes); break;
+            case u32: writeArrayAsync<uint>(arr, data, bytes); break;
+            case u8: writeArrayAsync<uchar>(arr, data, bytes); break;
+            case s64: writeArrayAsync<intl>(arr, data, bytes); break;
+            case u64: writeArrayAsync<uintl>(arr, data, bytes); break;
+            case s16: writeArrayAsync<short>(arr, data, bytes); break;
+            case u16: writeArrayAsync<ushort>(arr, data, bytes); break;
+            case f16: writeArrayAsync<half>(arr, data, bytes); break;
+            default: TYPE_ERROR(1, type);
+        }
+        *event = markEvent();
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_create_array_async(afcpu_event *event, af_array *arr,
+                                const void *const data, const unsigned ndims,
+                                const dim_t *const dims,
+                                const af_dtype type) {
+    try {
+        ARG_ASSERT(0, event != nullptr);
+        ARG_ASSERT(1, arr != nullptr);
+        ARG_ASSERT(2, data != nullptr);
+        ARG_ASSERT(3, ndims > 0 && ndims <= AF_MAX_DIMS);
+        ARG_ASSERT(4, dims != nullptr);
+
+        dim4 d(1, 1, 1, 1);
+        for (unsigned i = 0; i < ndims; i++) {
+            ARG_ASSERT(4, dims[i] >= 0);
+            d[i] = dims[i];
+        }
+
+        af_array output = 0;
+        switch (type) {
+            case f32: output = createArrayAsync<float>(d, data); break;
+            case c32: output = createArrayAsync<cfloat>(d, data); break;
+            case f64: output = createArrayAsync<double>(d, data); break;
+            case c64: output = createArrayAsync<cdouble>(d, data); break;
+            case b8: output = createArrayAsync<char>(d, data); break;
+            case s32: output = createArrayAsync<int>(d, data); break;
+            case u32: output = createArrayAsync<uint>(d, data); break;
+            case u8: output = createArrayAsync<uchar>(d, data); break;
+            case s64: output = createArrayAsync<intl>(d, data); break;
+            case u64: output = createArrayAsync<uintl>(d, data); break;
+            case s16: output = createArrayAsync<short>(d, data); break;
+            case u16: output = createArrayAsync<ushort>(d, data); break;
+            case f16: output = createArrayAsync<half>(d, data); break;
+            default: TYPE_ERROR(5, type);
+        }
+        *event = markEvent();
+        std::swap(*arr, output);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_eval_async(afcpu_event *event, af_array arr) {
+    try {
+        ARG_ASSERT(0, event != nullptr);
+        AF_CHECK(af_eval(arr));
+        *event = markEvent();
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_wait_event(afcpu_event event) {
+    try {
+        ARG_ASSERT(0, event != nullptr);
+        static_cast<Event *>(event)->block();
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_release_event(afcpu_event event) {
+    try {
+        delete static_cast<Event *>(event);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
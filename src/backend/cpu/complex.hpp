@@ -12,6 +12,7 @@
 #include <jit/BinaryNode.hpp>
 #include <jit/UnaryNode.hpp>
 #include <optypes.hpp>
+#include <simd.hpp>
 #include <af/dim4.hpp>
 #include <complex>
 
@@ -31,16 +32,22 @@ Array<To> cplx(const Array<Ti> &lhs, const Array<Ti> &rhs,
     jit::Node_ptr lhs_node = lhs.getNode();
     jit::Node_ptr rhs_node = rhs.getNode();
 
-    jit::BinaryNode<To, Ti, af_cplx2_t> *node =
-        new jit::BinaryNode<To, Ti, af_cplx2_t>(lhs_node, rhs_node);
+    jit::Node_ptr node =
+        jit::createBinaryNode<To, Ti, af_cplx2_t>(lhs_node, rhs_node);
 
-    return createNodeArray<To>(odims, jit::Node_ptr(node));
+    return createNodeArray<To>(odims, node);
 }
 
 #define CPLX_UNARY_FN(op)                                                   \
     template<typename To, typename Ti>                                      \
     struct UnOp<To, Ti, af_##op##_t> {                                      \
         void eval(jit::array<To> &out, const jit::array<Ti> &in, int lim) { \
+            static const auto simd_func =                                   \
+                simd::getUnaryFunc<To, Ti>(af_##op##_t);                    \
+            if (simd_func) {                                                \
+                simd_func(out.data(), in.data(), lim);                      \
+                return;                                                     \
+            }                                                               \
             for (int i = 0; i < lim; i++) { out[i] = std::op(in[i]); }      \
         }                                                                   \
     };
@@ -53,40 +60,32 @@ CPLX_UNARY_FN(abs)
 template<typename To, typename Ti>
 Array<To> real(const Array<Ti> &in) {
     jit::Node_ptr in_node = in.getNode();
-    jit::UnaryNode<To, Ti, af_real_t> *node =
-        new jit::UnaryNode<To, Ti, af_real_t>(in_node);
+    jit::Node_ptr node = jit::createUnaryNode<To, Ti, af_real_t>(in_node);
 
-    return createNodeArray<To>(in.dims(),
-                               jit::Node_ptr(static_cast<jit::Node *>(node)));
+    return createNodeArray<To>(in.dims(), node);
 }
 
 template<typename To, typename Ti>
 Array<To> imag(const Array<Ti> &in) {
     jit::Node_ptr in_node = in.getNode();
-    jit::UnaryNode<To, Ti, af_imag_t> *node =
-        new jit::UnaryNode<To, Ti, af_imag_t>(in_node);
+    jit::Node_ptr node = jit::createUnaryNode<To, Ti, af_imag_t>(in_node);
 
-    return createNodeArray<To>(in.dims(),
-                               jit::Node_ptr(static_cast<jit::Node *>(node)));
+    return createNodeArray<To>(in.dims(), node);
 }
 
 template<typename To, typename Ti>
 Array<To> abs(const Array<Ti> &in) {
     jit::Node_ptr in_node = in.getNode();
-    jit::UnaryNode<To, Ti, af_abs_t> *node =
-        new jit::UnaryNode<To, Ti, af_abs_t>(in_node);
+    jit::Node_ptr node = jit::createUnaryNode<To, Ti, af_abs_t>(in_node);
 
-    return createNodeArray<To>(in.dims(),
-                               jit::Node_ptr(static_cast<jit::Node *>(node)));
+    return createNodeArray<To>(in.dims(), node);
 }
 
 template<typename T>
 Array<T> conj(const Array<T> &in) {
     jit::Node_ptr in_node = in.getNode();
-    jit::UnaryNode<T, T, af_conj_t> *node =
-        new jit::UnaryNode<T, T, af_conj_t>(in_node);
+    jit::Node_ptr node = jit::createUnaryNode<T, T, af_conj_t>(in_node);
 
-    return createNodeArray<T>(in.dims(),
-                              jit::Node_ptr(static_cast<jit::Node *>(node)));
+    return createNodeArray<T>(in.dims(), node);
 }
 }  // namespace cpu
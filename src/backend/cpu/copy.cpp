@@ -43,6 +43,12 @@ void copyData(T *to, const Array<T> &from) {
     }
 }
 
+template<typename T>
+void copyDataAsync(T *to, const Array<T> &from) {
+    from.eval();
+    getQueue().enqueue(kernel::copyToHost<T>, to, from);
+}
+
 template<typename T>
 Array<T> copyArray(const Array<T> &A) {
     Array<T> out = createEmptyArray<T>(A.dims());
@@ -58,8 +64,9 @@ void copyArray(Array<outType> &out, Array<inType> const &in) {
     getQueue().enqueue(kernel::copy<outType, inType>, out, in);
 }
 
-#define INSTANTIATE(T)                                         \
-    template void copyData<T>(T * data, const Array<T> &from); \
+#define INSTANTIATE(T)                                              \
+    template void copyData<T>(T * data, const Array<T> &from);      \
+    template void copyDataAsync<T>(T * data, const Array<T> &from); \
     template Array<T> copyArray<T>(const Array<T> &A);
 
 INSTANTIATE(float)
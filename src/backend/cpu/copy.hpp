@@ -22,6 +22,11 @@ namespace cpu {
 template<typename T>
 void copyData(T *data, const Array<T> &A);
 
+/// Enqueues a copy of the elements of \p A to \p data and returns without
+/// waiting for it. \p data must stay valid until the queue reaches the copy.
+template<typename T>
+void copyDataAsync(T *data, const Array<T> &A);
+
 template<typename T>
 Array<T> copyArray(const Array<T> &A);
 
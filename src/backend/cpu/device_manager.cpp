@@ -11,6 +11,8 @@
 #include <device_manager.hpp>
 #include <af/version.h>
 #include <memory.hpp>
+#include <numa.hpp>
+#include <thread_pool.hpp>
 
 #include <cctype>
 #include <sstream>
@@ -19,13 +21,26 @@ using std::string;
 
 #ifdef CPUID_CAPABLE
 
+// Returns the state components enabled by the OS in XCR0
+static uint64_t getXCR0() {
+#ifdef _WIN32
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
 CPUInfo::CPUInfo()
     : mVendorId("")
     , mModelName("")
     , mNumSMT(0)
     , mNumCores(0)
     , mNumLogCpus(0)
-    , mIsHTT(false) {
+    , mIsHTT(false)
+    , mHasAVX2(false)
+    , mHasAVX512(false) {
     // Get vendor name EAX=0
     CPUID cpuID1(1, 0);
     mIsHTT = cpuID1.EDX() & HTT_POS;
@@ -101,6 +116,24 @@ CPUInfo::CPUInfo()
         mModelName += string((const char*)&cpuID.EDX(), 4);
     }
     mModelName = string(mModelName.c_str());
+
+    // The vector registers can only be used if the OS saves them on a
+    // context switch. XCR0 bits 1-2 are the SSE and AVX state and bits 5-7
+    // are the AVX-512 state.
+    if (HFS >= 7 && (cpuID1.ECX() & OSXSAVE_POS)) {
+        uint64_t xcr0 = getXCR0();
+        CPUID cpuID7(7, 0);
+        bool osAVX    = (xcr0 & 0x06) == 0x06;
+        bool osAVX512 = (xcr0 & 0xE6) == 0xE6;
+
+        mHasAVX2 = osAVX && (cpuID1.ECX() & AVX_POS) &&
+                   (cpuID1.ECX() & FMA_POS) && (cpuID7.EBX() & AVX2_POS);
+
+        const uint32_t avx512 =
+            AVX512F_POS | AVX512DQ_POS | AVX512BW_POS | AVX512VL_POS;
+        mHasAVX512 =
+            mHasAVX2 && osAVX512 && (cpuID7.EBX() & avx512) == avx512;
+    }
 }
 
 #else
@@ -111,16 +144,38 @@ CPUInfo::CPUInfo()
     , mNumSMT(1)
     , mNumCores(1)
     , mNumLogCpus(1)
-    , mIsHTT(false) {}
+    , mIsHTT(false)
+    , mHasAVX2(false)
+    , mHasAVX512(false) {}
 
 #endif
 
 namespace cpu {
 
 DeviceManager::DeviceManager()
-    : queues(MAX_QUEUES)
+    : queues(useNumaDevices() ? getNumaNodeCount() : 1)
     , memManager(new MemoryManager())
-    , fgMngr(new graphics::ForgeManager()) {}
+    , fgMngr(new graphics::ForgeManager()) {
+    if (queues.size() == 1) {
+        thrPools.emplace_back(new ThreadPool(getDefaultThreadCount()));
+        return;
+    }
+
+    // Each NUMA node is a device whose queue and pool run on its CPUs
+    for (int node = 0; node < static_cast<int>(queues.size()); node++) {
+        const std::vector<int>& cores = getNumaNodeCpus(node);
+        thrPools.emplace_back(
+            new ThreadPool(getDefaultThreadCount(cores), false, cores));
+
+        queue* device_queue = &queues[node];
+        device_queue->enqueue([device_queue, node, &cores]() {
+            if (device_queue->is_worker()) {
+                setCurrentThreadAffinity(cores);
+                setDevice(node);
+            }
+        });
+    }
+}
 
 DeviceManager& DeviceManager::getInstance() {
     static DeviceManager* my_instance = new DeviceManager();
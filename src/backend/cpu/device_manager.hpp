@@ -12,6 +12,7 @@
 #include <platform.hpp>
 #include <queue.hpp>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #if defined(AF_WITH_CPUID) &&                                       \
@@ -62,6 +63,8 @@ class CPUInfo {
     std::string vendor() const { return mVendorId; }
     std::string model() const { return mModelName; }
     int threads() const { return mNumLogCpus; }
+    bool hasAVX2() const { return mHasAVX2; }
+    bool hasAVX512() const { return mHasAVX512; }
 
    private:
     // Bit positions for data extractions
@@ -70,6 +73,16 @@ class CPUInfo {
     static const uint32_t LVL_CORES = 0x0000FFFF;
     static const uint32_t HTT_POS   = 0x10000000;
 
+    // Feature bits of CPUID leaf 1 (ECX) and leaf 7 (EBX)
+    static const uint32_t FMA_POS      = 0x00001000;
+    static const uint32_t OSXSAVE_POS  = 0x08000000;
+    static const uint32_t AVX_POS      = 0x10000000;
+    static const uint32_t AVX2_POS     = 0x00000020;
+    static const uint32_t AVX512F_POS  = 0x00010000;
+    static const uint32_t AVX512DQ_POS = 0x00020000;
+    static const uint32_t AVX512BW_POS = 0x40000000;
+    static const uint32_t AVX512VL_POS = 0x80000000;
+
     // Attributes
     std::string mVendorId;
     std::string mModelName;
@@ -77,15 +90,14 @@ class CPUInfo {
     int mNumCores;
     int mNumLogCpus;
     bool mIsHTT;
+    bool mHasAVX2;
+    bool mHasAVX512;
 };
 
 namespace cpu {
 
 class DeviceManager {
    public:
-    static const int MAX_QUEUES           = 1;
-    static const int NUM_DEVICES          = 1;
-    static const int ACTIVE_DEVICE_ID     = 0;
     static const bool IS_DOUBLE_SUPPORTED = true;
 
     // TODO(umar): Half is not supported for BLAS and FFT on x86_64
@@ -95,8 +107,18 @@ class DeviceManager {
 
     friend queue& getQueue(int device);
 
+    friend queue* createStream();
+
+    friend void releaseStream(queue* stream);
+
+    friend void setActiveStream(queue* stream);
+
+    friend void syncAllStreams();
+
     friend MemoryManager& memoryManager();
 
+    friend ThreadPool& threadPool(int device);
+
     friend graphics::ForgeManager& forgeManager();
 
     CPUInfo getCPUInfo() const;
@@ -112,7 +134,11 @@ class DeviceManager {
 
     // Attributes
     std::vector<queue> queues;
+    std::vector<std::shared_ptr<queue>> streams;
+    std::mutex stream_mutex;
     std::unique_ptr<MemoryManager> memManager;
+    // One pool per device. The pool of a NUMA device runs on its node.
+    std::vector<std::unique_ptr<ThreadPool>> thrPools;
     std::unique_ptr<graphics::ForgeManager> fgMngr;
     const CPUInfo cinfo;
 };
@@ -0,0 +1,217 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <graph.hpp>
+
+#include <Array.hpp>
+#include <common/ArrayInfo.hpp>
+#include <common/half.hpp>
+#include <err_cpu.hpp>
+#include <handle.hpp>
+#include <kernel/copy.hpp>
+#include <memory.hpp>
+#include <platform.hpp>
+#include <queue.hpp>
+#include <types.hpp>
+#include <af/array.h>
+#include <af/cpu.h>
+#include <af/defines.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+using common::half;
+using std::move;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+namespace cpu {
+
+namespace {
+
+thread_local Graph *capturing = nullptr;
+
+void runTasks(shared_ptr<vector<Graph::Task>> tasks) {
+    for (const Graph::Task &task : *tasks) { task(); }
+}
+
+template<typename T>
+Graph::Input makeInput(const af_array arr) {
+    Array<T> slot = getArray<T>(arr);
+    slot.eval();
+    auto write = [slot](const af_array in) mutable {
+        const Array<T> &value = getArray<T>(in);
+        value.eval();
+        if (value.get() == slot.get()) { return; }
+        getQueue().enqueue(kernel::copy<T, T>, slot, value);
+    };
+    return {getInfo(arr).getType(), slot.dims(), write};
+}
+
+}  // namespace
+
+Graph::Graph(vector<Input> inputs)
+    : inputs_(move(inputs)), tasks_(std::make_shared<vector<Task>>()) {}
+
+Graph::~Graph() {
+    try {
+        // The replays on the queues may still write the buffers
+        syncAllStreams();
+        for (const void *ptr : locked_) { memUnlock(ptr); }
+    } catch (AfError &err) {
+        // Do not throw any errors while releasing the graph
+    }
+}
+
+void Graph::lockBuffer(const void *ptr) {
+    if (!ptr) { return; }
+    memLock(ptr);
+    locked_.push_back(ptr);
+}
+
+void Graph::invalidate(const char *reason) {
+    if (invalid_.empty()) { invalid_ = reason; }
+}
+
+void Graph::validate() const {
+    if (!invalid_.empty()) { AF_ERROR(invalid_, AF_ERR_NOT_SUPPORTED); }
+}
+
+void Graph::replay(const af_array *inputs, unsigned ninputs) {
+    if (ninputs != inputs_.size()) {
+        AF_ERROR("The number of inputs differs from the captured inputs",
+                 AF_ERR_ARG);
+    }
+    for (unsigned i = 0; i < ninputs; i++) {
+        const ArrayInfo &info = getInfo(inputs[i]);
+        if (info.getType() != inputs_[i].type) {
+            TYPE_ERROR(1, info.getType());
+        }
+        if (info.dims() != inputs_[i].dims) {
+            AF_ERROR("The input differs in size from the captured input",
+                     AF_ERR_SIZE);
+        }
+    }
+    for (unsigned i = 0; i < ninputs; i++) { inputs_[i].write(inputs[i]); }
+    getQueue().enqueue(runTasks, tasks_);
+}
+
+Graph *capturingGraph() { return capturing; }
+
+}  // namespace cpu
+
+using cpu::Graph;
+
+af_err afcpu_begin_capture(const af_array *inputs, const unsigned ninputs) {
+    try {
+        ARG_ASSERT(0, inputs != nullptr || ninputs == 0);
+        if (cpu::capturing) {
+            AF_ERROR("The thread is already capturing a graph",
+                     AF_ERR_RUNTIME);
+        }
+
+        vector<Graph::Input> graph_inputs;
+        for (unsigned i = 0; i < ninputs; i++) {
+            af_dtype type = getInfo(inputs[i]).getType();
+            switch (type) {
+                case f32:
+                    graph_inputs.push_back(cpu::makeInput<float>(inputs[i]));
+                    break;
+                case c32:
+                    graph_inputs.push_back(
+                        cpu::makeInput<cpu::cfloat>(inputs[i]));
+                    break;
+                case f64:
+                    graph_inputs.push_back(cpu::makeInput<double>(inputs[i]));
+                    break;
+                case c64:
+                    graph_inputs.push_back(
+                        cpu::makeInput<cpu::cdouble>(inputs[i]));
+                    break;
+                case b8:
+                    graph_inputs.push_back(cpu::makeInput<char>(inputs[i]));
+                    break;
+                case s32:
+                    graph_inputs.push_back(cpu::makeInput<int>(inputs[i]));
+                    break;
+                case u32:
+                    graph_inputs.push_back(cpu::makeInput<uint>(inputs[i]));
+                    break;
+                case u8:
+                    graph_inputs.push_back(
+                        cpu::makeInput<cpu::uchar>(inputs[i]));
+                    break;
+                case s64:
+                    graph_inputs.push_back(cpu::makeInput<intl>(inputs[i]));
+                    break;
+                case u64:
+                    graph_inputs.push_back(cpu::makeInput<uintl>(inputs[i]));
+                    break;
+                case s16:
+                    graph_inputs.push_back(cpu::makeInput<short>(inputs[i]));
+                    break;
+                case u16:
+                    graph_inputs.push_back(cpu::makeInput<ushort>(inputs[i]));
+                    break;
+                case f16:
+                    graph_inputs.push_back(cpu::makeInput<half>(inputs[i]));
+                    break;
+                default: TYPE_ERROR(0, type);
+            }
+        }
+        cpu::capturing = new Graph(move(graph_inputs));
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_end_capture(afcpu_graph *graph, const af_array *outputs,
+                         const unsigned noutputs) {
+    try {
+        ARG_ASSERT(0, graph != nullptr);
+        ARG_ASSERT(1, outputs != nullptr || noutputs == 0);
+        if (!cpu::capturing) {
+            AF_ERROR("The thread is not capturing a graph", AF_ERR_RUNTIME);
+        }
+
+        // The outputs are evaluated while their functions are captured
+        unique_ptr<Graph> captured(cpu::capturing);
+        af_err err = AF_SUCCESS;
+        for (unsigned i = 0; i < noutputs && err == AF_SUCCESS; i++) {
+            err = af_eval(outputs[i]);
+        }
+        cpu::capturing = nullptr;
+        AF_CHECK(err);
+        captured->validate();
+        *graph = static_cast<afcpu_graph>(captured.release());
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_replay_graph(afcpu_graph graph, const af_array *inputs,
+                          const unsigned ninputs) {
+    try {
+        ARG_ASSERT(0, graph != nullptr);
+        ARG_ASSERT(1, inputs != nullptr || ninputs == 0);
+        static_cast<Graph *>(graph)->replay(inputs, ninputs);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_release_graph(afcpu_graph graph) {
+    try {
+        delete static_cast<Graph *>(graph);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
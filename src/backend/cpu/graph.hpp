@@ -0,0 +1,102 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <Param.hpp>
+#include <af/defines.h>
+#include <af/dim4.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cpu {
+
+template<typename T>
+class Array;
+
+/// The functions a thread enqueued between the start and the end of a
+/// capture
+///
+/// The functions run when they are captured. Replaying the graph enqueues
+/// them again as a single function with the same arguments, without the
+/// validation, the allocations and the JIT trees of the functions that
+/// enqueued them. The buffers allocated during the capture are kept by the
+/// graph, so each replay writes the same buffers.
+class Graph {
+   public:
+    using Task = std::function<void()>;
+
+    /// An array whose data is replaced by the data of another array before
+    /// each replay
+    struct Input {
+        af_dtype type;
+        af::dim4 dims;
+        std::function<void(const af_array)> write;
+    };
+
+    explicit Graph(std::vector<Input> inputs);
+    ~Graph();
+
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
+
+    /// Adds a function enqueued during the capture. The graph keeps the
+    /// buffers of the arrays passed to the function.
+    template<typename F, typename... Args>
+    void addTask(const F &func, Args &... args) {
+        // Calls retain on each argument in order
+        int expand[] = {0, (retain(args), 0)...};
+        (void)expand;
+        tasks_->push_back(std::bind(func, toParam(args)...));
+    }
+
+    /// Keeps a buffer allocated during the capture until the graph is
+    /// released
+    void lockBuffer(const void *ptr);
+
+    /// Makes the graph fail validation with \p reason
+    void invalidate(const char *reason);
+
+    /// Throws if the graph can not be replayed
+    void validate() const;
+
+    /// Writes \p inputs to the inputs of the graph and enqueues the functions
+    void replay(const af_array *inputs, unsigned ninputs);
+
+   private:
+    template<typename T>
+    void retain(const Array<T> &arr) {
+        buffers_.push_back(arr.getData());
+    }
+
+    /// Functions that read or write host memory do so when they are
+    /// captured. The memory may be gone when the graph is replayed.
+    template<typename T>
+    void retain(T *const &) {
+        invalidate("A captured function uses a host pointer");
+    }
+
+    /// Other arguments are copied into the task
+    template<typename T>
+    void retain(const T &) {}
+
+    std::vector<Input> inputs_;
+    std::shared_ptr<std::vector<Task>> tasks_;
+    std::vector<std::shared_ptr<void>> buffers_;
+    std::vector<const void *> locked_;
+    std::string invalid_;
+};
+
+/// Returns the graph the calling thread captures, or nullptr
+Graph *capturingGraph();
+
+}  // namespace cpu
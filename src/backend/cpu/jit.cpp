@@ -0,0 +1,439 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <jit.hpp>
+
+#include <common/Logger.hpp>
+#include <common/defines.hpp>
+#include <common/module_loading.hpp>
+#include <common/util.hpp>
+#include <device_manager.hpp>
+#include <version.hpp>
+#include <af/version.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(OS_WIN)
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif
+
+using common::getFunctionPointer;
+using common::loadLibrary;
+using common::loggerFactory;
+using common::unloadLibrary;
+using std::getline;
+using std::hash;
+using std::ifstream;
+using std::lock_guard;
+using std::mutex;
+using std::ofstream;
+using std::promise;
+using std::shared_future;
+using std::string;
+using std::stringstream;
+using std::unordered_map;
+using std::vector;
+
+namespace cpu {
+namespace jit {
+
+static spdlog::logger *getLogger() {
+    static std::shared_ptr<spdlog::logger> logger(loggerFactory("jit"));
+    return logger.get();
+}
+
+bool isCompileEnabled() {
+#if defined(OS_WIN)
+    return false;
+#else
+    static const bool enabled = getEnvVar("AF_CPU_JIT_COMPILE") == "1";
+    return enabled;
+#endif
+}
+
+static const string &getCompiler() {
+    static const string compiler = [] {
+        string cxx = getEnvVar("AF_CPU_JIT_CXX");
+        return cxx.empty() ? string("c++") : cxx;
+    }();
+    return compiler;
+}
+
+static const string &getCompilerFlags() {
+    static const string flags = [] {
+        string cxx_flags = getEnvVar("AF_CPU_JIT_CXX_FLAGS");
+        return cxx_flags.empty() ? string("-O3 -march=native") : cxx_flags;
+    }();
+    return flags;
+}
+
+/// Returns a description of the instruction sets of the host
+///
+/// The kernels are built with -march=native by default, so a library built
+/// on another CPU may use instructions that this CPU does not have.
+static const string &getHostDescription() {
+    static const string host = [] {
+        stringstream desc;
+        const CPUInfo cinfo = DeviceManager::getInstance().getCPUInfo();
+        desc << cinfo.vendor() << ";" << cinfo.model() << ";"
+             << cinfo.hasAVX2() << cinfo.hasAVX512();
+#if !defined(OS_WIN)
+        struct utsname name;
+        if (uname(&name) == 0) { desc << ";" << name.machine; }
+
+        // The feature flags of the first CPU as listed by Linux
+        ifstream cpuinfo("/proc/cpuinfo");
+        string line;
+        while (getline(cpuinfo, line)) {
+            if (line.compare(0, 5, "flags") == 0 ||
+                line.compare(0, 8, "Features") == 0) {
+                desc << ";" << line;
+                break;
+            }
+        }
+#endif
+        return desc.str();
+    }();
+    return host;
+}
+
+/// Returns the name of the kernel of a tree and sets \p key to the string
+/// that identifies the kernel
+///
+/// The key describes the tree, the version of the library, the compiler, its
+/// flags and the host. The name is a hash of the key, so two keys may have
+/// the same name. The key is stored in the library and compared when the
+/// library is loaded.
+static string getFuncName(const char *out_type,
+                          const vector<Node *> &full_nodes,
+                          const vector<Node_ids> &full_ids,
+                          const vector<int> &output_ids, bool is_linear,
+                          string &key, bool &supported) {
+    stringstream funcName;
+    stringstream hashName;
+
+    // The version is part of the name so that kernels generated by a
+    // different version of the library are not loaded from the disk cache
+    funcName << AF_VERSION << "_" << AF_REVISION << "_";
+    funcName << (is_linear ? "L_" : "G_") << out_type;
+
+    for (int id : output_ids) { funcName << "_o" << id; }
+
+    supported = true;
+    for (size_t i = 0; i < full_nodes.size() && supported; i++) {
+        supported = full_nodes[i]->genKerName(funcName, full_ids[i]);
+    }
+
+    funcName << "|" << getCompiler() << "|" << getCompilerFlags() << "|"
+             << getHostDescription();
+    key = funcName.str();
+
+    hash<string> hash_fn;
+    hashName << "KER" << hash_fn(key);
+    return hashName.str();
+}
+
+/// Returns \p str as a C string literal
+static string cQuote(const string &str) {
+    string quoted = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c == '\n') {
+            quoted += "\\n";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+static string getKernelString(const string &funcName, const string &key,
+                              const char *out_type,
+                              const vector<Node *> &full_nodes,
+                              const vector<Node_ids> &full_ids,
+                              const vector<int> &output_ids, bool is_linear) {
+    // This part of the code does not change with the kernel. The helper
+    // functions match the ones used by BinOp in arith.hpp
+    static const char *includeStr = R"JIT(
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+typedef long long dim_t;
+
+struct KernelArg {
+    const void *ptr;
+    dim_t dims[4];
+    dim_t strides[4];
+};
+
+template<typename T>
+static T __mod(T lhs, T rhs) {
+    T res = lhs % rhs;
+    return (res < 0) ? ((rhs - res) < 0 ? res - rhs : rhs - res) : res;
+}
+template<typename T>
+static T __rem(T lhs, T rhs) { return lhs % rhs; }
+static float __mod(float lhs, float rhs) { return std::fmod(lhs, rhs); }
+static double __mod(double lhs, double rhs) { return std::fmod(lhs, rhs); }
+static float __rem(float lhs, float rhs) { return std::remainder(lhs, rhs); }
+static double __rem(double lhs, double rhs) { return std::remainder(lhs, rhs); }
+
+)JIT";
+
+    static const char *kernelVoid = "extern \"C\" void ";
+    static const char *kernelParams =
+        "(const KernelArg *args, void *const *outs, const dim_t *odims, "
+        "const dim_t *ostrides, dim_t begin, dim_t end)";
+
+    static const char *linearLoop =
+        "for (dim_t idx = begin; idx < end; idx++) {\n";
+
+    static const char *generalLoop = R"JIT(
+for (dim_t row = begin; row < end; row++) {
+dim_t id1 = row % odims[1];
+dim_t id2 = (row / odims[1]) % odims[2];
+dim_t id3 = row / (odims[1] * odims[2]);
+dim_t offset = id1 * ostrides[1] + id2 * ostrides[2] + id3 * ostrides[3];
+)JIT";
+
+    static const char *generalInnerLoop =
+        "for (dim_t id0 = 0; id0 < odims[0]; id0++) {\n"
+        "dim_t idx = offset + id0;\n";
+
+    stringstream paramsStream;
+    stringstream offsetsStream;
+    stringstream opsStream;
+    stringstream outWriteStream;
+
+    for (size_t i = 0; i < full_nodes.size(); i++) {
+        const auto &node = full_nodes[i];
+        const auto &ids  = full_ids[i];
+        node->genParams(paramsStream, ids.id);
+        node->genOffsets(offsetsStream, ids.id, is_linear);
+        node->genFuncs(opsStream, ids, is_linear);
+    }
+
+    for (size_t i = 0; i < output_ids.size(); i++) {
+        paramsStream << out_type << " *out" << i << " = (" << out_type
+                     << " *)outs[" << i << "];\n";
+        outWriteStream << "out" << i << "[idx] = val" << output_ids[i]
+                       << ";\n";
+    }
+
+    stringstream kerStream;
+    kerStream << includeStr;
+    kerStream << kernelVoid << funcName << kernelParams << " {\n";
+    kerStream << paramsStream.str();
+    if (is_linear) {
+        kerStream << linearLoop;
+        kerStream << opsStream.str();
+        kerStream << outWriteStream.str();
+        kerStream << "}\n";
+    } else {
+        kerStream << generalLoop;
+        kerStream << offsetsStream.str();
+        kerStream << generalInnerLoop;
+        kerStream << opsStream.str();
+        kerStream << outWriteStream.str();
+        kerStream << "}\n}\n";
+    }
+    kerStream << "}\n";
+    kerStream << "extern \"C\" const char " << funcName
+              << "_key[] = " << cQuote(key) << ";\n";
+
+    return kerStream.str();
+}
+
+#if !defined(OS_WIN)
+/// Returns the directory of the compiled kernels, or an empty string if it
+/// can not be used safely
+///
+/// The libraries in the directory are loaded into the process, so the
+/// directory must be a directory that only the current user can write to.
+/// Otherwise another user could place a library in it.
+static string getCacheDirectory() {
+    string dir = getEnvVar("AF_CPU_JIT_CACHE_DIRECTORY");
+    if (dir.empty()) {
+        string tmp = getEnvVar("TMPDIR");
+        dir        = (tmp.empty() ? string("/tmp") : tmp) +
+              "/arrayfire_cpu_jit_" + std::to_string(getuid());
+    }
+    // The directory may already exist
+    mkdir(dir.c_str(), 0700);
+
+    struct stat info;
+    if (lstat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) ||
+        info.st_uid != getuid() || (info.st_mode & 0077) != 0) {
+        AF_TRACE("{} is not a directory with mode 0700 owned by the user",
+                 dir);
+        return string();
+    }
+    return dir;
+}
+
+/// Quotes \p str for the shell
+static string shellQuote(const string &str) {
+    string quoted = "'";
+    for (char c : str) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+/// Loads the kernel from \p libPath if the library was built for \p key
+static KernelFunc loadKernel(const string &libPath, const string &funcName,
+                             const string &key) {
+    LibHandle handle = loadLibrary(libPath.c_str());
+    if (!handle) { return nullptr; }
+
+    // The library was built for another tree with the same name, by another
+    // compiler or for another host
+    const string keyName = funcName + "_key";
+    const char *libKey   = static_cast<const char *>(
+        getFunctionPointer(handle, keyName.c_str()));
+    if (!libKey || key != libKey) {
+        AF_TRACE("{}: {} was built for another key", funcName, libPath);
+        unloadLibrary(handle);
+        return nullptr;
+    }
+
+    // The library is never unloaded because the kernel is cached for the
+    // lifetime of the process
+    return reinterpret_cast<KernelFunc>(
+        getFunctionPointer(handle, funcName.c_str()));
+}
+
+static KernelFunc buildKernel(const string &funcName, const string &key,
+                              const string &source) {
+    const string dir = getCacheDirectory();
+    if (dir.empty()) { return nullptr; }
+    const string libPath = dir + AF_PATH_SEPARATOR + funcName + ".so";
+
+    KernelFunc func = loadKernel(libPath, funcName, key);
+    if (func) {
+        AF_TRACE("{}: loaded from {}", funcName, libPath);
+        return func;
+    }
+
+    const string &compiler = getCompiler();
+    const string &flags    = getCompilerFlags();
+
+    // Compile files unique to this process and rename the library once it
+    // is complete so that other processes never load a partial library
+    const string pid     = std::to_string(getpid());
+    const string srcPath = dir + AF_PATH_SEPARATOR + funcName + "." + pid +
+                           ".cpp";
+    const string tmpPath = libPath + "." + pid;
+    {
+        ofstream src(srcPath);
+        src << source;
+        if (!src) {
+            AF_TRACE("{}: failed to write {}", funcName, srcPath);
+            std::remove(srcPath.c_str());
+            return nullptr;
+        }
+    }
+
+    // The compiler and the flags are split by the shell
+    const string command = compiler + " -std=c++11 -shared -fPIC " + flags +
+                           " -o " + shellQuote(tmpPath) + " " +
+                           shellQuote(srcPath);
+    const bool built = std::system(command.c_str()) == 0 &&
+                       std::rename(tmpPath.c_str(), libPath.c_str()) == 0;
+    std::remove(srcPath.c_str());
+    if (!built) {
+        AF_TRACE("{}: failed to compile: {}", funcName, command);
+        std::remove(tmpPath.c_str());
+        return nullptr;
+    }
+
+    func = loadKernel(libPath, funcName, key);
+    AF_TRACE("{}: compiled to {}", funcName, libPath);
+    return func;
+}
+#endif
+
+KernelFunc getKernel(const char *out_type, const vector<Node *> &full_nodes,
+                     const vector<Node_ids> &full_ids,
+                     const vector<int> &output_ids, bool is_linear) {
+#if defined(OS_WIN)
+    UNUSED(out_type);
+    UNUSED(full_nodes);
+    UNUSED(full_ids);
+    UNUSED(output_ids);
+    UNUSED(is_linear);
+    return nullptr;
+#else
+    // Failed builds are cached as nullptr so that they are not retried. The
+    // threads that need a kernel that is being built wait for it, without
+    // holding the lock that the threads using other kernels need.
+    static unordered_map<string, shared_future<KernelFunc>> kernelCache;
+    static mutex cacheMutex;
+
+    if (!out_type) { return nullptr; }
+
+    bool supported = false;
+    string key;
+    string funcName = getFuncName(out_type, full_nodes, full_ids, output_ids,
+                                  is_linear, key, supported);
+    if (!supported) { return nullptr; }
+
+    promise<KernelFunc> built;
+    shared_future<KernelFunc> cached;
+    bool building = false;
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto iter = kernelCache.find(key);
+        if (iter != kernelCache.end()) {
+            cached = iter->second;
+        } else {
+            cached           = built.get_future().share();
+            kernelCache[key] = cached;
+            building         = true;
+        }
+    }
+    if (!building) { return cached.get(); }
+
+    KernelFunc func = nullptr;
+    try {
+        string jit_ker = getKernelString(funcName, key, out_type,
+                                         full_nodes, full_ids, output_ids,
+                                         is_linear);
+        saveKernel(funcName, jit_ker, ".cpp");
+        func = buildKernel(funcName, key, jit_ker);
+    } catch (...) {
+        // The tree is interpreted instead
+    }
+    built.set_value(func);
+    return func;
+#endif
+}
+
+}  // namespace jit
+}  // namespace cpu
@@ -0,0 +1,58 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <jit/Node.hpp>
+#include <af/defines.h>
+
+#include <vector>
+
+namespace cpu {
+namespace jit {
+
+/// A JIT tree compiled to native code
+///
+/// Linear kernels compute the elements [begin, end) of the outputs. Strided
+/// kernels compute the rows [begin, end) where a row is the first dimension
+/// of the output and the rows are numbered over dimensions 1, 2 and 3.
+///
+/// \param[in] args     The arguments of each node indexed by the node id
+/// \param[in] outs     The pointers of the outputs
+/// \param[in] odims    The dimensions of the outputs
+/// \param[in] ostrides The strides of the outputs
+/// \param[in] begin    The first element or row that is computed
+/// \param[in] end      One past the last element or row that is computed
+using KernelFunc = void (*)(const KernelArg *args, void *const *outs,
+                            const dim_t *odims, const dim_t *ostrides,
+                            dim_t begin, dim_t end);
+
+/// Returns true if the JIT trees are compiled to native code. Enabled by the
+/// AF_CPU_JIT_COMPILE environment variable.
+bool isCompileEnabled();
+
+/// Returns the compiled kernel of a JIT tree
+///
+/// The kernel is searched in the in-memory cache, then in the on-disk cache.
+/// Otherwise the kernel source is generated and compiled with the system
+/// compiler.
+///
+/// \param[in] out_type   The type name of the outputs in the generated code
+/// \param[in] full_nodes The nodes of the tree in evaluation order
+/// \param[in] full_ids   The ids of the nodes and their children
+/// \param[in] output_ids The ids of the output nodes
+/// \param[in] is_linear  True if the kernel is a linear kernel
+///
+/// \returns nullptr if the tree can not be compiled
+KernelFunc getKernel(const char *out_type,
+                     const std::vector<Node *> &full_nodes,
+                     const std::vector<Node_ids> &full_ids,
+                     const std::vector<int> &output_ids, bool is_linear);
+
+}  // namespace jit
+}  // namespace cpu
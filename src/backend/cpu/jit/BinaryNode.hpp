@@ -8,11 +8,17 @@
  ********************************************************/
 
 #pragma once
+#include <jit/codegen.hpp>
 #include <math.hpp>
 #include <optypes.hpp>
 #include <array>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include "Node.hpp"
+#include "NodeCache.hpp"
+#include "NodePool.hpp"
+#include "ScalarNode.hpp"
 
 namespace cpu {
 
@@ -32,29 +38,133 @@ template<typename To, typename Ti, af_op_t op>
 class BinaryNode : public TNode<To> {
    protected:
     BinOp<To, Ti, op> m_op;
-    TNode<Ti> *m_lhs, *m_rhs;
 
    public:
     BinaryNode(Node_ptr lhs, Node_ptr rhs)
-        : TNode<To>(To(0), std::max(lhs->getHeight(), rhs->getHeight()) + 1,
-                    {{lhs, rhs}})
-        , m_lhs(reinterpret_cast<TNode<Ti> *>(lhs.get()))
-        , m_rhs(reinterpret_cast<TNode<Ti> *>(rhs.get())) {}
+        : TNode<To>(std::max(lhs->getHeight(), rhs->getHeight()) + 1,
+                    {{lhs, rhs}}) {}
 
-    void calc(int x, int y, int z, int w, int lim) final {
+    af_op_t getOp() const final { return op; }
+
+    void calc(int x, int y, int z, int w, int lim, Chunk *out,
+              const Chunk *const *in) final {
         UNUSED(x);
         UNUSED(y);
         UNUSED(z);
         UNUSED(w);
-        m_op.eval(this->m_val, m_lhs->m_val, m_rhs->m_val, lim);
+        m_op.eval(TNode<To>::values(out), TNode<Ti>::values(in[0]),
+                  TNode<Ti>::values(in[1]), lim);
     }
 
-    void calc(int idx, int lim) final {
+    void calc(int idx, int lim, Chunk *out, const Chunk *const *in) final {
         UNUSED(idx);
-        m_op.eval(this->m_val, m_lhs->m_val, m_rhs->m_val, lim);
+        m_op.eval(TNode<To>::values(out), TNode<Ti>::values(in[0]),
+                  TNode<Ti>::values(in[1]), lim);
+    }
+
+    bool genKerName(std::stringstream &kerStream,
+                    const Node_ids &ids) const final {
+        if (!typeName<To>() || !typeName<Ti>() ||
+            binaryOpStr<To, Ti>(op, "", "").empty()) {
+            return false;
+        }
+        kerStream << "_b" << op << "_" << typeName<To>() << "_"
+                  << typeName<Ti>() << "_" << ids.child_ids[0] << "_"
+                  << ids.child_ids[1];
+        return true;
+    }
+
+    void genFuncs(std::stringstream &kerStream, const Node_ids &ids,
+                  bool is_linear) const final {
+        UNUSED(is_linear);
+        std::string lhs = "val" + std::to_string(ids.child_ids[0]);
+        std::string rhs = "val" + std::to_string(ids.child_ids[1]);
+        kerStream << typeName<To>() << " val" << ids.id << " = static_cast<"
+                  << typeName<To>() << ">(" << binaryOpStr<To, Ti>(op, lhs, rhs)
+                  << ");\n";
     }
 };
 
+/// Computes \p op on the values of the ScalarNodes \p lhs and \p rhs once
+template<typename To, typename Ti, af_op_t op>
+Node_ptr foldBinaryNode(const Node_ptr &lhs, const Node_ptr &rhs,
+                        std::true_type) {
+    using Scalar = const ScalarNode<Ti>;
+    jit::array<To> out;
+    jit::array<Ti> lhs_val, rhs_val;
+    lhs_val[0] = reinterpret_cast<Scalar *>(lhs.get())->getValue();
+    rhs_val[0] = reinterpret_cast<Scalar *>(rhs.get())->getValue();
+    BinOp<To, Ti, op> binary_op;
+    binary_op.eval(out, lhs_val, rhs_val, 1);
+    return createScalarNode<To>(out[0]);
+}
+
+template<typename To, typename Ti, af_op_t op>
+Node_ptr foldBinaryNode(const Node_ptr &lhs, const Node_ptr &rhs,
+                        std::false_type) {
+    UNUSED(lhs);
+    UNUSED(rhs);
+    return nullptr;
+}
+
+/// Returns the operand of \p op that gives the same result as the operation
+/// or nullptr if there is none. Negation is computed as 0 - x, so -(-x)
+/// returns x. Like -fno-signed-zeros, the sign of a zero result may change.
+template<typename T, af_op_t op>
+Node_ptr simplifyBinaryNode(const Node_ptr &lhs, const Node_ptr &rhs) {
+    switch (op) {
+        case af_add_t:
+            if (isScalarValue<T>(lhs, 0)) { return rhs; }
+            if (isScalarValue<T>(rhs, 0)) { return lhs; }
+            break;
+        case af_sub_t:
+            if (isScalarValue<T>(rhs, 0)) { return lhs; }
+            if (isScalarValue<T>(lhs, 0) && rhs->getOp() == af_sub_t &&
+                isScalarValue<T>(rhs->getChild(0), 0)) {
+                return rhs->getChild(1);
+            }
+            break;
+        case af_mul_t:
+            if (isScalarValue<T>(lhs, 1)) { return rhs; }
+            if (isScalarValue<T>(rhs, 1)) { return lhs; }
+            break;
+        case af_div_t:
+            if (isScalarValue<T>(rhs, 1)) { return lhs; }
+            break;
+        default: break;
+    }
+    return nullptr;
+}
+
+/// Returns a node that computes \p op on \p lhs and \p rhs
+///
+/// The node is simplified before it is created:
+/// - An operation on two ScalarNodes is computed once and replaced by the
+///   resulting ScalarNode
+/// - x + 0, x - 0, x * 1, x / 1 and -(-x) return x
+///
+/// A node that computes the same operation on the same children is reused.
+template<typename To, typename Ti, af_op_t op>
+Node_ptr createBinaryNode(Node_ptr lhs, Node_ptr rhs) {
+    if (lhs->isScalar() && rhs->isScalar()) {
+        Node_ptr node =
+            foldBinaryNode<To, Ti, op>(lhs, rhs, is_foldable<To, Ti>());
+        if (node) { return node; }
+    }
+
+    if (std::is_same<To, Ti>::value) {
+        if (Node_ptr node = simplifyBinaryNode<Ti, op>(lhs, rhs)) {
+            return node;
+        }
+    }
+
+    const af_dtype type = static_cast<af_dtype>(af::dtype_traits<To>::af_type);
+    NodeKey key(op, type, {{lhs, rhs}});
+    NodeCache &cache = NodeCache::getInstance();
+    if (Node_ptr node = cache.find(key)) { return node; }
+    return cache.insert(key, makeNode<BinaryNode<To, Ti, op>>(lhs, rhs));
+}
+
 }  // namespace jit
 
 }  // namespace cpu
@@ -8,6 +8,7 @@
  ********************************************************/
 
 #pragma once
+#include <jit/codegen.hpp>
 #include <optypes.hpp>
 #include <mutex>
 #include <vector>
@@ -29,7 +30,7 @@ class BufferNode : public TNode<T> {
     bool m_linear_buffer;
 
    public:
-    BufferNode() : TNode<T>(T(0), 0, {}) {}
+    BufferNode() : TNode<T>(0, {}) {}
 
     void setData(shared_ptr<T> data, unsigned bytes, dim_t data_off,
                  const dim_t *dims, const dim_t *strides,
@@ -47,7 +48,24 @@ class BufferNode : public TNode<T> {
         });
     }
 
-    void calc(int x, int y, int z, int w, int lim) final {
+    /// Returns true if the node reads \p data
+    bool holds(const shared_ptr<T> &data) const { return m_sptr == data; }
+
+    /// Returns the buffer of the node if the output of a tree with \p dims
+    /// can be written to it, or nullptr. Nothing but this node may hold the
+    /// buffer, and the node must read element i of the buffer for element i
+    /// of the output.
+    shared_ptr<T> getDonorBuffer(const dim_t *dims) const {
+        if (m_sptr.use_count() == 1 && m_ptr == m_sptr.get() &&
+            isLinear(dims)) {
+            return m_sptr;
+        }
+        return nullptr;
+    }
+
+    void calc(int x, int y, int z, int w, int lim, Chunk *out,
+              const Chunk *const *in) final {
+        UNUSED(in);
         using Tc = compute_t<T>;
 
         dim_t l_off = 0;
@@ -55,20 +73,67 @@ class BufferNode : public TNode<T> {
         l_off += (z < (int)m_dims[2]) * z * m_strides[2];
         l_off += (y < (int)m_dims[1]) * y * m_strides[1];
         T *in_ptr   = m_ptr + l_off;
-        Tc *out_ptr = this->m_val.data();
+        Tc *out_ptr = TNode<T>::values(out).data();
         for (int i = 0; i < lim; i++) {
             out_ptr[i] = in_ptr[((x + i) < m_dims[0]) ? (x + i) : 0];
         }
     }
 
-    void calc(int idx, int lim) final {
+    void calc(int idx, int lim, Chunk *out, const Chunk *const *in) final {
+        UNUSED(in);
         using Tc = compute_t<T>;
 
         T *in_ptr   = m_ptr + idx;
-        Tc *out_ptr = this->m_val.data();
+        Tc *out_ptr = TNode<T>::values(out).data();
         for (int i = 0; i < lim; i++) { out_ptr[i] = in_ptr[i]; }
     }
 
+    bool genKerName(std::stringstream &kerStream,
+                    const Node_ids &ids) const final {
+        UNUSED(ids);
+        if (!typeName<T>()) { return false; }
+        kerStream << "_B_" << typeName<T>();
+        return true;
+    }
+
+    void genParams(std::stringstream &kerStream, int id) const final {
+        kerStream << "const " << typeName<T>() << " *in" << id << " = (const "
+                  << typeName<T>() << " *)args[" << id << "].ptr;\n";
+    }
+
+    void genOffsets(std::stringstream &kerStream, int id,
+                    bool is_linear) const final {
+        if (is_linear) { return; }
+        std::string arg = "args[" + std::to_string(id) + "]";
+        kerStream << "const " << typeName<T>() << " *in" << id << "_row = in"
+                  << id << ";\n";
+        for (int i = 1; i < 4; i++) {
+            kerStream << "if (id" << i << " < " << arg << ".dims[" << i
+                      << "]) in" << id << "_row += id" << i << " * " << arg
+                      << ".strides[" << i << "];\n";
+        }
+    }
+
+    void genFuncs(std::stringstream &kerStream, const Node_ids &ids,
+                  bool is_linear) const final {
+        int id = ids.id;
+        kerStream << typeName<T>() << " val" << id << " = ";
+        if (is_linear) {
+            kerStream << "in" << id << "[idx];\n";
+        } else {
+            kerStream << "in" << id << "_row[id0 < args[" << id
+                      << "].dims[0] ? id0 : 0];\n";
+        }
+    }
+
+    void setArgs(KernelArg &arg) const final {
+        arg.ptr = m_ptr;
+        for (int i = 0; i < 4; i++) {
+            arg.dims[i]    = m_dims[i];
+            arg.strides[i] = m_strides[i];
+        }
+    }
+
     void getInfo(unsigned &len, unsigned &buf_count,
                  unsigned &bytes) const final {
         len++;
@@ -10,10 +10,16 @@
 #pragma once
 #include <common/defines.hpp>
 #include <common/half.hpp>
+#include <common/traits.hpp>
 #include <optypes.hpp>
+#include <af/defines.h>
+#include <af/traits.hpp>
 
 #include <array>
+#include <complex>
 #include <memory>
+#include <sstream>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -26,6 +32,7 @@ namespace cpu {
 
 namespace jit {
 class Node;
+struct Node_ids;
 constexpr int VECTOR_LENGTH = 256;
 
 using Node_ptr      = std::shared_ptr<Node>;
@@ -35,6 +42,47 @@ using Node_map_iter = Node_map_t::iterator;
 template<typename T>
 using array = std::array<T, VECTOR_LENGTH>;
 
+/// Storage for one VECTOR_LENGTH chunk of the values computed by a node.
+///
+/// The chunk is sized for the largest compute type so that the evaluation can
+/// allocate the scratch space of every node in a tree as a single vector.
+using Chunk = std::aligned_storage<
+    VECTOR_LENGTH * sizeof(std::complex<double>), 16>::type;
+
+/// The data of a node that is passed to a compiled kernel. The layout must
+/// match the KernelArg struct in the generated code (see jit.cpp)
+struct KernelArg {
+    const void *ptr;
+    dim_t dims[4];
+    dim_t strides[4];
+};
+
+/// The quantities the JIT cost model is based on
+///
+/// The counts of a node add up the counts of its children, so a subtree that
+/// is reached through several paths is counted once for each path. The
+/// counts saturate instead of wrapping around.
+struct JitCost {
+    size_t nodes   = 0;  // Nodes of the tree
+    size_t ops     = 0;  // Nodes that compute their values
+    size_t buffers = 0;  // Input buffers
+    size_t bytes   = 0;  // Bytes of the input buffers. Sub arrays count the
+                         // bytes of their parent.
+
+    JitCost &operator+=(const JitCost &other) {
+        nodes   = saturatingAdd(nodes, other.nodes);
+        ops     = saturatingAdd(ops, other.ops);
+        buffers = saturatingAdd(buffers, other.buffers);
+        bytes   = saturatingAdd(bytes, other.bytes);
+        return *this;
+    }
+
+   private:
+    static size_t saturatingAdd(size_t a, size_t b) {
+        return a + b < a ? static_cast<size_t>(-1) : a + b;
+    }
+};
+
 class Node {
    public:
     static const int kMaxChildren = 2;
@@ -42,43 +90,140 @@ class Node {
    protected:
     const int m_height;
     const std::array<Node_ptr, kMaxChildren> m_children;
+    JitCost m_children_cost;
     template<typename T>
     friend class common::NodeIterator;
 
    public:
     Node(const int height, const std::array<Node_ptr, kMaxChildren> children)
-        : m_height(height), m_children(children) {}
-
-    int getNodesMap(Node_map_t &node_map, std::vector<Node *> &full_nodes) {
-        auto iter = node_map.find(this);
-        if (iter == node_map.end()) {
-            for (auto &child : m_children) {
-                if (child == nullptr) break;
-                child->getNodesMap(node_map, full_nodes);
-            }
-            int id         = static_cast<int>(node_map.size());
-            node_map[this] = id;
-            full_nodes.push_back(this);
-            return id;
+        : m_height(height), m_children(children) {
+        for (int i = 0; i < kMaxChildren && m_children[i]; i++) {
+            // Binary operations of an array with itself read it once
+            if (i > 0 && m_children[i] == m_children[i - 1]) { continue; }
+            m_children_cost += m_children[i]->getCost();
         }
-        return iter->second;
     }
 
+    int getNodesMap(Node_map_t &node_map, std::vector<Node *> &full_nodes,
+                    std::vector<Node_ids> &full_ids);
+
     int getHeight() { return m_height; }
 
-    virtual void calc(int x, int y, int z, int w, int lim) {
+    /// Returns the cost of the tree rooted at this node without traversing
+    /// it. The cost of the children is added up when the node is created.
+    JitCost getCost() const {
+        JitCost cost = m_children_cost;
+        JitCost self;
+        self.nodes = 1;
+        if (isBuffer()) {
+            self.buffers = 1;
+            self.bytes   = getBytes();
+        } else if (!isScalar()) {
+            self.ops = 1;
+        }
+        return cost += self;
+    }
+
+    /// Returns the child at \p index or nullptr if the node has fewer children
+    const Node_ptr &getChild(int index) const { return m_children[index]; }
+
+    /// Returns the operation computed by the node. Buffers and scalars return
+    /// af_noop_t
+    virtual af_op_t getOp() const { return af_noop_t; }
+
+    /// Returns the type of the values computed by the node
+    virtual af_dtype getType() const = 0;
+
+    /// Returns true if the node is a ScalarNode
+    virtual bool isScalar() const { return false; }
+
+    /// Initializes the scratch chunk of this node before the evaluation
+    ///
+    /// Called once for every chunk of scratch space that will be passed to
+    /// calc. Nodes whose values do not change between chunks can write them
+    /// here instead of in calc.
+    virtual void init(Chunk *out) const { UNUSED(out); }
+
+    /// Computes the values of a chunk of a strided(non-linear) output
+    ///
+    /// \param[in]  x, y, z, w The position of the first element of the chunk
+    /// \param[in]  lim        The number of elements in the chunk
+    /// \param[out] out        The scratch chunk of this node
+    /// \param[in]  in         The scratch chunks of the children of this node
+    virtual void calc(int x, int y, int z, int w, int lim, Chunk *out,
+                      const Chunk *const *in) {
         UNUSED(x);
         UNUSED(y);
         UNUSED(z);
         UNUSED(w);
         UNUSED(lim);
+        UNUSED(out);
+        UNUSED(in);
     }
 
-    virtual void calc(int idx, int lim) {
+    /// Computes the values of a chunk of a linear output
+    ///
+    /// \param[in]  idx The linear index of the first element of the chunk
+    /// \param[in]  lim The number of elements in the chunk
+    /// \param[out] out The scratch chunk of this node
+    /// \param[in]  in  The scratch chunks of the children of this node
+    virtual void calc(int idx, int lim, Chunk *out, const Chunk *const *in) {
         UNUSED(idx);
         UNUSED(lim);
+        UNUSED(out);
+        UNUSED(in);
+    }
+
+    /// Generates the string that will be used to hash the compiled kernel
+    ///
+    /// \param[in/out] kerStream The string will be written to this stream
+    /// \param[in]     ids       The integer id of the node and its children
+    /// \returns false if the node can not be used in a compiled kernel
+    virtual bool genKerName(std::stringstream &kerStream,
+                            const Node_ids &ids) const {
+        UNUSED(kerStream);
+        UNUSED(ids);
+        return false;
+    }
+
+    /// Generates the code that reads the arguments of the node. The code is
+    /// placed before the loop over the elements of the kernel
+    ///
+    /// \param[in/out] kerStream The string will be written to this stream
+    /// \param[in]     id        The integer id of the node
+    virtual void genParams(std::stringstream &kerStream, int id) const {
+        UNUSED(kerStream);
+        UNUSED(id);
+    }
+
+    /// Generates the offsets of the node for the current row(id1, id2, id3)
+    /// of a strided kernel
+    ///
+    /// \param[in/out] kerStream The string will be written to this stream
+    /// \param[in]     id        The integer id of the node
+    /// \param[in]     is_linear True if the kernel is a linear kernel
+    virtual void genOffsets(std::stringstream &kerStream, int id,
+                            bool is_linear) const {
+        UNUSED(kerStream);
+        UNUSED(id);
+        UNUSED(is_linear);
     }
 
+    /// Generates the code that computes val<id> for the current element
+    ///
+    /// \param[in/out] kerStream The string will be written to this stream
+    /// \param[in]     ids       The integer id of the node and its children
+    /// \param[in]     is_linear True if the kernel is a linear kernel
+    virtual void genFuncs(std::stringstream &kerStream, const Node_ids &ids,
+                          bool is_linear) const {
+        UNUSED(kerStream);
+        UNUSED(ids);
+        UNUSED(is_linear);
+    }
+
+    /// Sets the argument of the node that is passed to the compiled kernel
+    virtual void setArgs(KernelArg &arg) const { UNUSED(arg); }
+
     virtual void getInfo(unsigned &len, unsigned &buf_count,
                          unsigned &bytes) const {
         UNUSED(buf_count);
@@ -96,16 +241,48 @@ class Node {
     virtual size_t getBytes() const { return 0; }
 };
 
+struct Node_ids {
+    std::array<int, Node::kMaxChildren> child_ids;
+    int id;
+};
+
+inline int Node::getNodesMap(Node_map_t &node_map,
+                             std::vector<Node *> &full_nodes,
+                             std::vector<Node_ids> &full_ids) {
+    auto iter = node_map.find(this);
+    if (iter == node_map.end()) {
+        Node_ids ids;
+        ids.child_ids.fill(-1);
+        for (int i = 0; i < kMaxChildren && m_children[i] != nullptr; i++) {
+            ids.child_ids[i] =
+                m_children[i]->getNodesMap(node_map, full_nodes, full_ids);
+        }
+        ids.id         = static_cast<int>(node_map.size());
+        node_map[this] = ids.id;
+        full_nodes.push_back(this);
+        full_ids.push_back(ids);
+        return ids.id;
+    }
+    return iter->second;
+}
+
 template<typename T>
 class TNode : public Node {
    public:
-    alignas(16) jit::array<compute_t<T>> m_val;
+    TNode(const int height, const std::array<Node_ptr, kMaxChildren> children)
+        : Node(height, children) {}
 
-   public:
-    TNode(T val, const int height,
-          const std::array<Node_ptr, kMaxChildren> children)
-        : Node(height, children) {
-        m_val.fill(val);
+    af_dtype getType() const final {
+        return static_cast<af_dtype>(af::dtype_traits<T>::af_type);
+    }
+
+    /// Interprets a scratch chunk as the values computed by a TNode<T>
+    static jit::array<compute_t<T>> &values(Chunk *chunk) {
+        return *reinterpret_cast<jit::array<compute_t<T>> *>(chunk);
+    }
+
+    static const jit::array<compute_t<T>> &values(const Chunk *chunk) {
+        return *reinterpret_cast<const jit::array<compute_t<T>> *>(chunk);
     }
 };
 
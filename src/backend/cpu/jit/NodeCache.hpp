@@ -0,0 +1,128 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <optypes.hpp>
+#include <af/defines.h>
+#include "Node.hpp"
+
+#include <array>
+#include <complex>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace cpu {
+
+namespace jit {
+
+/// Identifies the value computed by a node. Two nodes with the same key
+/// compute the same values because the nodes are immutable once they are
+/// created.
+struct NodeKey {
+    af_op_t op;
+    af_dtype type;
+    std::array<const Node *, Node::kMaxChildren> children;
+    std::array<char, sizeof(std::complex<double>)> value;
+
+    /// \param[in] op_       The operation of the node
+    /// \param[in] type_     The type of the values computed by the node
+    /// \param[in] children_ The children of the node
+    NodeKey(af_op_t op_, af_dtype type_,
+            const std::array<Node_ptr, Node::kMaxChildren> &children_)
+        : op(op_), type(type_) {
+        for (int i = 0; i < Node::kMaxChildren; i++) {
+            children[i] = children_[i].get();
+        }
+        value.fill(0);
+    }
+
+    /// Sets the value of a ScalarNode
+    template<typename T>
+    void setValue(const T &val) {
+        static_assert(sizeof(T) <= sizeof(value), "Value is too large");
+        std::memcpy(value.data(), &val, sizeof(T));
+    }
+
+    bool operator==(const NodeKey &other) const {
+        return op == other.op && type == other.type &&
+               children == other.children && value == other.value;
+    }
+};
+
+struct NodeKeyHash {
+    size_t operator()(const NodeKey &key) const {
+        // FNV-1a over the fields of the key
+        size_t hash = 14695981039346656037ULL;
+        auto combine = [&hash](const void *data, size_t bytes) {
+            const unsigned char *ptr = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < bytes; i++) {
+                hash = (hash ^ ptr[i]) * 1099511628211ULL;
+            }
+        };
+        combine(&key.op, sizeof(key.op));
+        combine(&key.type, sizeof(key.type));
+        combine(key.children.data(), sizeof(key.children));
+        combine(key.value.data(), key.value.size());
+        return hash;
+    }
+};
+
+/// Hash-consing table of the JIT nodes created by a thread
+///
+/// The nodes created by the arithmetic functions are looked up here first, so
+/// that an expression such as exp(x) * exp(x) refers to a single exp node and
+/// is computed once per element. The table only holds weak references. Nodes
+/// are destroyed once the arrays that use them are released.
+class NodeCache {
+   public:
+    static NodeCache &getInstance() {
+        thread_local NodeCache cache;
+        return cache;
+    }
+
+    /// Returns the live node with \p key or nullptr if there is none
+    Node_ptr find(const NodeKey &key) {
+        auto iter = nodes.find(key);
+        if (iter == nodes.end()) { return nullptr; }
+        return iter->second.lock();
+    }
+
+    /// Adds \p node to the table and returns it
+    Node_ptr insert(const NodeKey &key, Node_ptr node) {
+        if (nodes.size() >= sweep_size) {
+            // Remove the nodes that have been destroyed since the last sweep
+            for (auto iter = nodes.begin(); iter != nodes.end();) {
+                if (iter->second.expired()) {
+                    iter = nodes.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+            sweep_size = 2 * nodes.size();
+            if (sweep_size < kMinSweepSize) { sweep_size = kMinSweepSize; }
+        }
+        nodes[key] = node;
+        return node;
+    }
+
+   private:
+    static const size_t kMinSweepSize = 1024;
+
+    NodeCache() : sweep_size(kMinSweepSize) {}
+    NodeCache(NodeCache const &) = delete;
+    void operator=(NodeCache const &) = delete;
+
+    std::unordered_map<NodeKey, std::weak_ptr<Node>, NodeKeyHash> nodes;
+    size_t sweep_size;
+};
+
+}  // namespace jit
+
+}  // namespace cpu
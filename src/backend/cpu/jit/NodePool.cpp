@@ -0,0 +1,180 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <jit/NodePool.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+
+using std::lock_guard;
+using std::mutex;
+
+namespace cpu {
+
+namespace jit {
+
+namespace {
+
+/// The blocks are multiples of a cache line so that the nodes used by
+/// different threads do not share cache lines
+constexpr size_t BLOCK_ALIGN = 64;
+
+/// Nodes with their reference counts fit in the largest of the size classes
+constexpr size_t NUM_SIZE_CLASSES = 8;
+
+constexpr size_t MAX_BLOCK_SIZE = BLOCK_ALIGN * NUM_SIZE_CLASSES;
+
+/// The number of blocks allocated at once when the pool is empty
+constexpr size_t BLOCKS_PER_SLAB = 64;
+
+/// The number of blocks moved between a thread and the shared pool at once
+constexpr size_t BLOCKS_PER_TRANSFER = 64;
+
+/// A thread returns blocks to the shared pool when it holds more than this
+/// many blocks of a size class. Nodes are often released on the worker
+/// threads after they are evaluated.
+constexpr size_t MAX_THREAD_BLOCKS = 4 * BLOCKS_PER_TRANSFER;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+struct FreeList {
+    FreeBlock *head = nullptr;
+    size_t count    = 0;
+
+    void push(void *ptr) {
+        FreeBlock *block = static_cast<FreeBlock *>(ptr);
+        block->next      = head;
+        head             = block;
+        count++;
+    }
+
+    void *pop() {
+        FreeBlock *block = head;
+        head             = block->next;
+        count--;
+        return block;
+    }
+
+    /// Moves up to \p n blocks to \p other
+    void moveTo(FreeList &other, size_t n) {
+        for (size_t i = 0; i < n && head; i++) { other.push(pop()); }
+    }
+};
+
+/// The blocks released by threads that hold too many blocks or that exit.
+/// The slabs are never returned to the heap, so the pool is as large as the
+/// largest number of nodes that were alive at once.
+struct SharedPool {
+    mutex lists_mutex;
+    FreeList lists[NUM_SIZE_CLASSES];
+};
+
+SharedPool &sharedPool() {
+    // The pool is never destroyed because nodes are released while the
+    // static objects are destroyed
+    static SharedPool *pool = new SharedPool();
+    return *pool;
+}
+
+thread_local FreeList thread_lists[NUM_SIZE_CLASSES];
+
+/// Set once the blocks of the thread are returned to the shared pool. The
+/// nodes that the thread releases after that go to the shared pool directly.
+thread_local bool thread_closed = false;
+
+/// Returns the blocks of a thread to the shared pool when the thread exits
+struct ThreadListsFlusher {
+    ~ThreadListsFlusher() {
+        thread_closed    = true;
+        SharedPool &pool = sharedPool();
+        lock_guard<mutex> lock(pool.lists_mutex);
+        for (size_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+            thread_lists[i].moveTo(pool.lists[i], thread_lists[i].count);
+        }
+    }
+};
+
+void registerFlusher() {
+    thread_local ThreadListsFlusher flusher;
+    (void)flusher;
+}
+
+size_t sizeClass(size_t bytes) { return (bytes - 1) / BLOCK_ALIGN; }
+
+/// Adds the blocks of a new slab to \p list. The slab starts on a cache
+/// line, so every block does.
+void addSlab(FreeList &list, size_t size_class) {
+    const size_t block_size = (size_class + 1) * BLOCK_ALIGN;
+    const size_t slab_size  = BLOCKS_PER_SLAB * block_size;
+
+    // The slabs are never released, so the start of the allocation does not
+    // need to be kept
+    size_t space = slab_size + BLOCK_ALIGN - 1;
+    void *memory = ::operator new(space);
+    char *slab   = static_cast<char *>(
+        std::align(BLOCK_ALIGN, slab_size, memory, space));
+    for (size_t i = 0; i < BLOCKS_PER_SLAB; i++) {
+        list.push(slab + i * block_size);
+    }
+}
+
+}  // namespace
+
+void *allocateNode(size_t bytes) {
+    if (bytes > MAX_BLOCK_SIZE) { return ::operator new(bytes); }
+
+    const size_t size_class = sizeClass(bytes);
+    SharedPool &pool        = sharedPool();
+    if (thread_closed) {
+        lock_guard<mutex> lock(pool.lists_mutex);
+        FreeList &shared = pool.lists[size_class];
+        if (!shared.head) { addSlab(shared, size_class); }
+        return shared.pop();
+    }
+
+    FreeList &list = thread_lists[size_class];
+    if (!list.head) {
+        registerFlusher();
+        lock_guard<mutex> lock(pool.lists_mutex);
+        pool.lists[size_class].moveTo(list, BLOCKS_PER_TRANSFER);
+        if (!list.head) { addSlab(list, size_class); }
+    }
+    return list.pop();
+}
+
+void releaseNode(void *ptr, size_t bytes) noexcept {
+    if (bytes > MAX_BLOCK_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    const size_t size_class = sizeClass(bytes);
+    SharedPool &pool        = sharedPool();
+    if (thread_closed) {
+        lock_guard<mutex> lock(pool.lists_mutex);
+        pool.lists[size_class].push(ptr);
+        return;
+    }
+
+    FreeList &list = thread_lists[size_class];
+    if (!list.head) { registerFlusher(); }
+    list.push(ptr);
+    if (list.count > MAX_THREAD_BLOCKS) {
+        lock_guard<mutex> lock(pool.lists_mutex);
+        list.moveTo(pool.lists[size_class], BLOCKS_PER_TRANSFER);
+    }
+}
+
+}  // namespace jit
+
+}  // namespace cpu
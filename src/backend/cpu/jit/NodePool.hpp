@@ -0,0 +1,71 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace cpu {
+
+namespace jit {
+
+/// Returns a block of at least \p bytes for a node and its reference count
+///
+/// Blocks are taken from a free list of the calling thread. The lists are
+/// refilled from the blocks released by the other threads and from slabs
+/// that hold many blocks, so building a tree of nodes rarely calls the heap
+/// allocator. Blocks that are larger than the largest size class come from
+/// the heap.
+void *allocateNode(size_t bytes);
+
+/// Returns a block returned by allocateNode with the same \p bytes to the
+/// free list of the calling thread
+void releaseNode(void *ptr, size_t bytes) noexcept;
+
+/// An allocator for std::allocate_shared that draws the nodes from the pool
+template<typename T>
+struct NodeAllocator {
+    using value_type = T;
+
+    NodeAllocator() = default;
+
+    template<typename U>
+    NodeAllocator(const NodeAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(allocateNode(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, size_t n) noexcept {
+        releaseNode(ptr, n * sizeof(T));
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const NodeAllocator<T> &, const NodeAllocator<U> &) {
+    return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const NodeAllocator<T> &, const NodeAllocator<U> &) {
+    return false;
+}
+
+/// Creates a node in a single block from the pool
+template<typename T, typename... Args>
+std::shared_ptr<T> makeNode(Args &&... args) {
+    return std::allocate_shared<T>(NodeAllocator<T>(),
+                                   std::forward<Args>(args)...);
+}
+
+}  // namespace jit
+
+}  // namespace cpu
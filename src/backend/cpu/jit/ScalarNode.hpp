@@ -8,9 +8,13 @@
  ********************************************************/
 
 #pragma once
+#include <jit/codegen.hpp>
 #include <optypes.hpp>
+#include <type_traits>
 #include <vector>
 #include "Node.hpp"
+#include "NodeCache.hpp"
+#include "NodePool.hpp"
 
 namespace cpu {
 
@@ -18,9 +22,64 @@ namespace jit {
 
 template<typename T>
 class ScalarNode : public TNode<T> {
+   private:
+    const compute_t<T> m_val;
+
    public:
-    ScalarNode(T val) : TNode<T>(val, 0, {}) {}
+    ScalarNode(T val) : TNode<T>(0, {}), m_val(val) {}
+
+    const compute_t<T> &getValue() const { return m_val; }
+
+    bool isScalar() const final { return true; }
+
+    // The value of the node is the same for every chunk. Fill the scratch
+    // chunk once instead of in calc.
+    void init(Chunk *out) const final { TNode<T>::values(out).fill(m_val); }
+
+    bool genKerName(std::stringstream &kerStream,
+                    const Node_ids &ids) const final {
+        UNUSED(ids);
+        if (!typeName<T>()) { return false; }
+        kerStream << "_s_" << typeName<T>();
+        return true;
+    }
+
+    void genParams(std::stringstream &kerStream, int id) const final {
+        kerStream << "const " << typeName<T>() << " val" << id << " = *(const "
+                  << typeName<T>() << " *)args[" << id << "].ptr;\n";
+    }
+
+    void setArgs(KernelArg &arg) const final { arg.ptr = &m_val; }
 };
+
+/// True if the operations on ScalarNodes of the types can be computed when
+/// the graph is built. half is computed in float and is not folded because
+/// the result would be rounded to half.
+template<typename To, typename Ti>
+using is_foldable =
+    std::integral_constant<bool, std::is_same<compute_t<To>, To>::value &&
+                                     std::is_same<compute_t<Ti>, Ti>::value>;
+
+/// Returns true if \p node is a ScalarNode<T> whose value is \p value
+template<typename T>
+bool isScalarValue(const Node_ptr &node, double value) {
+    if (!node->isScalar()) { return false; }
+    const ScalarNode<T> *scalar =
+        reinterpret_cast<const ScalarNode<T> *>(node.get());
+    return scalar->getValue() == static_cast<compute_t<T>>(value);
+}
+
+/// Returns a ScalarNode with \p val. Nodes with the same value are shared.
+template<typename T>
+Node_ptr createScalarNode(T val) {
+    NodeKey key(af_noop_t, static_cast<af_dtype>(af::dtype_traits<T>::af_type),
+                {});
+    key.setValue(static_cast<compute_t<T>>(val));
+
+    NodeCache &cache = NodeCache::getInstance();
+    if (Node_ptr node = cache.find(key)) { return node; }
+    return cache.insert(key, makeNode<ScalarNode<T>>(val));
+}
 }  // namespace jit
 
 }  // namespace cpu
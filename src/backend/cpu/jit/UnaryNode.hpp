@@ -8,10 +8,17 @@
  ********************************************************/
 
 #pragma once
+#include <jit/codegen.hpp>
 #include <math.hpp>
 #include <optypes.hpp>
 #include "Node.hpp"
+#include "NodeCache.hpp"
+#include "NodePool.hpp"
+#include "ScalarNode.hpp"
 
+#include <limits>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace cpu {
@@ -28,27 +35,108 @@ template<typename To, typename Ti, af_op_t op>
 class UnaryNode : public TNode<To> {
    protected:
     UnOp<To, Ti, op> m_op;
-    TNode<Ti> *m_child;
 
    public:
-    UnaryNode(Node_ptr child)
-        : TNode<To>(To(0), child->getHeight() + 1, {{child}})
-        , m_child(reinterpret_cast<TNode<Ti> *>(child.get())) {}
+    UnaryNode(Node_ptr child) : TNode<To>(child->getHeight() + 1, {{child}}) {}
 
-    void calc(int x, int y, int z, int w, int lim) final {
+    af_op_t getOp() const final { return op; }
+
+    void calc(int x, int y, int z, int w, int lim, Chunk *out,
+              const Chunk *const *in) final {
         UNUSED(x);
         UNUSED(y);
         UNUSED(z);
         UNUSED(w);
-        m_op.eval(TNode<To>::m_val, m_child->m_val, lim);
+        m_op.eval(TNode<To>::values(out), TNode<Ti>::values(in[0]), lim);
     }
 
-    void calc(int idx, int lim) final {
+    void calc(int idx, int lim, Chunk *out, const Chunk *const *in) final {
         UNUSED(idx);
-        m_op.eval(TNode<To>::m_val, m_child->m_val, lim);
+        m_op.eval(TNode<To>::values(out), TNode<Ti>::values(in[0]), lim);
+    }
+
+    bool genKerName(std::stringstream &kerStream,
+                    const Node_ids &ids) const final {
+        if (!typeName<To>() || !typeName<Ti>() ||
+            unaryOpStr<To, Ti>(op, "").empty()) {
+            return false;
+        }
+        kerStream << "_u" << op << "_" << typeName<To>() << "_"
+                  << typeName<Ti>() << "_" << ids.child_ids[0];
+        return true;
+    }
+
+    void genFuncs(std::stringstream &kerStream, const Node_ids &ids,
+                  bool is_linear) const final {
+        UNUSED(is_linear);
+        std::string in = "val" + std::to_string(ids.child_ids[0]);
+        kerStream << typeName<To>() << " val" << ids.id << " = static_cast<"
+                  << typeName<To>() << ">(" << unaryOpStr<To, Ti>(op, in)
+                  << ");\n";
     }
 };
 
+/// True if every value of From can be cast to To and back without a change.
+/// Only the arithmetic types are considered. b8(char) is excluded because the
+/// cast to b8 compares with zero instead of converting the value.
+template<typename From, typename To>
+struct is_lossless_cast
+    : std::integral_constant<
+          bool,
+          std::is_arithmetic<From>::value && std::is_arithmetic<To>::value &&
+              !std::is_same<From, char>::value &&
+              (std::is_floating_point<To>::value ||
+               !std::is_floating_point<From>::value) &&
+              (std::is_signed<To>::value || !std::is_signed<From>::value) &&
+              std::numeric_limits<To>::digits >=
+                  std::numeric_limits<From>::digits &&
+              std::numeric_limits<To>::max_exponent >=
+                  std::numeric_limits<From>::max_exponent> {};
+
+/// Computes \p op on the value of the ScalarNode \p in once
+template<typename To, typename Ti, af_op_t op>
+Node_ptr foldUnaryNode(const Node_ptr &in, std::true_type) {
+    jit::array<To> out;
+    jit::array<Ti> val;
+    val[0] = reinterpret_cast<const ScalarNode<Ti> *>(in.get())->getValue();
+    UnOp<To, Ti, op> unary_op;
+    unary_op.eval(out, val, 1);
+    return createScalarNode<To>(out[0]);
+}
+
+template<typename To, typename Ti, af_op_t op>
+Node_ptr foldUnaryNode(const Node_ptr &in, std::false_type) {
+    UNUSED(in);
+    return nullptr;
+}
+
+/// Returns a node that computes \p op on \p in
+///
+/// The node is simplified before it is created:
+/// - An operation on a ScalarNode is computed once and replaced by the
+///   resulting ScalarNode
+/// - A cast to To of a lossless cast from To returns the original node
+///
+/// A node that computes the same operation on the same child is reused.
+template<typename To, typename Ti, af_op_t op>
+Node_ptr createUnaryNode(Node_ptr in) {
+    if (in->isScalar()) {
+        Node_ptr node = foldUnaryNode<To, Ti, op>(in, is_foldable<To, Ti>());
+        if (node) { return node; }
+    }
+
+    const af_dtype type = static_cast<af_dtype>(af::dtype_traits<To>::af_type);
+    if (op == af_cast_t && is_lossless_cast<To, Ti>::value &&
+        in->getOp() == af_cast_t && in->getChild(0)->getType() == type) {
+        return in->getChild(0);
+    }
+
+    NodeKey key(op, type, {{in}});
+    NodeCache &cache = NodeCache::getInstance();
+    if (Node_ptr node = cache.find(key)) { return node; }
+    return cache.insert(key, makeNode<UnaryNode<To, Ti, op>>(in));
+}
+
 }  // namespace jit
 
 }  // namespace cpu
@@ -0,0 +1,209 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <common/half.hpp>
+#include <optypes.hpp>
+#include <types.hpp>
+
+#include <complex>
+#include <string>
+#include <type_traits>
+
+/// Helpers that map the operations of the CPU JIT nodes to the C++ code used
+/// by the compiled kernels. The generated code must produce the same values
+/// as the BinOp and UnOp functors. Operations that return an empty string are
+/// not supported by the compiled kernels and the tree will be interpreted.
+namespace cpu {
+namespace jit {
+
+template<typename T>
+struct is_complex : std::false_type {};
+template<typename T>
+struct is_complex<std::complex<T>> : std::true_type {};
+
+/// Returns the name of the type in the generated code. Returns nullptr for
+/// types that can not be used in a compiled kernel
+template<typename T>
+inline const char *typeName() {
+    return nullptr;
+}
+
+#define TYPE_NAME(T, NAME)             \
+    template<>                         \
+    inline const char *typeName<T>() { \
+        return NAME;                   \
+    }
+
+TYPE_NAME(float, "float")
+TYPE_NAME(double, "double")
+TYPE_NAME(cfloat, "std::complex<float>")
+TYPE_NAME(cdouble, "std::complex<double>")
+TYPE_NAME(int, "int")
+TYPE_NAME(uint, "unsigned int")
+TYPE_NAME(char, "char")
+TYPE_NAME(uchar, "unsigned char")
+TYPE_NAME(short, "short")
+TYPE_NAME(ushort, "unsigned short")
+TYPE_NAME(intl, "long long")
+TYPE_NAME(uintl, "unsigned long long")
+
+#undef TYPE_NAME
+
+/// Returns the code that computes \p op on \p lhs and \p rhs
+template<typename To, typename Ti>
+std::string binaryOpStr(af_op_t op, const std::string &lhs,
+                        const std::string &rhs) {
+    const bool cplx  = is_complex<Ti>::value;
+    const bool real  = std::is_floating_point<Ti>::value;
+    const bool integ = std::is_integral<Ti>::value;
+
+    auto infix = [&](const char *sym) { return lhs + sym + rhs; };
+    auto func  = [&](const char *fn) {
+        return std::string(fn) + "(" + lhs + ", " + rhs + ")";
+    };
+
+    // See BinOp<To, Ti, af_cplx2_t> in complex.hpp
+    if (op == af_cplx2_t) {
+        return is_complex<To>::value && !cplx ? func(typeName<To>())
+                                               : std::string("");
+    }
+
+    switch (op) {
+        case af_add_t: return infix(" + ");
+        case af_sub_t: return infix(" - ");
+        case af_mul_t: return infix(" * ");
+        case af_div_t: return infix(" / ");
+        case af_eq_t: return infix(" == ");
+        case af_neq_t: return infix(" != ");
+        default: break;
+    }
+
+    // The remaining operations on complex numbers compare magnitudes or are
+    // not defined
+    if (cplx) { return ""; }
+
+    switch (op) {
+        case af_lt_t: return infix(" < ");
+        case af_gt_t: return infix(" > ");
+        case af_le_t: return infix(" <= ");
+        case af_ge_t: return infix(" >= ");
+        case af_and_t: return infix(" && ");
+        case af_or_t: return infix(" || ");
+        case af_min_t: return func("std::min");
+        case af_max_t: return func("std::max");
+        case af_pow_t: return func("std::pow");
+        case af_mod_t: return func("__mod");
+        case af_rem_t: return func("__rem");
+        default: break;
+    }
+
+    if (integ) {
+        switch (op) {
+            case af_bitor_t: return infix(" | ");
+            case af_bitand_t: return infix(" & ");
+            case af_bitxor_t: return infix(" ^ ");
+            case af_bitshiftl_t: return infix(" << ");
+            case af_bitshiftr_t: return infix(" >> ");
+            default: return "";
+        }
+    }
+
+    if (real) {
+        switch (op) {
+            case af_atan2_t: return func("std::atan2");
+            case af_hypot_t: return func("std::hypot");
+            default: return "";
+        }
+    }
+    return "";
+}
+
+/// Returns the code that computes \p op on \p in
+template<typename To, typename Ti>
+std::string unaryOpStr(af_op_t op, const std::string &in) {
+    const bool cplx = is_complex<Ti>::value;
+    const bool real = std::is_floating_point<Ti>::value;
+    const bool sign = std::is_signed<Ti>::value;
+
+    auto func = [&](const char *fn) {
+        return std::string(fn) + "(" + in + ")";
+    };
+
+    if (op == af_cast_t) {
+        if (cplx && !is_complex<To>::value) { return func("std::abs"); }
+        // See CAST_B8 in cast.hpp
+        if (std::is_same<To, char>::value &&
+            (std::is_same<Ti, float>::value ||
+             std::is_same<Ti, double>::value || std::is_same<Ti, int>::value ||
+             std::is_same<Ti, uchar>::value || std::is_same<Ti, char>::value)) {
+            return "(" + in + " != 0)";
+        }
+        return in;
+    }
+
+    switch (op) {
+        case af_real_t: return func("std::real");
+        case af_imag_t: return func("std::imag");
+        case af_conj_t: return func("std::conj");
+        case af_abs_t:
+            return (cplx || sign) ? func("std::abs") : std::string("");
+        default: break;
+    }
+
+    if (cplx) { return ""; }
+
+    switch (op) {
+        case af_isinf_t: return func("std::isinf");
+        case af_isnan_t: return func("std::isnan");
+        case af_iszero_t: return "(" + in + " == 0)";
+        default: break;
+    }
+
+    if (!real) { return ""; }
+
+    switch (op) {
+        case af_sin_t: return func("std::sin");
+        case af_cos_t: return func("std::cos");
+        case af_tan_t: return func("std::tan");
+        case af_asin_t: return func("std::asin");
+        case af_acos_t: return func("std::acos");
+        case af_atan_t: return func("std::atan");
+        case af_sinh_t: return func("std::sinh");
+        case af_cosh_t: return func("std::cosh");
+        case af_tanh_t: return func("std::tanh");
+        case af_asinh_t: return func("std::asinh");
+        case af_acosh_t: return func("std::acosh");
+        case af_atanh_t: return func("std::atanh");
+        case af_round_t: return func("std::round");
+        case af_trunc_t: return func("std::trunc");
+        case af_signbit_t: return func("std::signbit");
+        case af_floor_t: return func("std::floor");
+        case af_ceil_t: return func("std::ceil");
+        case af_exp_t: return func("std::exp");
+        case af_expm1_t: return func("std::expm1");
+        case af_erf_t: return func("std::erf");
+        case af_erfc_t: return func("std::erfc");
+        case af_log_t: return func("std::log");
+        case af_log10_t: return func("std::log10");
+        case af_log1p_t: return func("std::log1p");
+        case af_log2_t: return func("std::log2");
+        case af_sqrt_t: return func("std::sqrt");
+        case af_cbrt_t: return func("std::cbrt");
+        case af_tgamma_t: return func("std::tgamma");
+        case af_lgamma_t: return func("std::lgamma");
+        // See sigmoid and rsqrt in unary.hpp
+        case af_sigmoid_t: return "(1.0) / (1 + std::exp(-" + in + "))";
+        case af_rsqrt_t: return "std::pow(" + in + ", -0.5)";
+        default: return "";
+    }
+}
+
+}  // namespace jit
+}  // namespace cpu
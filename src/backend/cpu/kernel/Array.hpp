@@ -9,13 +9,74 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
+#include <jit.hpp>
 #include <jit/Node.hpp>
+#include <jit/codegen.hpp>
 #include <platform.hpp>
+#include <thread_pool.hpp>
+#include <types.hpp>
+
+#include <algorithm>
+#include <array>
 #include <vector>
 
 namespace cpu {
 namespace kernel {
 
+/// The smallest number of chunks that is evaluated by a single thread
+constexpr dim_t JIT_CHUNKS_PER_TASK = 16;
+
+/// Evaluates the nodes of a JIT tree one chunk at a time
+///
+/// The nodes are shared between the threads so each thread evaluates the tree
+/// with its own instance of this class, which holds the values of the nodes.
+class NodeScratch {
+   public:
+    /// \param[in] nodes The nodes of the tree returned by getNodesMap
+    /// \param[in] ids   The ids of the nodes returned by getNodesMap
+    NodeScratch(const std::vector<jit::Node *> &nodes,
+                const std::vector<jit::Node_ids> &ids)
+        : m_nodes(nodes), m_scratch(nodes.size()), m_inputs(nodes.size()) {
+        for (size_t n = 0; n < nodes.size(); n++) {
+            for (int c = 0; c < jit::Node::kMaxChildren; c++) {
+                int cid        = ids[n].child_ids[c];
+                m_inputs[n][c] = cid < 0 ? nullptr : &m_scratch[cid];
+            }
+            nodes[n]->init(&m_scratch[n]);
+        }
+    }
+
+    /// Computes the chunk of every node that starts at \p idx of a linear
+    /// output
+    void calc(int idx, int lim) {
+        for (size_t n = 0; n < m_nodes.size(); n++) {
+            m_nodes[n]->calc(idx, lim, &m_scratch[n], m_inputs[n].data());
+        }
+    }
+
+    /// Computes the chunk of every node that starts at (\p x, \p y, \p z,
+    /// \p w) of a strided output
+    void calc(int x, int y, int z, int w, int lim) {
+        for (size_t n = 0; n < m_nodes.size(); n++) {
+            m_nodes[n]->calc(x, y, z, w, lim, &m_scratch[n],
+                             m_inputs[n].data());
+        }
+    }
+
+    /// Returns the values of the last chunk computed by the node \p id
+    template<typename T>
+    const jit::array<compute_t<T>> &values(int id) const {
+        return jit::TNode<T>::values(&m_scratch[id]);
+    }
+
+   private:
+    const std::vector<jit::Node *> &m_nodes;
+    std::vector<jit::Chunk> m_scratch;
+    std::vector<std::array<const jit::Chunk *, jit::Node::kMaxChildren>>
+        m_inputs;
+};
+
 template<typename T>
 void evalMultiple(std::vector<Param<T>> arrays,
                   std::vector<jit::Node_ptr> output_nodes_) {
@@ -24,64 +85,95 @@ void evalMultiple(std::vector<Param<T>> arrays,
 
     jit::Node_map_t nodes;
     std::vector<T *> ptrs;
-    std::vector<jit::TNode<T> *> output_nodes;
+    std::vector<int> output_ids;
     std::vector<jit::Node *> full_nodes;
+    std::vector<jit::Node_ids> full_ids;
 
     int narrays = static_cast<int>(arrays.size());
     for (int i = 0; i < narrays; i++) {
         ptrs.push_back(arrays[i].get());
-        output_nodes.push_back(
-            reinterpret_cast<jit::TNode<T> *>(output_nodes_[i].get()));
-        output_nodes_[i]->getNodesMap(nodes, full_nodes);
+        output_ids.push_back(
+            output_nodes_[i]->getNodesMap(nodes, full_nodes, full_ids));
     }
 
     bool is_linear = true;
     for (auto node : full_nodes) { is_linear &= node->isLinear(odims.get()); }
 
-    if (is_linear) {
-        int num = arrays[0].dims().elements();
-        int cnum =
-            jit::VECTOR_LENGTH * std::ceil(double(num) / jit::VECTOR_LENGTH);
-        for (int i = 0; i < cnum; i += jit::VECTOR_LENGTH) {
-            int lim = std::min(jit::VECTOR_LENGTH, num - i);
-            for (int n = 0; n < (int)full_nodes.size(); n++) {
-                full_nodes[n]->calc(i, lim);
+    const int num_nodes = static_cast<int>(full_nodes.size());
+
+    if (jit::isCompileEnabled()) {
+        jit::KernelFunc func =
+            jit::getKernel(jit::typeName<T>(), full_nodes, full_ids,
+                           output_ids, is_linear);
+        if (func) {
+            std::vector<jit::KernelArg> args(num_nodes);
+            for (int n = 0; n < num_nodes; n++) {
+                full_nodes[n]->setArgs(args[n]);
             }
-            for (int n = 0; n < (int)output_nodes.size(); n++) {
-                std::copy(output_nodes[n]->m_val.begin(),
-                          output_nodes[n]->m_val.begin() + lim, ptrs[n] + i);
+            std::vector<void *> outs(ptrs.begin(), ptrs.end());
+
+            // The compiled kernels work on elements or rows instead of chunks
+            const dim_t grain = JIT_CHUNKS_PER_TASK * jit::VECTOR_LENGTH;
+            dim_t count       = odims.elements();
+            dim_t row_grain   = grain;
+            if (!is_linear) {
+                count     = odims[1] * odims[2] * odims[3];
+                row_grain = std::max(dim_t(1), grain / odims[0]);
             }
+            threadPool().parallel_for(
+                count, row_grain, [&](dim_t begin, dim_t end) {
+                    func(args.data(), outs.data(), odims.get(), ostrs.get(),
+                         begin, end);
+                });
+            return;
         }
-    } else {
-        for (int w = 0; w < (int)odims[3]; w++) {
-            dim_t offw = w * ostrs[3];
-
-            for (int z = 0; z < (int)odims[2]; z++) {
-                dim_t offz = z * ostrs[2] + offw;
-
-                for (int y = 0; y < (int)odims[1]; y++) {
-                    dim_t offy = y * ostrs[1] + offz;
-
-                    int dim0  = odims[0];
-                    int cdim0 = jit::VECTOR_LENGTH *
-                                std::ceil(double(dim0) / jit::VECTOR_LENGTH);
-                    for (int x = 0; x < (int)cdim0; x += jit::VECTOR_LENGTH) {
-                        int lim  = std::min(jit::VECTOR_LENGTH, dim0 - x);
-                        dim_t id = x + offy;
-
-                        for (int n = 0; n < (int)full_nodes.size(); n++) {
-                            full_nodes[n]->calc(x, y, z, w, lim);
-                        }
-                        for (int n = 0; n < (int)output_nodes.size(); n++) {
-                            std::copy(output_nodes[n]->m_val.begin(),
-                                      output_nodes[n]->m_val.begin() + lim,
-                                      ptrs[n] + id);
-                        }
-                    }
+    }
+
+    // Evaluates the chunks in the range [begin, end)
+    auto evalChunks = [&](dim_t begin, dim_t end, dim_t chunks_per_row) {
+        NodeScratch scratch(full_nodes, full_ids);
+
+        for (dim_t chunk = begin; chunk < end; chunk++) {
+            if (is_linear) {
+                int num = odims.elements();
+                int i   = static_cast<int>(chunk * jit::VECTOR_LENGTH);
+                int lim = std::min(jit::VECTOR_LENGTH, num - i);
+                scratch.calc(i, lim);
+                for (int n = 0; n < narrays; n++) {
+                    const auto &val = scratch.values<T>(output_ids[n]);
+                    std::copy(val.begin(), val.begin() + lim, ptrs[n] + i);
+                }
+            } else {
+                dim_t row = chunk / chunks_per_row;
+                int x     = static_cast<int>((chunk % chunks_per_row) *
+                                         jit::VECTOR_LENGTH);
+                int y     = static_cast<int>(row % odims[1]);
+                int z     = static_cast<int>((row / odims[1]) % odims[2]);
+                int w     = static_cast<int>(row / (odims[1] * odims[2]));
+                int lim   = std::min(jit::VECTOR_LENGTH, int(odims[0]) - x);
+                dim_t id  = x + y * ostrs[1] + z * ostrs[2] + w * ostrs[3];
+                scratch.calc(x, y, z, w, lim);
+                for (int n = 0; n < narrays; n++) {
+                    const auto &val = scratch.values<T>(output_ids[n]);
+                    std::copy(val.begin(), val.begin() + lim, ptrs[n] + id);
                 }
             }
         }
-    }
+    };
+
+    // The linear path walks the whole output in chunks. The strided path
+    // walks each row of the first dimension in chunks.
+    dim_t chunks_per_row =
+        is_linear ? divup(odims.elements(), jit::VECTOR_LENGTH)
+                  : divup(odims[0], jit::VECTOR_LENGTH);
+    dim_t num_chunks =
+        is_linear ? chunks_per_row
+                  : chunks_per_row * odims[1] * odims[2] * odims[3];
+
+    threadPool().parallel_for(num_chunks, JIT_CHUNKS_PER_TASK,
+                              [&](dim_t begin, dim_t end) {
+                                  evalChunks(begin, end, chunks_per_row);
+                              });
 }
 
 template<typename T>
@@ -154,5 +154,26 @@ void copy(Param<OutT> dst, CParam<InT> src) {
     CopyImpl<OutT, InT>::copy(dst, src);
 }
 
+/// Copies the elements of \p src to the host buffer \p dst in column major
+/// order
+template<typename T>
+void copyToHost(T* dst, CParam<T> src) {
+    const af::dim4 dims    = src.dims();
+    const af::dim4 strides = src.strides();
+    const af::dim4 ostrides(1, dims[0], dims[0] * dims[1],
+                            dims[0] * dims[1] * dims[2]);
+    if (strides == ostrides) {
+        std::memcpy(dst, src.get(), dims.elements() * sizeof(T));
+    } else {
+        stridedCopy<T>(dst, ostrides, src.get(), dims, strides, 3);
+    }
+}
+
+/// Copies \p bytes bytes of the host buffer \p src to \p dst
+template<typename T>
+void copyFromHost(Param<T> dst, const T* src, size_t bytes) {
+    std::memcpy(dst.get(), src, bytes);
+}
+
 }  // namespace kernel
 }  // namespace cpu
@@ -9,29 +9,51 @@
 
 #pragma once
 #include <Param.hpp>
-#include <ops.hpp>
+#include <common/dispatch.hpp>
 #include <common/half.hpp>
+#include <jit/Node.hpp>
+#include <kernel/Array.hpp>
+#include <ops.hpp>
+#include <platform.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
 
+// The minimum number of input elements reduced by a task
+constexpr dim_t REDUCE_MIN_TASK_WORK = 16384;
+
 template<af_op_t op, typename Ti, typename To, int D>
 struct reduce_dim {
     void operator()(Param<To> out, const dim_t outOffset, CParam<Ti> in,
                     const dim_t inOffset, const int dim, bool change_nan,
                     double nanval) {
         static const int D1 = D - 1;
-        reduce_dim<op, Ti, To, D1> reduce_dim_next;
 
         const af::dim4 ostrides = out.strides();
         const af::dim4 istrides = in.strides();
         const af::dim4 odims    = out.dims();
 
-        for (dim_t i = 0; i < odims[D1]; i++) {
-            reduce_dim_next(out, outOffset + i * ostrides[D1], in,
-                            inOffset + i * istrides[D1], dim, change_nan,
-                            nanval);
-        }
+        // Each output element is reduced by a single thread so the result
+        // does not depend on the number of threads. The outer dimensions are
+        // split across the pool and the inner dimensions are split again by
+        // the nested calls when there are few outer elements.
+        dim_t item_work = in.dims()[dim];
+        for (int i = 0; i < D1; i++) { item_work *= odims[i]; }
+        const dim_t grain = divup(REDUCE_MIN_TASK_WORK, item_work);
+
+        threadPool().parallel_for(
+            odims[D1], grain, [&](dim_t begin, dim_t end) {
+                reduce_dim<op, Ti, To, D1> reduce_dim_next;
+                for (dim_t i = begin; i < end; i++) {
+                    reduce_dim_next(out, outOffset + i * ostrides[D1], in,
+                                    inOffset + i * istrides[D1], dim,
+                                    change_nan, nanval);
+                }
+            });
     }
 };
 
@@ -60,5 +82,217 @@ struct reduce_dim<op, Ti, To, 0> {
     }
 };
 
+/// Reduces the values of a JIT tree along \p dim without writing them to
+/// memory
+///
+/// The tree is evaluated one chunk at a time and each chunk is reduced while
+/// it is in cache. The elements are reduced in the same order as reduce_dim.
+///
+/// \param[out] out   The reduced values
+/// \param[in]  node  The root of the tree
+/// \param[in]  idims The dimensions of the values computed by the tree
+template<af_op_t op, typename Ti, typename To>
+void reduce_dim_node(Param<To> out, jit::Node_ptr node, const af::dim4 idims,
+                     const int dim, bool change_nan, double nanval) {
+    jit::Node_map_t node_map;
+    std::vector<jit::Node *> full_nodes;
+    std::vector<jit::Node_ids> full_ids;
+    const int output_id = node->getNodesMap(node_map, full_nodes, full_ids);
+
+    const af::dim4 odims    = out.dims();
+    const af::dim4 ostrides = out.strides();
+    const dim_t chunks_per_row =
+        dim == 0 ? 1 : divup(odims[0], jit::VECTOR_LENGTH);
+    const dim_t num_rows = odims[1] * odims[2] * odims[3];
+
+    // The work of a task is a whole row of dim 0 or a chunk of the output
+    // reduced along dim
+    const dim_t item_work =
+        dim == 0 ? idims[0] : jit::VECTOR_LENGTH * idims[dim];
+    const dim_t grain = divup(REDUCE_MIN_TASK_WORK, item_work);
+
+    threadPool().parallel_for(
+        num_rows * chunks_per_row, grain, [&](dim_t begin, dim_t end) {
+            Transform<Ti, compute_t<To>, op> transform;
+            Binary<compute_t<To>, op> reduce;
+            NodeScratch scratch(full_nodes, full_ids);
+            jit::array<compute_t<To>> out_vals;
+
+            for (dim_t item = begin; item < end; item++) {
+                dim_t row = item / chunks_per_row;
+                int pos[4];
+                pos[0] = static_cast<int>((item % chunks_per_row) *
+                                          jit::VECTOR_LENGTH);
+                pos[1] = static_cast<int>(row % odims[1]);
+                pos[2] = static_cast<int>((row / odims[1]) % odims[2]);
+                pos[3] = static_cast<int>(row / (odims[1] * odims[2]));
+
+                // Along dim 0 the chunks of a row are reduced into one value.
+                // Along the other dims each element of the chunk is reduced
+                // into its own value.
+                const int lim =
+                    dim == 0 ? jit::VECTOR_LENGTH
+                             : std::min(jit::VECTOR_LENGTH,
+                                        static_cast<int>(odims[0]) - pos[0]);
+                const int num_out = dim == 0 ? 1 : lim;
+                std::fill(out_vals.begin(), out_vals.begin() + num_out,
+                          Binary<compute_t<To>, op>::init());
+
+                for (dim_t i = 0; i < idims[dim];) {
+                    int chunk_lim = lim;
+                    if (dim == 0) {
+                        pos[0]    = static_cast<int>(i);
+                        chunk_lim = static_cast<int>(
+                            std::min<dim_t>(jit::VECTOR_LENGTH, idims[0] - i));
+                    } else {
+                        pos[dim] = static_cast<int>(i);
+                    }
+                    scratch.calc(pos[0], pos[1], pos[2], pos[3], chunk_lim);
+
+                    const auto &vals = scratch.values<Ti>(output_id);
+                    for (int j = 0; j < chunk_lim; j++) {
+                        compute_t<To> in_val = transform(Ti(vals[j]));
+                        if (change_nan) {
+                            in_val = IS_NAN(in_val) ? nanval : in_val;
+                        }
+                        compute_t<To> &out_val = out_vals[dim == 0 ? 0 : j];
+                        out_val = reduce(in_val, out_val);
+                    }
+                    i += dim == 0 ? chunk_lim : 1;
+                }
+
+                if (dim == 0) { pos[0] = 0; }
+                pos[dim]   = 0;
+                To *outPtr = out.get() + pos[0] + pos[1] * ostrides[1] +
+                             pos[2] * ostrides[2] + pos[3] * ostrides[3];
+                for (int j = 0; j < num_out; j++) {
+                    outPtr[j] = data_t<To>(out_vals[j]);
+                }
+            }
+        });
+}
+
+/// Splits the elements of an array into blocks of chunks for reduce_all
+///
+/// A chunk is up to VECTOR_LENGTH elements of a row of dim 0. The size of a
+/// block depends only on the dimensions, and the results of the blocks are
+/// combined in order, so the result does not depend on the number of
+/// threads.
+struct ReduceAllBlocks {
+    explicit ReduceAllBlocks(const af::dim4 &idims)
+        : dims(idims)
+        , chunks_per_row(divup(idims[0], jit::VECTOR_LENGTH))
+        , num_chunks(chunks_per_row * idims[1] * idims[2] * idims[3])
+        , chunks_per_block(divup(REDUCE_MIN_TASK_WORK,
+                                 std::max<dim_t>(1, std::min<dim_t>(
+                                                        jit::VECTOR_LENGTH,
+                                                        idims[0]))))
+        , num_blocks(divup(num_chunks, chunks_per_block)) {}
+
+    /// Sets the position of the first element of the chunk \p index and
+    /// returns the number of elements in the chunk
+    int chunk(dim_t index, int pos[4]) const {
+        const dim_t row  = index / chunks_per_row;
+        const dim_t col  = index % chunks_per_row;
+        pos[0]           = static_cast<int>(col * jit::VECTOR_LENGTH);
+        pos[1]           = static_cast<int>(row % dims[1]);
+        pos[2]           = static_cast<int>((row / dims[1]) % dims[2]);
+        pos[3]           = static_cast<int>(row / (dims[1] * dims[2]));
+        return static_cast<int>(
+            std::min<dim_t>(jit::VECTOR_LENGTH, dims[0] - pos[0]));
+    }
+
+    /// Calls \p func(first, last, result) on the thread pool for the chunks
+    /// [first, last) of each block and combines the results
+    template<typename T, typename Reduce, typename Func>
+    T reduce(Reduce &combine, const Func &func) const {
+        std::vector<T> results(num_blocks);
+        threadPool().parallel_for(num_blocks, 1, [&](dim_t begin, dim_t end) {
+            for (dim_t block = begin; block < end; block++) {
+                const dim_t first = block * chunks_per_block;
+                func(first, std::min(num_chunks, first + chunks_per_block),
+                     results[block]);
+            }
+        });
+        T out = Reduce::init();
+        for (const T &result : results) { out = combine(result, out); }
+        return out;
+    }
+
+    const af::dim4 dims;
+    const dim_t chunks_per_row;
+    const dim_t num_chunks;
+    const dim_t chunks_per_block;
+    const dim_t num_blocks;
+};
+
+/// Reduces all the values of an array into \p out
+template<af_op_t op, typename Ti, typename To>
+void reduce_all(compute_t<To> *out, CParam<Ti> in, bool change_nan,
+                double nanval) {
+    const af::dim4 strides = in.strides();
+    const ReduceAllBlocks blocks(in.dims());
+
+    Binary<To, op> combine;
+    *out = blocks.reduce<compute_t<To>>(
+        combine, [&](dim_t first, dim_t last, compute_t<To> &result) {
+            Transform<Ti, To, op> transform;
+            Binary<To, op> reduce;
+            result = Binary<To, op>::init();
+            for (dim_t c = first; c < last; c++) {
+                int pos[4];
+                const int lim   = blocks.chunk(c, pos);
+                const Ti *inPtr = in.get() + pos[0] * strides[0] +
+                                  pos[1] * strides[1] + pos[2] * strides[2] +
+                                  pos[3] * strides[3];
+                for (int j = 0; j < lim; j++) {
+                    compute_t<To> in_val = transform(inPtr[j * strides[0]]);
+                    if (change_nan) {
+                        in_val = IS_NAN(in_val) ? nanval : in_val;
+                    }
+                    result = reduce(in_val, result);
+                }
+            }
+        });
+}
+
+/// Reduces all the values of a JIT tree into \p out without writing them to
+/// memory
+///
+/// The elements are reduced in the same order and with the same types as
+/// reduce_all
+template<af_op_t op, typename Ti, typename To>
+void reduce_all_node(compute_t<To> *out, jit::Node_ptr node,
+                     const af::dim4 idims, bool change_nan, double nanval) {
+    jit::Node_map_t node_map;
+    std::vector<jit::Node *> full_nodes;
+    std::vector<jit::Node_ids> full_ids;
+    const int output_id = node->getNodesMap(node_map, full_nodes, full_ids);
+    const ReduceAllBlocks blocks(idims);
+
+    Binary<To, op> combine;
+    *out = blocks.reduce<compute_t<To>>(
+        combine, [&](dim_t first, dim_t last, compute_t<To> &result) {
+            Transform<Ti, To, op> transform;
+            Binary<To, op> reduce;
+            NodeScratch scratch(full_nodes, full_ids);
+            result = Binary<To, op>::init();
+            for (dim_t c = first; c < last; c++) {
+                int pos[4];
+                const int lim = blocks.chunk(c, pos);
+                scratch.calc(pos[0], pos[1], pos[2], pos[3], lim);
+
+                const auto &vals = scratch.values<Ti>(output_id);
+                for (int j = 0; j < lim; j++) {
+                    compute_t<To> in_val = transform(Ti(vals[j]));
+                    if (change_nan) {
+                        in_val = IS_NAN(in_val) ? nanval : in_val;
+                    }
+                    result = reduce(in_val, result);
+                }
+            }
+        });
+}
+
 }  // namespace kernel
 }  // namespace cpu
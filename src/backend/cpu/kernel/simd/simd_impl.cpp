@@ -0,0 +1,86 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <kernel/simd_impl.hpp>
+
+// SIMD_ISAS:avx2 avx512
+
+namespace cpu {
+namespace simd {
+namespace SIMD_ISA {
+
+#define ARITH_FUNC(T)                                        \
+    template<>                                               \
+    BinaryFunc<T, T> getBinaryFunc<T, T>(af_op_t op) {       \
+        return getArithFunc<T>(op);                          \
+    }
+
+#define BIT_FUNC(T)                                          \
+    template<>                                               \
+    BinaryFunc<T, T> getBinaryFunc<T, T>(af_op_t op) {       \
+        return getBitFunc<T>(op);                            \
+    }
+
+#define LOGIC_FUNC(T)                                        \
+    template<>                                               \
+    BinaryFunc<char, T> getBinaryFunc<char, T>(af_op_t op) { \
+        return getLogicFunc<T>(op);                          \
+    }
+
+ARITH_FUNC(float)
+ARITH_FUNC(double)
+BIT_FUNC(int)
+BIT_FUNC(uint)
+BIT_FUNC(intl)
+BIT_FUNC(uintl)
+BIT_FUNC(short)
+BIT_FUNC(ushort)
+BIT_FUNC(uchar)
+
+// char is both the b8 type and the output of the logical operations
+template<>
+BinaryFunc<char, char> getBinaryFunc<char, char>(af_op_t op) {
+    BinaryFunc<char, char> func = getLogicFunc<char>(op);
+    return func ? func : getBitFunc<char>(op);
+}
+
+LOGIC_FUNC(float)
+LOGIC_FUNC(double)
+LOGIC_FUNC(int)
+LOGIC_FUNC(uint)
+LOGIC_FUNC(intl)
+LOGIC_FUNC(uintl)
+LOGIC_FUNC(short)
+LOGIC_FUNC(ushort)
+LOGIC_FUNC(uchar)
+
+#undef ARITH_FUNC
+#undef BIT_FUNC
+#undef LOGIC_FUNC
+
+template<>
+UnaryFunc<float, float> getUnaryFunc<float, float>(af_op_t op) {
+    switch (op) {
+        case af_exp_t: return unary<float, float, Exp>;
+        case af_log_t: return unary<float, float, Log>;
+        case af_sigmoid_t: return unary<float, float, Sigmoid>;
+        default: break;
+    }
+    return getNativeUnaryFunc<float>(op);
+}
+
+// The transcendental functions of double use the scalar loops
+template<>
+UnaryFunc<double, double> getUnaryFunc<double, double>(af_op_t op) {
+    return getNativeUnaryFunc<double>(op);
+}
+
+}  // namespace SIMD_ISA
+}  // namespace simd
+}  // namespace cpu
@@ -0,0 +1,299 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <simd.hpp>
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// This file is compiled once for each instruction set with the matching
+// compiler flags. The loops are written so that the compiler vectorizes them
+// for that instruction set. SIMD_ISA is the namespace of the instruction set.
+//
+// Everything is in an unnamed namespace and only uses the C math functions.
+// An inline function that is shared with the other translation units could be
+// replaced by the linker with a version that uses instructions the host does
+// not support.
+#ifndef SIMD_ISA
+#error "SIMD_ISA must be defined"
+#endif
+
+namespace cpu {
+namespace simd {
+namespace SIMD_ISA {
+namespace {
+
+template<typename T>
+struct Add {
+    static T eval(T lhs, T rhs) { return lhs + rhs; }
+};
+template<typename T>
+struct Sub {
+    static T eval(T lhs, T rhs) { return lhs - rhs; }
+};
+template<typename T>
+struct Mul {
+    static T eval(T lhs, T rhs) { return lhs * rhs; }
+};
+template<typename T>
+struct Div {
+    static T eval(T lhs, T rhs) { return lhs / rhs; }
+};
+// Same as std::min and std::max in math.hpp
+template<typename T>
+struct Min {
+    static T eval(T lhs, T rhs) { return (rhs < lhs) ? rhs : lhs; }
+};
+template<typename T>
+struct Max {
+    static T eval(T lhs, T rhs) { return (lhs < rhs) ? rhs : lhs; }
+};
+template<typename T>
+struct BitAnd {
+    static T eval(T lhs, T rhs) { return lhs & rhs; }
+};
+template<typename T>
+struct BitOr {
+    static T eval(T lhs, T rhs) { return lhs | rhs; }
+};
+template<typename T>
+struct BitXor {
+    static T eval(T lhs, T rhs) { return lhs ^ rhs; }
+};
+
+template<typename T>
+struct Eq {
+    static char eval(T lhs, T rhs) { return lhs == rhs; }
+};
+template<typename T>
+struct Neq {
+    static char eval(T lhs, T rhs) { return lhs != rhs; }
+};
+template<typename T>
+struct Lt {
+    static char eval(T lhs, T rhs) { return lhs < rhs; }
+};
+template<typename T>
+struct Gt {
+    static char eval(T lhs, T rhs) { return lhs > rhs; }
+};
+template<typename T>
+struct Le {
+    static char eval(T lhs, T rhs) { return lhs <= rhs; }
+};
+template<typename T>
+struct Ge {
+    static char eval(T lhs, T rhs) { return lhs >= rhs; }
+};
+// The operands are evaluated without branches so that the loop vectorizes
+template<typename T>
+struct And {
+    static char eval(T lhs, T rhs) { return (lhs != 0) & (rhs != 0); }
+};
+template<typename T>
+struct Or {
+    static char eval(T lhs, T rhs) { return (lhs != 0) | (rhs != 0); }
+};
+
+template<typename To, typename Ti, typename Op>
+void binary(To *out, const Ti *lhs, const Ti *rhs, int lim) {
+    for (int i = 0; i < lim; i++) { out[i] = Op::eval(lhs[i], rhs[i]); }
+}
+
+template<typename To, typename Ti, typename Op>
+void unary(To *out, const Ti *in, int lim) {
+    for (int i = 0; i < lim; i++) { out[i] = Op::eval(in[i]); }
+}
+
+inline float asFloat(int32_t val) {
+    float res;
+    memcpy(&res, &val, sizeof(res));
+    return res;
+}
+
+inline int32_t asInt(float val) {
+    int32_t res;
+    memcpy(&res, &val, sizeof(res));
+    return res;
+}
+
+/// exp(x) for float based on the Cephes expf polynomial. The result is scaled
+/// by 2^n in two steps so that the denormal range and overflow to infinity
+/// match std::exp. The maximum error is 1 ulp.
+inline float expImpl(float x) {
+    const float log2e = 1.44269504088896341f;
+    const float c1    = 0.693359375f;
+    const float c2    = -2.12194440e-4f;
+
+    // Keep NaN out of the integer conversion and return it at the end
+    const bool is_nan = !(x == x);
+    float xc          = is_nan ? 0.0f : x;
+    xc                = xc > 89.0f ? 89.0f : xc;
+    xc                = xc < -104.0f ? -104.0f : xc;
+
+    float fn = floorf(xc * log2e + 0.5f);
+    float r  = xc - fn * c1 - fn * c2;
+    float z  = r * r;
+    float p  = 1.9875691500e-4f;
+    p        = p * r + 1.3981999507e-3f;
+    p        = p * r + 8.3334519073e-3f;
+    p        = p * r + 4.1665795894e-2f;
+    p        = p * r + 1.6666665459e-1f;
+    p        = p * r + 5.0000001201e-1f;
+    p        = p * z + r + 1.0f;
+
+    int32_t n  = static_cast<int32_t>(fn);
+    int32_t n1 = n / 2;
+    int32_t n2 = n - n1;
+    float res  = p * asFloat((n1 + 127) << 23) * asFloat((n2 + 127) << 23);
+    return is_nan ? x : res;
+}
+
+/// log(x) for float based on the Cephes logf polynomial. The maximum error is
+/// 1 ulp.
+inline float logImpl(float x) {
+    const float sqrth = 0.707106781186547524f;
+
+    // Denormals are normalized before the exponent is extracted
+    const bool denorm = x < 1.17549435e-38f;
+    float xn          = denorm ? x * 8388608.0f : x;
+    int32_t bits      = asInt(xn);
+
+    // Split into the mantissa in [0.5, 1) and the exponent
+    float e = static_cast<float>(((bits >> 23) & 0xff) - 126);
+    e       = denorm ? e - 23.0f : e;
+    float m = asFloat((bits & 0x007fffff) | 0x3f000000);
+
+    const bool small = m < sqrth;
+    e                = small ? e - 1.0f : e;
+    m                = small ? m + m - 1.0f : m - 1.0f;
+
+    float z = m * m;
+    float y = 7.0376836292e-2f;
+    y       = y * m - 1.1514610310e-1f;
+    y       = y * m + 1.1676998740e-1f;
+    y       = y * m - 1.2420140846e-1f;
+    y       = y * m + 1.4249322787e-1f;
+    y       = y * m - 1.6668057665e-1f;
+    y       = y * m + 2.0000714765e-1f;
+    y       = y * m - 2.4999993993e-1f;
+    y       = y * m + 3.3333331174e-1f;
+    y       = y * m * z;
+    y       = y + e * -2.12194440e-4f;
+    y       = y - 0.5f * z;
+    float res = m + y + e * 0.693359375f;
+
+    // log(0) = -inf, log(x < 0) = NaN, log(inf) = inf and log(NaN) = NaN
+    const float inf = asFloat(0x7f800000);
+    res             = (x == 0.0f) ? -inf : res;
+    res             = (x < 0.0f) ? asFloat(0x7fc00000) : res;
+    res             = (x == inf || !(x == x)) ? x : res;
+    return res;
+}
+
+// The C math functions are used instead of std:: so that the compiler can
+// replace them with the vector instructions
+struct Sqrt {
+    static float eval(float in) { return sqrtf(in); }
+    static double eval(double in) { return sqrt(in); }
+};
+struct Abs {
+    static float eval(float in) { return fabsf(in); }
+    static double eval(double in) { return fabs(in); }
+};
+struct Floor {
+    static float eval(float in) { return floorf(in); }
+    static double eval(double in) { return floor(in); }
+};
+struct Ceil {
+    static float eval(float in) { return ceilf(in); }
+    static double eval(double in) { return ceil(in); }
+};
+struct Trunc {
+    static float eval(float in) { return truncf(in); }
+    static double eval(double in) { return trunc(in); }
+};
+struct Exp {
+    static float eval(float in) { return expImpl(in); }
+};
+struct Log {
+    static float eval(float in) { return logImpl(in); }
+};
+struct Sigmoid {
+    static float eval(float in) { return 1.0f / (1.0f + expImpl(-in)); }
+};
+
+/// Returns the kernels of the arithmetic and min/max operations
+template<typename T>
+BinaryFunc<T, T> getArithFunc(af_op_t op) {
+    const bool is_int = std::is_integral<T>::value;
+    switch (op) {
+        case af_add_t: return binary<T, T, Add<T>>;
+        case af_sub_t: return binary<T, T, Sub<T>>;
+        case af_mul_t: return binary<T, T, Mul<T>>;
+        // There are no vector instructions for the integer division
+        case af_div_t: return is_int ? nullptr : binary<T, T, Div<T>>;
+        case af_min_t: return binary<T, T, Min<T>>;
+        case af_max_t: return binary<T, T, Max<T>>;
+        default: break;
+    }
+    return nullptr;
+}
+
+/// Returns the kernels of the bitwise operations and the arithmetic operations
+/// of the integer types
+template<typename T>
+BinaryFunc<T, T> getBitFunc(af_op_t op) {
+    switch (op) {
+        case af_bitand_t: return binary<T, T, BitAnd<T>>;
+        case af_bitor_t: return binary<T, T, BitOr<T>>;
+        case af_bitxor_t: return binary<T, T, BitXor<T>>;
+        default: break;
+    }
+    return getArithFunc<T>(op);
+}
+
+/// Returns the kernels of the comparison and logical operations
+template<typename T>
+BinaryFunc<char, T> getLogicFunc(af_op_t op) {
+    switch (op) {
+        case af_eq_t: return binary<char, T, Eq<T>>;
+        case af_neq_t: return binary<char, T, Neq<T>>;
+        case af_lt_t: return binary<char, T, Lt<T>>;
+        case af_gt_t: return binary<char, T, Gt<T>>;
+        case af_le_t: return binary<char, T, Le<T>>;
+        case af_ge_t: return binary<char, T, Ge<T>>;
+        case af_and_t: return binary<char, T, And<T>>;
+        case af_or_t: return binary<char, T, Or<T>>;
+        default: break;
+    }
+    return nullptr;
+}
+
+/// Returns the kernels of the unary operations that have a vector instruction
+template<typename T>
+UnaryFunc<T, T> getNativeUnaryFunc(af_op_t op) {
+    switch (op) {
+        case af_sqrt_t: return unary<T, T, Sqrt>;
+        case af_abs_t: return unary<T, T, Abs>;
+        case af_floor_t: return unary<T, T, Floor>;
+        case af_ceil_t: return unary<T, T, Ceil>;
+        case af_trunc_t: return unary<T, T, Trunc>;
+        default: break;
+    }
+    return nullptr;
+}
+
+}  // namespace
+}  // namespace SIMD_ISA
+}  // namespace simd
+}  // namespace cpu
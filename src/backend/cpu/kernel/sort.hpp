@@ -9,8 +9,11 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
 #include <err_cpu.hpp>
 #include <math.hpp>
+#include <platform.hpp>
+#include <thread_pool.hpp>
 #include <algorithm>
 #include <functional>
 #include <numeric>
@@ -18,6 +21,9 @@
 namespace cpu {
 namespace kernel {
 
+// The minimum number of elements sorted by a task
+constexpr dim_t SORT_MIN_TASK_WORK = 16384;
+
 // Based off of http://stackoverflow.com/a/12399290
 template<typename T>
 void sort0Iterative(Param<T> val, bool isAscending) {
@@ -27,19 +33,28 @@ void sort0Iterative(Param<T> val, bool isAscending) {
     std::function<bool(T, T)> op = std::greater<T>();
     if (isAscending) { op = std::less<T>(); }
 
-    T *comp_ptr = nullptr;
-    for (dim_t w = 0; w < val.dims(3); w++) {
-        dim_t valW = w * val.strides(3);
-        for (dim_t z = 0; z < val.dims(2); z++) {
-            dim_t valWZ = valW + z * val.strides(2);
-            for (dim_t y = 0; y < val.dims(1); y++) {
-                dim_t valOffset = valWZ + y * val.strides(1);
-
-                comp_ptr = val_ptr + valOffset;
-                std::sort(comp_ptr, comp_ptr + val.dims(0), op);
-            }
+    // The batches in dimensions 2 and 3 are split across the pool and the
+    // columns of each batch are split again by the nested parallel_for
+    const dim_t num_batches = val.dims(2) * val.dims(3);
+    const dim_t col_grain   = divup(SORT_MIN_TASK_WORK, val.dims(0));
+    const dim_t batch_grain = divup(col_grain, val.dims(1));
+
+    ThreadPool &pool = threadPool();
+    pool.parallel_for(num_batches, batch_grain, [&](dim_t bbegin, dim_t bend) {
+        for (dim_t b = bbegin; b < bend; b++) {
+            const dim_t z     = b % val.dims(2);
+            const dim_t w     = b / val.dims(2);
+            const dim_t valWZ = w * val.strides(3) + z * val.strides(2);
+
+            pool.parallel_for(
+                val.dims(1), col_grain, [&](dim_t ybegin, dim_t yend) {
+                    for (dim_t y = ybegin; y < yend; y++) {
+                        T *comp_ptr = val_ptr + valWZ + y * val.strides(1);
+                        std::sort(comp_ptr, comp_ptr + val.dims(0), op);
+                    }
+                });
         }
-    }
+    });
     return;
 }
 
@@ -11,18 +11,24 @@
 #include <err_cpu.hpp>
 #include <jit/BinaryNode.hpp>
 #include <optypes.hpp>
+#include <simd.hpp>
 #include <types.hpp>
 #include <af/dim4.hpp>
 
 namespace cpu {
 
-#define LOGIC_FN(OP, op)                                                 \
-    template<typename T>                                                 \
-    struct BinOp<char, T, OP> {                                          \
-        void eval(jit::array<char> &out, const jit::array<T> &lhs,       \
-                  const jit::array<T> &rhs, int lim) {                   \
-            for (int i = 0; i < lim; i++) { out[i] = lhs[i] op rhs[i]; } \
-        }                                                                \
+#define LOGIC_FN(OP, op)                                                    \
+    template<typename T>                                                    \
+    struct BinOp<char, T, OP> {                                             \
+        void eval(jit::array<char> &out, const jit::array<T> &lhs,          \
+                  const jit::array<T> &rhs, int lim) {                      \
+            static const auto simd_func = simd::getBinaryFunc<char, T>(OP); \
+            if (simd_func) {                                                \
+                simd_func(out.data(), lhs.data(), rhs.data(), lim);         \
+                return;                                                     \
+            }                                                               \
+            for (int i = 0; i < lim; i++) { out[i] = lhs[i] op rhs[i]; }    \
+        }                                                                   \
     };
 
 LOGIC_FN(af_eq_t, ==)
@@ -72,10 +78,10 @@ Array<char> logicOp(const Array<T> &lhs, const Array<T> &rhs,
     jit::Node_ptr lhs_node = lhs.getNode();
     jit::Node_ptr rhs_node = rhs.getNode();
 
-    jit::BinaryNode<char, T, op> *node =
-        new jit::BinaryNode<char, T, op>(lhs_node, rhs_node);
+    jit::Node_ptr node =
+        jit::createBinaryNode<char, T, op>(lhs_node, rhs_node);
 
-    return createNodeArray<char>(odims, jit::Node_ptr(node));
+    return createNodeArray<char>(odims, node);
 }
 
 #define BITWISE_FN(OP, op)                                               \
@@ -83,6 +89,11 @@ Array<char> logicOp(const Array<T> &lhs, const Array<T> &rhs,
     struct BinOp<T, T, OP> {                                             \
         void eval(jit::array<T> &out, const jit::array<T> &lhs,          \
                   const jit::array<T> &rhs, int lim) {                   \
+            static const auto simd_func = simd::getBinaryFunc<T, T>(OP); \
+            if (simd_func) {                                             \
+                simd_func(out.data(), lhs.data(), rhs.data(), lim);      \
+                return;                                                  \
+            }                                                            \
             for (int i = 0; i < lim; i++) { out[i] = lhs[i] op rhs[i]; } \
         }                                                                \
     };
@@ -101,9 +112,8 @@ Array<T> bitOp(const Array<T> &lhs, const Array<T> &rhs,
     jit::Node_ptr lhs_node = lhs.getNode();
     jit::Node_ptr rhs_node = rhs.getNode();
 
-    jit::BinaryNode<T, T, op> *node =
-        new jit::BinaryNode<T, T, op>(lhs_node, rhs_node);
+    jit::Node_ptr node = jit::createBinaryNode<T, T, op>(lhs_node, rhs_node);
 
-    return createNodeArray<T>(odims, jit::Node_ptr(node));
+    return createNodeArray<T>(odims, node);
 }
 }  // namespace cpu
@@ -0,0 +1,249 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <mapped_array.hpp>
+
+#include <Array.hpp>
+#include <Event.hpp>
+#include <common/defines.hpp>
+#include <common/half.hpp>
+#include <err_cpu.hpp>
+#include <handle.hpp>
+#include <platform.hpp>
+#include <queue.hpp>
+#include <types.hpp>
+#include <af/cpu.h>
+#include <af/defines.h>
+#include <af/dim4.hpp>
+
+#include <utility>
+
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using af::dim4;
+using common::half;
+using cpu::cdouble;
+using cpu::cfloat;
+using cpu::uchar;
+
+namespace cpu {
+
+namespace {
+
+/// The pages of a file that are mapped into memory
+struct FileRegion {
+    void *base;
+    size_t length;
+};
+
+/// Maps the pages of \p filename that hold \p bytes at \p offset. The data
+/// starts at \p offset % alignment bytes into the region.
+FileRegion mapFile(const char *filename, size_t offset, size_t bytes,
+                   size_t *alignment) {
+#if defined(OS_WIN)
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        AF_ERROR("File failed to open", AF_ERR_ARG);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) ||
+        static_cast<size_t>(file_size.QuadPart) < offset + bytes) {
+        CloseHandle(file);
+        AF_ERROR("File is smaller than the array", AF_ERR_ARG);
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    *alignment = info.dwAllocationGranularity;
+
+    const size_t start = offset - offset % *alignment;
+    FileRegion region  = {nullptr, offset + bytes - start};
+
+    // Copy-on-write views are private to the process
+    HANDLE mapping =
+        CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping) {
+        region.base = MapViewOfFile(mapping, FILE_MAP_COPY,
+                                    static_cast<DWORD>(start >> 32),
+                                    static_cast<DWORD>(start), region.length);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int file = open(filename, O_RDONLY);
+    if (file < 0) { AF_ERROR("File failed to open", AF_ERR_ARG); }
+    struct stat file_info;
+    if (fstat(file, &file_info) != 0 ||
+        static_cast<size_t>(file_info.st_size) < offset + bytes) {
+        close(file);
+        AF_ERROR("File is smaller than the array", AF_ERR_ARG);
+    }
+
+    *alignment = sysconf(_SC_PAGESIZE);
+
+    const size_t start = offset - offset % *alignment;
+    FileRegion region  = {nullptr, offset + bytes - start};
+
+    // Private mappings share the pages of the page cache until they are
+    // written, and writes are never carried through to the file
+    void *base = mmap(nullptr, region.length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, file, static_cast<off_t>(start));
+    if (base != MAP_FAILED) { region.base = base; }
+    close(file);
+#endif
+    if (!region.base) { AF_ERROR("Failed to map the file", AF_ERR_RUNTIME); }
+    return region;
+}
+
+void unmapFile(const FileRegion &region) {
+#if defined(OS_WIN)
+    UnmapViewOfFile(region.base);
+#else
+    munmap(region.base, region.length);
+#endif
+}
+
+}  // namespace
+
+template<typename T>
+Array<T> mapFileArray(const char *filename, dim_t offset, const dim4 &dims,
+                      bool read_only) {
+    // The elements must be aligned for the loads of the kernels
+    if (offset % sizeof(T) != 0) {
+        AF_ERROR("The offset is not a multiple of the element size",
+                 AF_ERR_ARG);
+    }
+
+    const size_t bytes = dims.elements() * sizeof(T);
+    size_t alignment   = 0;
+    FileRegion region  = mapFile(filename, offset, bytes, &alignment);
+    char *first        = static_cast<char *>(region.base) + offset % alignment;
+    T *data            = reinterpret_cast<T *>(first);
+
+    memoryManager().addExternalBuffer(data, bytes);
+    return createExternalArray<T>(
+        dims, data,
+        [region](T *ptr) {
+            try {
+                // The functions enqueued before the release may still read
+                // the pages unless the array is released by the queue itself
+                if (!getQueue().is_worker()) {
+                    Event e = make_event(getQueue());
+                    e.block();
+                }
+                memoryManager().removeExternalBuffer(ptr);
+                unmapFile(region);
+            } catch (AfError &err) {
+                // Do not throw any errors while releasing the array
+            }
+        },
+        read_only);
+}
+
+#define INSTANTIATE(T)                                                   \
+    template Array<T> mapFileArray<T>(const char *filename, dim_t offset, \
+                                      const dim4 &dims, bool read_only);
+
+INSTANTIATE(float)
+INSTANTIATE(double)
+INSTANTIATE(cfloat)
+INSTANTIATE(cdouble)
+INSTANTIATE(int)
+INSTANTIATE(uint)
+INSTANTIATE(uchar)
+INSTANTIATE(char)
+INSTANTIATE(intl)
+INSTANTIATE(uintl)
+INSTANTIATE(short)
+INSTANTIATE(ushort)
+INSTANTIATE(half)
+
+}  // namespace cpu
+
+template<typename T>
+static af_array mapArray(const char *filename, dim_t offset, const dim4 &dims,
+                         bool read_only) {
+    return getHandle(cpu::mapFileArray<T>(filename, offset, dims, read_only));
+}
+
+af_err afcpu_map_array(af_array *out, const char *filename, dim_t offset,
+                       unsigned ndims, const dim_t *const dims,
+                       af_dtype type, afcpu_map_mode mode) {
+    try {
+        ARG_ASSERT(0, out != nullptr);
+        ARG_ASSERT(1, filename != nullptr);
+        ARG_ASSERT(2, offset >= 0);
+        ARG_ASSERT(3, ndims > 0 && ndims <= AF_MAX_DIMS);
+        ARG_ASSERT(4, dims != nullptr);
+        ARG_ASSERT(6, mode == AFCPU_MAP_READ_ONLY ||
+                          mode == AFCPU_MAP_COPY_ON_WRITE);
+
+        dim4 d(1, 1, 1, 1);
+        for (unsigned i = 0; i < ndims; i++) {
+            ARG_ASSERT(4, dims[i] > 0);
+            d[i] = dims[i];
+        }
+
+        const bool read_only = mode == AFCPU_MAP_READ_ONLY;
+        af_array output      = 0;
+        switch (type) {
+            case f32:
+                output = mapArray<float>(filename, offset, d, read_only);
+                break;
+            case c32:
+                output = mapArray<cfloat>(filename, offset, d, read_only);
+                break;
+            case f64:
+                output = mapArray<double>(filename, offset, d, read_only);
+                break;
+            case c64:
+                output = mapArray<cdouble>(filename, offset, d, read_only);
+                break;
+            case b8:
+                output = mapArray<char>(filename, offset, d, read_only);
+                break;
+            case s32:
+                output = mapArray<int>(filename, offset, d, read_only);
+                break;
+            case u32:
+                output = mapArray<uint>(filename, offset, d, read_only);
+                break;
+            case u8:
+                output = mapArray<uchar>(filename, offset, d, read_only);
+                break;
+            case s64:
+                output = mapArray<intl>(filename, offset, d, read_only);
+                break;
+            case u64:
+                output = mapArray<uintl>(filename, offset, d, read_only);
+                break;
+            case s16:
+                output = mapArray<short>(filename, offset, d, read_only);
+                break;
+            case u16:
+                output = mapArray<ushort>(filename, offset, d, read_only);
+                break;
+            case f16:
+                output = mapArray<half>(filename, offset, d, read_only);
+                break;
+            default: TYPE_ERROR(5, type);
+        }
+        std::swap(*out, output);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
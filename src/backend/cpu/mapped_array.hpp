@@ -0,0 +1,35 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <Array.hpp>
+
+#include <af/defines.h>
+#include <af/dim4.hpp>
+
+namespace cpu {
+
+/// Creates an array whose data is the region of \p filename that starts
+/// \p offset bytes into the file
+///
+/// The pages of the region are shared with the page cache until they are
+/// written. The file is never modified.
+///
+/// \param[in] filename  The file that holds the data
+/// \param[in] offset    The position of the first element in the file
+/// \param[in] dims      The dimension of the array
+/// \param[in] read_only The data is copied to a new buffer before it is
+///                      modified if true. Otherwise only the pages that are
+///                      written are copied.
+template<typename T>
+Array<T> mapFileArray(const char *filename, dim_t offset,
+                      const af::dim4 &dims, bool read_only);
+
+}  // namespace cpu
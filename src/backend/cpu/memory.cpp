@@ -11,9 +11,13 @@
 
 #include <common/Logger.hpp>
 #include <common/MemoryManagerImpl.hpp>
+#include <common/defines.hpp>
 #include <common/half.hpp>
 #include <err_cpu.hpp>
+#include <graph.hpp>
+#include <numa.hpp>
 #include <platform.hpp>
+#include <profiler.hpp>
 #include <queue.hpp>
 #include <spdlog/spdlog.h>
 #include <types.hpp>
@@ -59,7 +63,9 @@ unique_ptr<T[], function<void(T *)>> memAlloc(const size_t &elements) {
 
     common::MemoryEventPair me = memoryManager().alloc(elements * sizeof(T), false);
     if(me.e) me.e.enqueueWait(getQueue());
+    profiler::addAllocation(elements * sizeof(T));
     ptr = (T *)me.ptr;
+    if (Graph *graph = capturingGraph()) { graph->lockBuffer(ptr); }
     return unique_ptr<T[], function<void(T *)>>(ptr, memFree<T>);
 }
 
@@ -95,6 +101,12 @@ void deviceMemoryInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                                lock_buffers);
 }
 
+void memoryStats(af_memory_stats *stats) { memoryManager().memoryStats(stats); }
+
+void resetMemoryStats() { memoryManager().resetMemoryStats(); }
+
+std::string memoryStatsReport() { return memoryManager().memoryStatsReport(); }
+
 template<typename T>
 T *pinnedAlloc(const size_t &elements) {
     common::MemoryEventPair me = memoryManager().alloc(elements * sizeof(T), false);
@@ -131,21 +143,20 @@ INSTANTIATE(ushort)
 INSTANTIATE(short)
 INSTANTIATE(half)
 
+// The NUMA devices place their buffers on their node, so each device keeps
+// its own pool of buffers. Otherwise there is a single device.
 MemoryManager::MemoryManager()
     : common::MemoryManager<cpu::MemoryManager>(
-          getDeviceCount(), common::MAX_BUFFERS,
+          useNumaDevices() ? getNumaNodeCount() : 1, common::MAX_BUFFERS,
           AF_MEM_DEBUG || AF_CPU_MEM_DEBUG) {
     this->setMaxMemorySize();
 }
 
 MemoryManager::~MemoryManager() {
-    for (int n = 0; n < cpu::getDeviceCount(); n++) {
-        try {
-            cpu::setDevice(n);
-            garbageCollect();
-        } catch (AfError err) {
-            continue;  // Do not throw any errors while shutting down
-        }
+    try {
+        garbageCollect();
+    } catch (AfError err) {
+        // Do not throw any errors while shutting down
     }
 }
 
@@ -156,7 +167,7 @@ size_t MemoryManager::getMaxMemorySize(int id) {
 }
 
 void *MemoryManager::nativeAlloc(const size_t bytes) {
-    void *ptr = malloc(bytes);
+    void *ptr = numaAlloc(bytes);
     AF_TRACE("nativeAlloc: {:>7} {}", bytesToString(bytes), ptr);
     if (!ptr) AF_ERROR("Unable to allocate memory", AF_ERR_NO_MEM);
     return ptr;
@@ -165,8 +176,9 @@ void *MemoryManager::nativeAlloc(const size_t bytes) {
 void MemoryManager::nativeFree(void *ptr) {
     AF_TRACE("nativeFree: {: >8} {}", " ", ptr);
     // Make sure this pointer is not being used on the queue before freeing the
-    // memory.
+    // memory. The uses on other queues are waited for through the event of
+    // the buffer.
     getQueue().sync();
-    return free((void *)ptr);
+    numaFree(ptr);
 }
 }  // namespace cpu
@@ -13,6 +13,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 namespace cpu {
 
@@ -44,6 +45,9 @@ unsigned getMaxBuffers();
 
 void deviceMemoryInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                       size_t *lock_bytes, size_t *lock_buffers);
+void memoryStats(af_memory_stats *stats);
+void resetMemoryStats();
+std::string memoryStatsReport();
 void garbageCollect();
 void pinnedGarbageCollect();
 
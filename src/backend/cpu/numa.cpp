@@ -0,0 +1,288 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <numa.hpp>
+
+#include <common/defines.hpp>
+#include <common/dispatch.hpp>
+#include <common/util.hpp>
+#include <err_cpu.hpp>
+#include <platform.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#if defined(OS_LNX)
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using std::ifstream;
+using std::istringstream;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace cpu {
+
+namespace {
+
+/// The nodes of the system. The nodes are numbered from 0 in the order of
+/// their ids, which may have gaps.
+struct NumaTopology {
+    vector<int> ids;
+    vector<vector<int>> cpus;
+    vector<size_t> memory;
+
+    NumaTopology() {
+#if defined(OS_LNX)
+        const string root = "/sys/devices/system/node/";
+        if (DIR *dir = opendir(root.c_str())) {
+            while (dirent *entry = readdir(dir)) {
+                string name = entry->d_name;
+                if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                    name.find_first_not_of("0123456789", 4) != string::npos) {
+                    continue;
+                }
+                ids.push_back(std::stoi(name.substr(4)));
+            }
+            closedir(dir);
+
+            std::sort(ids.begin(), ids.end());
+            for (int id : ids) {
+                string path = root + "node" + std::to_string(id);
+                cpus.push_back(readCpuList(path + "/cpulist"));
+                memory.push_back(readMemTotal(path + "/meminfo"));
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            ids.push_back(0);
+            cpus.emplace_back();
+            memory.push_back(0);
+        }
+    }
+
+    /// Parses a list such as 0-3,8-11
+    static vector<int> readCpuList(const string &path) {
+        vector<int> list;
+        ifstream file(path);
+        string range;
+        while (std::getline(file, range, ',')) {
+            int first = 0, last = 0;
+            char dash = 0;
+            istringstream parser(range);
+            if (!(parser >> first)) { continue; }
+            last = (parser >> dash >> last) ? last : first;
+            for (int cpu = first; cpu <= last; cpu++) { list.push_back(cpu); }
+        }
+        return list;
+    }
+
+    /// Reads the "Node 0 MemTotal: 1024 kB" line
+    static size_t readMemTotal(const string &path) {
+        ifstream file(path);
+        string line;
+        while (std::getline(file, line)) {
+            size_t pos = line.find("MemTotal:");
+            if (pos == string::npos) { continue; }
+            return std::stoull(line.substr(pos + 9)) * 1024;
+        }
+        return 0;
+    }
+};
+
+const NumaTopology &topology() {
+    static const NumaTopology instance;
+    return instance;
+}
+
+struct NumaPolicy {
+    afcpu_numa_policy policy;
+    int node;
+};
+
+/// Reads AF_CPU_NUMA_POLICY. It is "interleave", "local" or a node.
+NumaPolicy getDefaultPolicy() {
+    static const NumaPolicy policy = [] {
+        string env_var = getEnvVar("AF_CPU_NUMA_POLICY");
+        if (env_var == "interleave") {
+            return NumaPolicy{AFCPU_NUMA_INTERLEAVE, 0};
+        }
+        if (env_var == "local") { return NumaPolicy{AFCPU_NUMA_LOCAL, 0}; }
+        if (!env_var.empty() && isdigit(env_var[0])) {
+            int node = std::stoi(env_var);
+            if (node < getNumaNodeCount()) {
+                return NumaPolicy{AFCPU_NUMA_NODE, node};
+            }
+        }
+        return NumaPolicy{AFCPU_NUMA_DEFAULT, 0};
+    }();
+    return policy;
+}
+
+// The policy set by the calling thread with setNumaPolicy
+thread_local NumaPolicy thread_policy = {AFCPU_NUMA_DEFAULT, 0};
+
+#if defined(OS_LNX)
+// The modes of the mbind system call. These are defined in numaif.h which is
+// only available with libnuma.
+const int MPOL_PREFERRED_MODE  = 1;
+const int MPOL_INTERLEAVE_MODE = 3;
+
+void bindPages(void *ptr, size_t bytes, int mode, const vector<int> &nodes) {
+    const vector<int> &ids     = topology().ids;
+    const size_t bits_per_word = 8 * sizeof(unsigned long);
+    vector<unsigned long> mask(ids.back() / bits_per_word + 1, 0);
+    for (int node : nodes) {
+        const int id = ids[node];
+        mask[id / bits_per_word] |= 1UL << (id % bits_per_word);
+    }
+    // The kernel ignores the last bit of maxnode. The placement is a hint so
+    // errors are ignored.
+    syscall(SYS_mbind, ptr, bytes, mode, mask.data(),
+            mask.size() * bits_per_word + 1, 0);
+}
+
+/// The buffers allocated with mmap and their sizes
+struct MappedBuffers {
+    mutex buffers_mutex;
+    unordered_map<void *, size_t> sizes;
+};
+
+MappedBuffers &mappedBuffers() {
+    // Buffers are released while the static objects are destroyed
+    static MappedBuffers *buffers = new MappedBuffers();
+    return *buffers;
+}
+
+/// Writes the first byte of each page on the threads of the pool. The pages
+/// are split the way parallel_for splits the elements of a kernel.
+void touchPages(void *ptr, size_t bytes, size_t page_size) {
+    char *data        = static_cast<char *>(ptr);
+    const dim_t pages = static_cast<dim_t>(divup(bytes, page_size));
+    const dim_t grain = 16;
+    threadPool().parallel_for(pages, grain, [=](dim_t begin, dim_t end) {
+        for (dim_t page = begin; page < end; page++) {
+            data[page * page_size] = 0;
+        }
+    });
+}
+#endif
+
+}  // namespace
+
+int getNumaNodeCount() { return static_cast<int>(topology().cpus.size()); }
+
+const vector<int> &getNumaNodeCpus(int node) { return topology().cpus[node]; }
+
+size_t getNumaNodeMemorySize(int node) { return topology().memory[node]; }
+
+bool useNumaDevices() {
+    static const bool use_devices = [] {
+        string env_var = getEnvVar("AF_CPU_NUMA_DEVICES");
+        return !env_var.empty() && env_var[0] != '0' &&
+               getNumaNodeCount() > 1;
+    }();
+    return use_devices;
+}
+
+void setNumaPolicy(afcpu_numa_policy policy, int node) {
+    if (policy < AFCPU_NUMA_DEFAULT || policy > AFCPU_NUMA_NODE) {
+        AF_ERROR("Invalid NUMA policy", AF_ERR_ARG);
+    }
+    if (policy == AFCPU_NUMA_NODE &&
+        (node < 0 || node >= getNumaNodeCount())) {
+        AF_ERROR("Invalid NUMA node", AF_ERR_ARG);
+    }
+    thread_policy = NumaPolicy{policy, node};
+}
+
+void *numaAlloc(size_t bytes) {
+#if defined(OS_LNX)
+    if (bytes >= NUMA_MIN_BYTES && getNumaNodeCount() > 1) {
+        // The thread policy takes precedence over the node of the device
+        NumaPolicy policy = thread_policy;
+        if (policy.policy == AFCPU_NUMA_DEFAULT) {
+            policy = useNumaDevices()
+                         ? NumaPolicy{AFCPU_NUMA_NODE, getActiveDeviceId()}
+                         : getDefaultPolicy();
+        }
+
+        if (policy.policy != AFCPU_NUMA_DEFAULT) {
+            // The buffer must own whole pages that have not been written yet,
+            // otherwise the placement has no effect. malloc may return pages
+            // of the heap that are already placed.
+            const size_t page_size = sysconf(_SC_PAGESIZE);
+            const size_t size      = divup(bytes, page_size) * page_size;
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) { return nullptr; }
+            {
+                MappedBuffers &mapped = mappedBuffers();
+                lock_guard<mutex> lock(mapped.buffers_mutex);
+                mapped.sizes[ptr] = size;
+            }
+
+            switch (policy.policy) {
+                case AFCPU_NUMA_INTERLEAVE: {
+                    vector<int> nodes;
+                    for (int node = 0; node < getNumaNodeCount(); node++) {
+                        nodes.push_back(node);
+                    }
+                    bindPages(ptr, bytes, MPOL_INTERLEAVE_MODE, nodes);
+                    break;
+                }
+                case AFCPU_NUMA_NODE:
+                    bindPages(ptr, bytes, MPOL_PREFERRED_MODE, {policy.node});
+                    break;
+                case AFCPU_NUMA_LOCAL: touchPages(ptr, bytes, page_size); break;
+                default: break;
+            }
+            return ptr;
+        }
+    }
+#endif
+    return malloc(bytes);
+}
+
+void numaFree(void *ptr) {
+#if defined(OS_LNX)
+    if (getNumaNodeCount() > 1) {
+        MappedBuffers &mapped = mappedBuffers();
+        size_t size           = 0;
+        {
+            lock_guard<mutex> lock(mapped.buffers_mutex);
+            auto iter = mapped.sizes.find(ptr);
+            if (iter != mapped.sizes.end()) {
+                size = iter->second;
+                mapped.sizes.erase(iter);
+            }
+        }
+        if (size > 0) {
+            munmap(ptr, size);
+            return;
+        }
+    }
+#endif
+    free(ptr);
+}
+
+}  // namespace cpu
@@ -0,0 +1,63 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <af/cpu.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace cpu {
+
+/// Buffers smaller than this are allocated with malloc and are not placed
+constexpr size_t NUMA_MIN_BYTES = 1 << 20;
+
+/// Returns the number of NUMA nodes of the system. It is 1 if the topology is
+/// not available.
+///
+/// The functions that take a node use its position in the nodes of the
+/// system ordered by id, so that the node ids of the system may have gaps.
+int getNumaNodeCount();
+
+/// Returns the logical CPUs of \p node. It is empty if the topology is not
+/// available.
+const std::vector<int> &getNumaNodeCpus(int node);
+
+/// Returns the memory of \p node in bytes or 0 if it is not known
+size_t getNumaNodeMemorySize(int node);
+
+/// Returns true if each NUMA node is a separate device. Reads the
+/// AF_CPU_NUMA_DEVICES environment variable.
+bool useNumaDevices();
+
+/// Sets the placement of the buffers allocated by the calling thread
+///
+/// The placement of a buffer is decided when the memory manager allocates
+/// it, which happens while the functions that create an array run. The
+/// policy is therefore kept per thread and applies to the arrays the thread
+/// creates until it is changed, rather than being set on an array.
+///
+/// \param[in] policy The placement of new buffers. AFCPU_NUMA_DEFAULT
+///                   restores the policy of AF_CPU_NUMA_POLICY.
+/// \param[in] node   The node used with AFCPU_NUMA_NODE
+void setNumaPolicy(afcpu_numa_policy policy, int node);
+
+/// Allocates a buffer of \p bytes placed according to the policy of the
+/// calling thread
+///
+/// Small buffers and buffers on systems with a single node are allocated with
+/// malloc. The placed buffers are mapped with mmap so that their pages are
+/// only faulted in after their placement is set.
+void *numaAlloc(size_t bytes);
+
+/// Releases a buffer allocated with numaAlloc
+void numaFree(void *ptr);
+
+}  // namespace cpu
@@ -10,18 +10,34 @@
 #include <common/defines.hpp>
 #include <common/host_memory.hpp>
 #include <device_manager.hpp>
+#include <err_cpu.hpp>
+#include <numa.hpp>
 #include <platform.hpp>
+#include <profiler.hpp>
+#include <thread_pool.hpp>
 #include <version.hpp>
+#include <af/cpu.h>
 #include <af/version.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <memory>
+#include <mutex>
 #include <sstream>
 
+#if defined(OS_LNX)
+#include <unistd.h>
+#endif
+
 using std::endl;
+using std::find_if;
+using std::lock_guard;
+using std::mutex;
 using std::not1;
 using std::ostringstream;
 using std::ptr_fun;
+using std::shared_ptr;
 using std::stoi;
 using std::string;
 
@@ -59,21 +75,34 @@ string getDeviceInfo() {
          << ", build " << AF_REVISION << ")" << endl;
 
     string model = cinfo.model();
+    ltrim(model);
 
-    size_t memMB = getDeviceMemorySize(getActiveDeviceId()) / 1048576;
+    for (int device = 0; device < getDeviceCount(); device++) {
+        size_t memMB = getDeviceMemorySize(device) / 1048576;
 
-    info << string("[0] ") << cinfo.vendor() << ": " << ltrim(model);
+        if (device == getActiveDeviceId()) {
+            info << "[" << device << "] ";
+        } else {
+            info << "-" << device << "- ";
+        }
+        info << cinfo.vendor() << ": " << model;
+        if (useNumaDevices()) { info << ", NUMA node " << device; }
 
-    if (memMB)
-        info << ", " << memMB << " MB, ";
-    else
-        info << ", Unknown MB, ";
+        if (memMB)
+            info << ", " << memMB << " MB, ";
+        else
+            info << ", Unknown MB, ";
 
-    info << "Max threads(" << cinfo.threads() << ") ";
+        int threads = cinfo.threads();
+        if (useNumaDevices()) {
+            threads = static_cast<int>(getNumaNodeCpus(device).size());
+        }
+        info << "Max threads(" << threads << ") ";
 #ifndef NDEBUG
-    info << AF_COMPILER_STR;
+        info << AF_COMPILER_STR;
 #endif
-    info << endl;
+        info << endl;
+    }
 
     return info.str();
 }
@@ -99,7 +128,8 @@ void devprop(char* d_name, char* d_platform, char* d_toolkit, char* d_compute) {
 }
 
 unsigned getMaxJitSize() {
-    const int MAX_JIT_LEN = 100;
+    // The cost model decides when the trees below this height are evaluated
+    const int MAX_JIT_LEN = 1000;
 
     thread_local int length = 0;
     if (length == 0) {
@@ -113,13 +143,71 @@ unsigned getMaxJitSize() {
     return length;
 }
 
-int getDeviceCount() { return DeviceManager::NUM_DEVICES; }
+size_t getJitCacheSize() {
+    static const size_t bytes = []() -> size_t {
+        string env_var = getEnvVar("AF_CPU_JIT_CACHE_SIZE");
+        if (!env_var.empty()) { return std::stoull(env_var); }
+#if defined(OS_LNX) && defined(_SC_LEVEL2_CACHE_SIZE)
+        long cache_bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (cache_bytes > 0) { return static_cast<size_t>(cache_bytes); }
+#endif
+        return 1 << 20;
+    }();
+    return bytes;
+}
+
+size_t getInlineElements() {
+    static const size_t elements = []() -> size_t {
+        string env_var = getEnvVar("AF_CPU_INLINE_ELEMENTS");
+        if (!env_var.empty()) { return std::stoull(env_var); }
+        return 4096;
+    }();
+    return elements;
+}
+
+namespace {
+// The limits set with afcpu_set_queue_limits. 0 selects the default limit.
+std::atomic<size_t> queue_max_functions(0);
+std::atomic<size_t> queue_max_bytes(0);
+}  // namespace
+
+size_t getQueueMaxFunctions() {
+    static const size_t functions = []() -> size_t {
+        string env_var = getEnvVar("AF_CPU_QUEUE_MAX_FUNCTIONS");
+        if (!env_var.empty()) { return std::stoull(env_var); }
+        return 256;
+    }();
+    const size_t limit = queue_max_functions;
+    return limit ? limit : functions;
+}
+
+size_t getQueueMaxBytes() {
+    static const size_t bytes = []() -> size_t {
+        string env_var = getEnvVar("AF_CPU_QUEUE_MAX_BYTES");
+        if (!env_var.empty()) { return std::stoull(env_var); }
+        return size_t(1) << 30;
+    }();
+    const size_t limit = queue_max_bytes;
+    return limit ? limit : bytes;
+}
+
+void setQueueLimits(size_t max_functions, size_t max_bytes) {
+    queue_max_functions = max_functions;
+    queue_max_bytes     = max_bytes;
+}
+
+// Each NUMA node is a device if AF_CPU_NUMA_DEVICES is set
+int getDeviceCount() { return useNumaDevices() ? getNumaNodeCount() : 1; }
+
+namespace {
+thread_local int active_device = 0;
+}  // namespace
 
 // Get the currently active device id
-int getActiveDeviceId() { return DeviceManager::ACTIVE_DEVICE_ID; }
+int getActiveDeviceId() { return active_device; }
 
 size_t getDeviceMemorySize(int device) {
-    UNUSED(device);
+    if (useNumaDevices()) { return getNumaNodeMemorySize(device); }
     return common::getHostMemorySize();
 }
 
@@ -127,23 +215,111 @@ size_t getHostMemorySize() { return common::getHostMemorySize(); }
 
 int setDevice(int device) {
     thread_local bool flag = false;
-    if (!flag && device != 0) {
+    if (device >= getDeviceCount()) {
+        if (!flag) {
 #ifndef NDEBUG
-        fprintf(
-            stderr,
-            "WARNING af_set_device(device): device can only be 0 for CPU\n");
+            fprintf(stderr,
+                    "WARNING af_set_device(device): device can only be less "
+                    "than %d for CPU\n",
+                    getDeviceCount());
 #endif
-        flag = true;
+            flag = true;
+        }
+        return active_device;
     }
-    return 0;
+    int old_device = active_device;
+    active_device  = device;
+    return old_device;
 }
 
+namespace {
+// The stream a host thread is bound to with setActiveStream. The binding keeps
+// a released stream alive until the thread is bound to another stream.
+thread_local shared_ptr<queue> bound_stream;
+
+// The stream whose worker is running on this thread
+thread_local queue* worker_stream = nullptr;
+}  // namespace
+
 queue& getQueue(int device) {
+    if (bound_stream) { return *bound_stream; }
+    if (worker_stream) { return *worker_stream; }
     return DeviceManager::getInstance().queues[device];
 }
 
+queue& getQueue(const char* caller) {
+    // Every function that uses the queue passes its name, so the name is
+    // only stored when it is written to a profile
+    if (profiler::enabled()) { profiler::setCaller(caller); }
+    return getQueue(getActiveDeviceId());
+}
+
 void sync(int device) { getQueue(device).sync(); }
 
+queue* createStream() {
+    DeviceManager& inst = DeviceManager::getInstance();
+    shared_ptr<queue> stream(new queue());
+
+    // Functions running on the worker of the stream enqueue their own work,
+    // such as the events of freed buffers, on the same stream
+    queue* stream_ptr = stream.get();
+    const int device  = getActiveDeviceId();
+    stream->enqueue([stream_ptr, device]() {
+        if (stream_ptr->is_worker()) {
+            worker_stream = stream_ptr;
+            active_device = device;
+        }
+    });
+
+    lock_guard<mutex> lock(inst.stream_mutex);
+    inst.streams.push_back(stream);
+    return stream_ptr;
+}
+
+void releaseStream(queue* stream) {
+    DeviceManager& inst = DeviceManager::getInstance();
+    shared_ptr<queue> released;
+    {
+        lock_guard<mutex> lock(inst.stream_mutex);
+        auto it = find_if(inst.streams.begin(), inst.streams.end(),
+                          [stream](const shared_ptr<queue>& s) {
+                              return s.get() == stream;
+                          });
+        if (it == inst.streams.end()) {
+            AF_ERROR("Invalid CPU stream", AF_ERR_ARG);
+        }
+        released = *it;
+        inst.streams.erase(it);
+    }
+    if (bound_stream == released) { bound_stream.reset(); }
+    released->sync();
+}
+
+void setActiveStream(queue* stream) {
+    if (stream == nullptr) {
+        bound_stream.reset();
+        return;
+    }
+    DeviceManager& inst = DeviceManager::getInstance();
+    lock_guard<mutex> lock(inst.stream_mutex);
+    for (auto& s : inst.streams) {
+        if (s.get() == stream) {
+            bound_stream = s;
+            return;
+        }
+    }
+    AF_ERROR("Invalid CPU stream", AF_ERR_ARG);
+}
+
+queue* getActiveStream() { return bound_stream.get(); }
+
+void syncAllStreams() {
+    DeviceManager& inst = DeviceManager::getInstance();
+    for (auto& q : inst.queues) { q.sync(); }
+    lock_guard<mutex> lock(inst.stream_mutex);
+    for (auto& s : inst.streams) { s->sync(); }
+}
+
 bool& evalFlag() {
     thread_local bool flag = true;
     return flag;
@@ -154,8 +330,130 @@ MemoryManager& memoryManager() {
     return *(inst.memManager);
 }
 
+ThreadPool& threadPool() {
+    // Nested functions use the pool of the task that calls them
+    if (ThreadPool* pool = ThreadPool::current()) { return *pool; }
+    return threadPool(getActiveDeviceId());
+}
+
+ThreadPool& threadPool(int device) {
+    return *(DeviceManager::getInstance().thrPools[device]);
+}
+
 graphics::ForgeManager& forgeManager() {
     return *(DeviceManager::getInstance().fgMngr);
 }
 
 }  // namespace cpu
+
+af_err afcpu_set_num_threads(int num_threads) {
+    try {
+        ARG_ASSERT(0, num_threads >= 0);
+        // The pools can only be replaced when no function is using them
+        cpu::syncAllStreams();
+        for (int device = 0; device < cpu::getDeviceCount(); device++) {
+            cpu::ThreadPool& pool = cpu::threadPool(device);
+            int pool_size         = num_threads;
+            if (pool_size == 0) {
+                pool_size = cpu::getDefaultThreadCount(pool.getCores());
+            }
+            pool.reset(pool_size, pool.isPinned());
+        }
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_get_num_threads(int* num_threads) {
+    try {
+        ARG_ASSERT(0, num_threads != nullptr);
+        *num_threads = cpu::threadPool().size();
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_set_thread_affinity(bool pin) {
+    try {
+        cpu::syncAllStreams();
+        for (int device = 0; device < cpu::getDeviceCount(); device++) {
+            cpu::ThreadPool& pool = cpu::threadPool(device);
+            pool.reset(pool.size(), pin);
+        }
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_create_stream(afcpu_stream* stream) {
+    try {
+        ARG_ASSERT(0, stream != nullptr);
+        *stream = static_cast<afcpu_stream>(cpu::createStream());
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_release_stream(afcpu_stream stream) {
+    try {
+        ARG_ASSERT(0, stream != nullptr);
+        cpu::releaseStream(static_cast<cpu::queue*>(stream));
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_set_stream(afcpu_stream stream) {
+    try {
+        cpu::setActiveStream(static_cast<cpu::queue*>(stream));
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_get_stream(afcpu_stream* stream) {
+    try {
+        ARG_ASSERT(0, stream != nullptr);
+        *stream = static_cast<afcpu_stream>(cpu::getActiveStream());
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_get_queue_stats(afcpu_queue_stats* stats) {
+    try {
+        ARG_ASSERT(0, stats != nullptr);
+        const cpu::QueueStats& counters = cpu::getQueue().stats();
+        stats->queued        = counters.queued;
+        stats->inlined       = counters.inlined;
+        stats->stalls        = counters.stalls;
+        stats->stall_seconds = counters.stall_ns * 1e-9;
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_set_queue_limits(size_t max_functions, size_t max_bytes) {
+    try {
+        cpu::setQueueLimits(max_functions, max_bytes);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_get_numa_node_count(int* count) {
+    try {
+        ARG_ASSERT(0, count != nullptr);
+        *count = cpu::getNumaNodeCount();
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err afcpu_set_numa_policy(afcpu_numa_policy policy, int node) {
+    try {
+        cpu::setNumaPolicy(policy, node);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
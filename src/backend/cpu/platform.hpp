@@ -10,6 +10,8 @@
 #pragma once
 
 #include <queue.hpp>
+
+#include <memory>
 #include <string>
 
 namespace graphics {
@@ -19,6 +21,7 @@ class ForgeManager;
 namespace cpu {
 
 class MemoryManager;
+class ThreadPool;
 
 int getBackend();
 
@@ -32,6 +35,25 @@ void devprop(char* d_name, char* d_platform, char* d_toolkit, char* d_compute);
 
 unsigned getMaxJitSize();
 
+/// Returns the bytes of the cache that the JIT cost model fits the trees in
+size_t getJitCacheSize();
+
+/// Returns the largest number of elements that the functions run on the
+/// calling thread operate on when the queue is idle
+size_t getInlineElements();
+
+/// Returns the number of functions on a queue that makes the calling thread
+/// wait for the worker
+size_t getQueueMaxFunctions();
+
+/// Returns the bytes of the arrays used by the functions on a queue that
+/// makes the calling thread wait for the worker
+size_t getQueueMaxBytes();
+
+/// Overrides the limits of the queues. A limit of 0 restores the limit of
+/// the environment variable or the default.
+void setQueueLimits(size_t max_functions, size_t max_bytes);
+
 int getDeviceCount();
 
 int getActiveDeviceId();
@@ -42,14 +64,45 @@ size_t getHostMemorySize();
 
 int setDevice(int device);
 
-queue& getQueue(int device = 0);
+/// Returns the stream bound to the calling thread. The default queue of
+/// \p device is returned if the thread is not bound to a stream.
+queue& getQueue(int device);
+
+/// Returns the stream bound to the calling thread or the default queue of the
+/// active device. The functions the thread enqueues are named after \p caller
+/// in the profile.
+queue& getQueue(const char* caller = AF_CALLER_FUNCTION);
 
 void sync(int device);
 
+/// Creates a queue that executes functions independently of the default queue
+queue* createStream();
+
+/// Removes \p stream from the streams of the device. The stream is destroyed
+/// once its functions have completed and no thread is bound to it.
+void releaseStream(queue* stream);
+
+/// Binds the calling thread to \p stream. A null \p stream binds the thread
+/// to the default queue.
+void setActiveStream(queue* stream);
+
+/// Returns the stream bound to the calling thread or null for the default
+/// queue
+queue* getActiveStream();
+
+/// Waits for the functions of every stream of the device
+void syncAllStreams();
+
 bool& evalFlag();
 
 MemoryManager& memoryManager();
 
+/// Returns the pool of the worker running on the calling thread or the pool of
+/// the active device
+ThreadPool& threadPool();
+
+ThreadPool& threadPool(int device);
+
 graphics::ForgeManager& forgeManager();
 
 }  // namespace cpu
@@ -0,0 +1,250 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <profiler.hpp>
+
+#include <common/util.hpp>
+#include <err_cpu.hpp>
+#include <platform.hpp>
+#include <af/cpu.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::lock_guard;
+using std::move;
+using std::mutex;
+using std::string;
+using std::vector;
+using std::chrono::duration;
+using std::micro;
+
+namespace cpu {
+namespace profiler {
+
+namespace {
+
+/// The trace stops growing after this many functions
+constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+/// A function that ran on a queue
+struct TraceEvent {
+    string name;
+    string args;
+    size_t alloc_bytes;
+    int thread;
+    double start;  // microseconds since the profiler started
+    double duration;
+    double wait;  // microseconds between the enqueue and the start
+};
+
+struct Trace {
+    const string filename;
+    const clock::time_point origin;
+    mutex events_mutex;
+    vector<TraceEvent> events;
+    size_t dropped;
+
+    Trace()
+        : filename(getEnvVar("AF_CPU_PROFILE"))
+        , origin(clock::now())
+        , dropped(0) {}
+};
+
+Trace &trace() {
+    static Trace *instance = new Trace();
+    return *instance;
+}
+
+/// Writes the trace when the process exits. The trace itself is never
+/// destroyed so that functions that finish during the exit can still add to
+/// it.
+struct TraceWriter {
+    ~TraceWriter() {
+        if (enabled()) {
+            try {
+                writeTrace(nullptr);
+            } catch (...) {}
+        }
+    }
+};
+
+/// The information the calling thread set for its next function
+struct PendingRecord {
+    const char *caller = nullptr;
+    const char *name   = nullptr;
+    string args;
+    size_t alloc_bytes = 0;
+};
+
+thread_local PendingRecord pending;
+
+/// Small ids for the threads so that the trace viewer orders them
+int threadId() {
+    static std::atomic<int> next(0);
+    thread_local int id = next++;
+    return id;
+}
+
+double microseconds(clock::duration d) {
+    return duration<double, micro>(d).count();
+}
+
+const char *dtypeName(af_dtype type) {
+    switch (type) {
+        case f32: return "f32";
+        case c32: return "c32";
+        case f64: return "f64";
+        case c64: return "c64";
+        case b8: return "b8";
+        case s32: return "s32";
+        case u32: return "u32";
+        case u8: return "u8";
+        case s64: return "s64";
+        case u64: return "u64";
+        case s16: return "s16";
+        case u16: return "u16";
+        case f16: return "f16";
+        default: return "unknown";
+    }
+}
+
+/// Writes \p str as a JSON string
+void writeString(FILE *file, const string &str) {
+    fputc('"', file);
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+            fputc(c, file);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+}  // namespace
+
+bool enabled() {
+    static const bool is_enabled = !trace().filename.empty();
+    static TraceWriter writer;
+    return is_enabled;
+}
+
+void setCaller(const char *name) {
+    if (!enabled()) { return; }
+    pending.caller = name;
+}
+
+void setNextFunction(const char *name, string args) {
+    pending.name = name;
+    pending.args = move(args);
+}
+
+void addAllocation(size_t bytes) {
+    if (!enabled()) { return; }
+    pending.alloc_bytes += bytes;
+}
+
+Record takeRecord(string arrays) {
+    Record record;
+    if (pending.name) {
+        record.name = pending.name;
+        record.args = move(pending.args);
+        if (!arrays.empty()) { record.args += ", " + arrays; }
+    } else {
+        record.name = pending.caller ? pending.caller : "unknown";
+        record.args = move(arrays);
+    }
+    record.alloc_bytes = pending.alloc_bytes;
+    record.enqueued    = clock::now();
+
+    pending.name = nullptr;
+    pending.args.clear();
+    pending.alloc_bytes = 0;
+    return record;
+}
+
+void addRecord(const Record &record, clock::time_point start,
+               clock::time_point end) {
+    Trace &t = trace();
+    TraceEvent event{record.name,
+                     record.args,
+                     record.alloc_bytes,
+                     threadId(),
+                     microseconds(start - t.origin),
+                     microseconds(end - start),
+                     microseconds(start - record.enqueued)};
+
+    lock_guard<mutex> lock(t.events_mutex);
+    if (t.events.size() < MAX_TRACE_EVENTS) {
+        t.events.push_back(move(event));
+    } else {
+        t.dropped++;
+    }
+}
+
+void writeTrace(const char *filename) {
+    Trace &t = trace();
+    const string name = filename ? string(filename) : t.filename;
+    if (name.empty()) {
+        AF_ERROR("No file name is given and AF_CPU_PROFILE is not set",
+                 AF_ERR_ARG);
+    }
+
+    FILE *file = fopen(name.c_str(), "w");
+    if (!file) { AF_ERROR("Failed to open the trace file", AF_ERR_ARG); }
+
+    lock_guard<mutex> lock(t.events_mutex);
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < t.events.size(); i++) {
+        const TraceEvent &e = t.events[i];
+        fprintf(file, "{\"name\":");
+        writeString(file, e.name);
+        fprintf(file,
+                ",\"cat\":\"queue\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"args\":",
+                e.thread, e.start, e.duration);
+        writeString(file, e.args);
+        fprintf(file, ",\"wait_us\":%.3f,\"alloc_bytes\":%zu}}%s\n", e.wait,
+                e.alloc_bytes, i + 1 < t.events.size() ? "," : "");
+    }
+    fprintf(file, "],\"otherData\":{\"dropped_events\":%zu}}\n", t.dropped);
+    fclose(file);
+}
+
+void describeArray(string &out, af_dtype type, const af::dim4 &dims) {
+    if (!out.empty()) { out += ", "; }
+    out += dtypeName(type);
+    out += "[";
+    for (int i = 0; i < 4; i++) {
+        if (i) { out += " "; }
+        out += std::to_string(dims[i]);
+    }
+    out += "]";
+}
+
+}  // namespace profiler
+}  // namespace cpu
+
+af_err afcpu_write_profile(const char *filename) {
+    try {
+        // The functions on the queues are added to the trace when they finish
+        cpu::syncAllStreams();
+        cpu::profiler::writeTrace(filename);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
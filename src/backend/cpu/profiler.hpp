@@ -0,0 +1,116 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <Param.hpp>
+#include <common/defines.hpp>
+#include <common/traits.hpp>
+#include <af/defines.h>
+#include <af/dim4.hpp>
+#include <af/traits.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cpu {
+namespace profiler {
+
+using clock = std::chrono::steady_clock;
+
+/// Returns true if AF_CPU_PROFILE names the file the trace is written to
+bool enabled();
+
+/// Sets the name of the function that enqueues the next functions of the
+/// calling thread
+void setCaller(const char *name);
+
+/// Replaces the name and the description of the next function enqueued by
+/// the calling thread
+void setNextFunction(const char *name, std::string args);
+
+/// Adds \p bytes to the memory allocated for the next function enqueued by
+/// the calling thread
+void addAllocation(size_t bytes);
+
+/// A function on the queue
+struct Record {
+    std::string name;
+    std::string args;
+    size_t alloc_bytes;
+    clock::time_point enqueued;
+};
+
+/// Takes the information about the next function that the calling thread
+/// set since it enqueued the previous function. \p arrays describes the
+/// arrays the function is called with.
+Record takeRecord(std::string arrays);
+
+/// Adds a function that ran from \p start to \p end to the trace
+void addRecord(const Record &record, clock::time_point start,
+               clock::time_point end);
+
+/// Writes the trace in the Chrome trace event format to \p filename, or to
+/// the file named by AF_CPU_PROFILE if it is null
+void writeTrace(const char *filename);
+
+/// Appends the type and the dimensions of an array to \p out
+void describeArray(std::string &out, af_dtype type, const af::dim4 &dims);
+
+template<typename T>
+void describe(std::string &out, const Param<T> &param) {
+    describeArray(out, (af_dtype)af::dtype_traits<T>::af_type, param.dims());
+}
+
+template<typename T>
+void describe(std::string &out, const CParam<T> &param) {
+    describeArray(out, (af_dtype)af::dtype_traits<T>::af_type, param.dims());
+}
+
+template<typename T>
+void describe(std::string &out, const std::vector<Param<T>> &params) {
+    for (const auto &param : params) { describe(out, param); }
+}
+
+/// Arguments that are not arrays are not described
+template<typename T>
+void describe(std::string &, const T &) {}
+
+template<typename... Args>
+std::string describeArgs(const Args &... args) {
+    std::string out;
+    // Calls describe on each argument in order
+    int expand[] = {0, (describe(out, args), 0)...};
+    (void)expand;
+    return out;
+}
+
+/// Calls a function and adds the time it ran to the trace
+template<typename F>
+class Task {
+    F func_;
+    Record record_;
+
+   public:
+    Task(F func, Record record)
+        : func_(std::move(func)), record_(std::move(record)) {}
+
+    template<typename... Args>
+    void operator()(Args &&... args) const {
+        const clock::time_point start = clock::now();
+        func_(std::forward<Args>(args)...);
+        addRecord(record_, start, clock::now());
+    }
+};
+
+}  // namespace profiler
+}  // namespace cpu
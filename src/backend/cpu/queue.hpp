@@ -10,8 +10,16 @@
 
 #include <Param.hpp>
 #include <common/util.hpp>
+#include <graph.hpp>
+#include <profiler.hpp>
+#include <af/dim4.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
 
 // FIXME: Is there a better way to check for std::future not being supported ?
 #if defined(AF_DISABLE_CPU_ASYNC) || \
@@ -49,43 +57,244 @@ using event_impl = threads::event;
 
 namespace cpu {
   bool checkMemoryLimit();
+  size_t getInlineElements();
+  size_t getQueueMaxFunctions();
+  size_t getQueueMaxBytes();
+
+/// The arrays a function is called with
+struct ArgsSize {
+    size_t elements = 0;
+    size_t bytes    = 0;
+    int arrays      = 0;
+};
+
+/// Adds the size of an array a function is called with to \p size
+template<typename T>
+void measure(ArgsSize &size, const Param<T> &param) {
+    size.elements += param.dims().elements();
+    size.bytes += param.dims().elements() * sizeof(T);
+    size.arrays++;
+}
+
+template<typename T>
+void measure(ArgsSize &size, const CParam<T> &param) {
+    size.elements += param.dims().elements();
+    size.bytes += param.dims().elements() * sizeof(T);
+    size.arrays++;
+}
+
+/// The dimensions passed with a JIT tree or another input that is not an
+/// array. The function may iterate over that many elements.
+inline void measure(ArgsSize &size, const af::dim4 &dims) {
+    size.elements += dims.elements();
+}
+
+/// Arguments that are not arrays are not measured
+template<typename T>
+void measure(ArgsSize &, const T &) {}
+
+template<typename T>
+void measure(ArgsSize &size, const std::vector<T> &vals) {
+    for (const auto &val : vals) { measure(size, val); }
+}
+
+template<typename... Args>
+ArgsSize measureArgs(const Args &... args) {
+    ArgsSize size;
+    // Calls measure on each argument in order
+    int expand[] = {0, (measure(size, args), 0)...};
+    (void)expand;
+    return size;
+}
+
+/// The functions and the bytes of arrays on the worker that have not
+/// finished. The worker wakes the threads that wait for it to catch up.
+struct PendingWork {
+    std::atomic<size_t> functions{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<int> waiters{0};
+    std::mutex done_mutex;
+    std::condition_variable done;
+
+    void finish(size_t func_bytes) {
+        bytes -= func_bytes;
+        functions--;
+        if (waiters > 0) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done.notify_all();
+        }
+    }
+};
+
+/// Calls a function on the worker and marks it as finished
+template<typename F>
+class QueuedTask {
+    F func_;
+    PendingWork *pending_;
+    size_t bytes_;
+
+    struct Finish {
+        PendingWork *pending;
+        size_t bytes;
+        ~Finish() { pending->finish(bytes); }
+    };
+
+   public:
+    QueuedTask(F func, PendingWork *pending, size_t bytes)
+        : func_(std::move(func)), pending_(pending), bytes_(bytes) {}
+
+    template<typename... Args>
+    void operator()(Args &&... args) const {
+        Finish finish{pending_, bytes_};
+        func_(std::forward<Args>(args)...);
+    }
+};
+
+/// Marks the point on the worker after which the functions that follow an
+/// event wait may run
+struct WaitDone {
+    void operator()() const {}
+};
+
+/// Counters of the functions enqueued on a queue
+struct QueueStats {
+    std::atomic<unsigned long long> queued{0};
+    std::atomic<unsigned long long> inlined{0};
+    std::atomic<unsigned long long> stalls{0};
+    std::atomic<unsigned long long> stall_ns{0};
+};
 
 /// Wraps the async_queue class
 class queue {
    public:
     queue()
-        : count(0)
-        , sync_calls(__SYNCHRONOUS_ARCH == 1 ||
+        : sync_calls(__SYNCHRONOUS_ARCH == 1 ||
                      getEnvVar("AF_SYNCHRONOUS_CALLS") == "1") {}
 
     template<typename F, typename... Args>
     void enqueue(const F func, Args&&... args) {
-        count++;
-        if (sync_calls) {
-            func(toParam(std::forward<Args>(args))...);
+        if (Graph* graph = capturingGraph()) { graph->addTask(func, args...); }
+        if (profiler::enabled()) {
+            profiler::Task<F> task(func, profiler::takeRecord(
+                                             profiler::describeArgs(
+                                                 toParam(args)...)));
+            execute(task, std::forward<Args>(args)...);
         } else {
-            aQueue.enqueue(func, toParam(std::forward<Args>(args))...);
+            execute(func, std::forward<Args>(args)...);
         }
 #ifndef NDEBUG
-        sync();
+        wait();
 #else
-        if (checkMemoryLimit() || count >= 25) { sync(); }
+        if (sync_calls || is_worker()) { return; }
+        if (checkMemoryLimit()) {
+            // Buffers are only freed when the functions that use them finish
+            stall([this]() { return pending.functions == 0; });
+        } else if (pending.functions > getQueueMaxFunctions() ||
+                   pending.bytes > getQueueMaxBytes()) {
+            // Waits until the worker is half way through the functions so
+            // that the calling thread does not stall after every function
+            stall([this]() {
+                return pending.functions <= getQueueMaxFunctions() / 2 &&
+                       pending.bytes <= getQueueMaxBytes() / 2;
+            });
+        }
 #endif
     }
 
+    /// Waits for the functions on the queue so that the host can use their
+    /// results. The host work is not captured, so a graph captured across a
+    /// sync would replay stale results and is invalidated.
     void sync() {
-        count = 0;
-        if (!sync_calls) aQueue.sync();
+        if (Graph* graph = capturingGraph()) {
+            graph->invalidate("The host waited for the captured functions");
+        }
+        wait();
     }
 
     bool is_worker() const {
         return (!sync_calls) ? aQueue.is_worker() : false;
     }
 
+    /// Returns true if the worker has functions that have not finished
+    bool busy() const { return !sync_calls && pending.functions > 0; }
+
+    const QueueStats &stats() const { return counters; }
+
     friend class queue_event;
    private:
-    int count;
+    void wait() {
+        if (!sync_calls) aQueue.sync();
+    }
+
+    /// Enqueues a wait for an event of another queue. The wait counts as a
+    /// function on the worker until the worker passes it, so the functions
+    /// that follow it are not run on the calling thread before the event.
+    /// Marking an event does not need to be counted because it only signals
+    /// the functions before it.
+    template<typename E>
+    int enqueueWait(E &event) {
+        if (sync_calls) { return event.wait(aQueue); }
+        std::lock_guard<std::recursive_mutex> lock(order_mutex);
+        pending.functions++;
+        const int err = event.wait(aQueue);
+        aQueue.enqueue(QueuedTask<WaitDone>(WaitDone(), &pending, 0));
+        return err;
+    }
+
+    template<typename F, typename... Args>
+    void execute(const F& func, Args&&... args) {
+        if (sync_calls) {
+            counters.inlined++;
+            func(toParam(std::forward<Args>(args))...);
+            return;
+        }
+
+        // Functions on small arrays run on the calling thread when the worker
+        // has no functions that they would have to wait for. Sending them to
+        // the worker and waiting for their results takes longer than running
+        // them. The default queue is shared by the threads that have not set
+        // a stream, so the check and the call are made under the lock. The
+        // functions of the other threads are run or enqueued after them.
+        const ArgsSize size = measureArgs(toParam(args)...);
+        std::lock_guard<std::recursive_mutex> lock(order_mutex);
+        if (pending.functions == 0 && size.arrays > 0 &&
+            size.elements <= getInlineElements()) {
+            counters.inlined++;
+            func(toParam(std::forward<Args>(args))...);
+        } else {
+            counters.queued++;
+            pending.bytes += size.bytes;
+            pending.functions++;
+            aQueue.enqueue(QueuedTask<F>(func, &pending, size.bytes),
+                           toParam(std::forward<Args>(args))...);
+        }
+    }
+
+    /// Blocks the calling thread until \p caught_up returns true
+    template<typename P>
+    void stall(P caught_up) {
+        if (caught_up()) { return; }
+        const auto start = std::chrono::steady_clock::now();
+        pending.waiters++;
+        {
+            std::unique_lock<std::mutex> lock(pending.done_mutex);
+            pending.done.wait(lock, caught_up);
+        }
+        pending.waiters--;
+        counters.stalls++;
+        counters.stall_ns += std::chrono::duration_cast<
+                                 std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+    }
+
     const bool sync_calls;
+    /// Orders the functions run on the calling threads with the functions
+    /// and events enqueued on the worker. A function run on the calling
+    /// thread may enqueue other functions.
+    std::recursive_mutex order_mutex;
+    PendingWork pending;
+    QueueStats counters;
     queue_impl aQueue;
 };
 
@@ -97,8 +306,11 @@ class queue {
 
     int create() { return event_.create(); }
 
-    int mark(queue &q) { return event_.mark(q.aQueue); }
-    int wait(queue &q) { return event_.wait(q.aQueue); }
+    int mark(queue &q) {
+        std::lock_guard<std::recursive_mutex> lock(q.order_mutex);
+        return event_.mark(q.aQueue);
+    }
+    int wait(queue &q) { return q.enqueueWait(event_); }
     int sync() noexcept { return event_.sync(); }
     operator bool() const noexcept { return event_; }
   };
@@ -44,6 +44,14 @@ Array<To> reduce(const Array<Ti> &in, const int dim, bool change_nan,
     odims[dim] = 1;
 
     Array<To> out = createEmptyArray<To>(odims);
+    if (!in.isReady()) {
+        // The JIT tree is reduced while it is evaluated so its values are
+        // never written to memory
+        getQueue().enqueue(kernel::reduce_dim_node<op, Ti, To>, out,
+                           in.getNode(), in.dims(), dim, change_nan, nanval);
+        return out;
+    }
+
     static const reduce_dim_func<op, Ti, To> reduce_funcs[4] = {
         kernel::reduce_dim<op, Ti, To, 1>(),
         kernel::reduce_dim<op, Ti, To, 2>(),
@@ -58,39 +66,18 @@ Array<To> reduce(const Array<Ti> &in, const int dim, bool change_nan,
 
 template<af_op_t op, typename Ti, typename To>
 To reduce_all(const Array<Ti> &in, bool change_nan, double nanval) {
-    in.eval();
-    getQueue().sync();
-
-    Transform<Ti, To, op> transform;
-    Binary<To, op> reduce;
-
-    compute_t<To> out = Binary<To, op>::init();
-
-    // Decrement dimension of select dimension
-    af::dim4 dims           = in.dims();
-    af::dim4 strides        = in.strides();
-    const data_t<Ti> *inPtr = in.get();
-
-    for (dim_t l = 0; l < dims[3]; l++) {
-        dim_t off3 = l * strides[3];
-
-        for (dim_t k = 0; k < dims[2]; k++) {
-            dim_t off2 = k * strides[2];
-
-            for (dim_t j = 0; j < dims[1]; j++) {
-                dim_t off1 = j * strides[1];
-
-                for (dim_t i = 0; i < dims[0]; i++) {
-                    dim_t idx = i + off1 + off2 + off3;
-
-                    compute_t<To> in_val = transform(inPtr[idx]);
-                    if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
-                    out = reduce(in_val, out);
-                }
-            }
-        }
+    // The result is written by the queue so that it follows the functions
+    // that compute the input. getNode evaluates a tree that is used by other
+    // trees first, so its values are computed once.
+    compute_t<To> out;
+    if (!in.isReady()) {
+        getQueue().enqueue(kernel::reduce_all_node<op, Ti, To>, &out,
+                           in.getNode(), in.dims(), change_nan, nanval);
+    } else {
+        getQueue().enqueue(kernel::reduce_all<op, Ti, To>, &out, in,
+                           change_nan, nanval);
     }
-
+    getQueue().sync();
     return data_t<To>(out);
 }
 
@@ -0,0 +1,95 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <simd.hpp>
+
+#include <common/util.hpp>
+#include <device_manager.hpp>
+
+#include <string>
+
+using std::string;
+
+namespace cpu {
+namespace simd {
+
+static Isa detectIsa() {
+    Isa isa = Isa::None;
+    // The kernels of an instruction set are only built if the compiler
+    // supports it. See kernel/simd/CMakeLists.txt
+#if defined(AF_CPU_SIMD_AVX2) || defined(AF_CPU_SIMD_AVX512)
+    const CPUInfo info = DeviceManager::getInstance().getCPUInfo();
+#if defined(AF_CPU_SIMD_AVX2)
+    if (info.hasAVX2()) { isa = Isa::AVX2; }
+#endif
+#if defined(AF_CPU_SIMD_AVX512)
+    if (info.hasAVX512()) { isa = Isa::AVX512; }
+#endif
+#endif
+
+    string env_var = getEnvVar("AF_CPU_SIMD");
+    if (env_var == "none" || env_var == "0") {
+        isa = Isa::None;
+    } else if (env_var == "avx2" && isa > Isa::AVX2) {
+        isa = Isa::AVX2;
+    }
+    return isa;
+}
+
+Isa getIsa() {
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+#if defined(AF_CPU_SIMD_AVX2)
+#define SIMD_AVX2_CASE(FUNC, To, Ti) \
+    case Isa::AVX2: return avx2::FUNC<To, Ti>(op);
+#else
+#define SIMD_AVX2_CASE(FUNC, To, Ti)
+#endif
+
+#if defined(AF_CPU_SIMD_AVX512)
+#define SIMD_AVX512_CASE(FUNC, To, Ti) \
+    case Isa::AVX512: return avx512::FUNC<To, Ti>(op);
+#else
+#define SIMD_AVX512_CASE(FUNC, To, Ti)
+#endif
+
+#define SIMD_DISPATCH(FUNC, To, Ti)      \
+    switch (getIsa()) {                  \
+        SIMD_AVX512_CASE(FUNC, To, Ti)   \
+        SIMD_AVX2_CASE(FUNC, To, Ti)     \
+        default: break;                  \
+    }                                    \
+    UNUSED(op);                          \
+    return nullptr;
+
+#define SIMD_BINARY_DEF(To, Ti)                               \
+    template<>                                                \
+    BinaryFunc<To, Ti> getBinaryFunc<To, Ti>(af_op_t op) {    \
+        SIMD_DISPATCH(getBinaryFunc, To, Ti)                  \
+    }
+
+#define SIMD_UNARY_DEF(To, Ti)                                \
+    template<>                                                \
+    UnaryFunc<To, Ti> getUnaryFunc<To, Ti>(af_op_t op) {      \
+        SIMD_DISPATCH(getUnaryFunc, To, Ti)                   \
+    }
+
+SIMD_BINARY_TYPES(SIMD_BINARY_DEF)
+SIMD_UNARY_TYPES(SIMD_UNARY_DEF)
+
+#undef SIMD_UNARY_DEF
+#undef SIMD_BINARY_DEF
+#undef SIMD_DISPATCH
+#undef SIMD_AVX512_CASE
+#undef SIMD_AVX2_CASE
+
+}  // namespace simd
+}  // namespace cpu
@@ -0,0 +1,105 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <common/defines.hpp>
+#include <optypes.hpp>
+#include <types.hpp>
+
+/// Vectorized element-wise kernels used by the BinOp and UnOp functors of the
+/// JIT nodes.
+///
+/// The kernels are compiled once for each supported instruction set (see
+/// kernel/simd_impl.hpp) and the widest one supported by the host is selected
+/// at runtime. The functions return nullptr when an operation has no
+/// vectorized kernel and the functor falls back to its scalar loop.
+namespace cpu {
+namespace simd {
+
+enum class Isa { None = 0, AVX2 = 1, AVX512 = 2 };
+
+template<typename To, typename Ti>
+using BinaryFunc = void (*)(To *out, const Ti *lhs, const Ti *rhs, int lim);
+
+template<typename To, typename Ti>
+using UnaryFunc = void (*)(To *out, const Ti *in, int lim);
+
+/// Returns the instruction set used by the vectorized kernels. Detected once
+/// and limited by the AF_CPU_SIMD environment variable.
+Isa getIsa();
+
+template<typename To, typename Ti>
+BinaryFunc<To, Ti> getBinaryFunc(af_op_t op) {
+    UNUSED(op);
+    return nullptr;
+}
+
+template<typename To, typename Ti>
+UnaryFunc<To, Ti> getUnaryFunc(af_op_t op) {
+    UNUSED(op);
+    return nullptr;
+}
+
+// The types that have vectorized kernels
+#define SIMD_BINARY_TYPES(FN) \
+    FN(float, float)          \
+    FN(double, double)        \
+    FN(int, int)              \
+    FN(uint, uint)            \
+    FN(intl, intl)            \
+    FN(uintl, uintl)          \
+    FN(short, short)          \
+    FN(ushort, ushort)        \
+    FN(char, char)            \
+    FN(uchar, uchar)          \
+    FN(char, float)           \
+    FN(char, double)          \
+    FN(char, int)             \
+    FN(char, uint)            \
+    FN(char, intl)            \
+    FN(char, uintl)           \
+    FN(char, short)           \
+    FN(char, ushort)          \
+    FN(char, uchar)
+
+#define SIMD_UNARY_TYPES(FN) \
+    FN(float, float)         \
+    FN(double, double)
+
+#define SIMD_BINARY_DECL(To, Ti) \
+    template<>                   \
+    BinaryFunc<To, Ti> getBinaryFunc<To, Ti>(af_op_t op);
+
+#define SIMD_UNARY_DECL(To, Ti) \
+    template<>                  \
+    UnaryFunc<To, Ti> getUnaryFunc<To, Ti>(af_op_t op);
+
+SIMD_BINARY_TYPES(SIMD_BINARY_DECL)
+SIMD_UNARY_TYPES(SIMD_UNARY_DECL)
+
+// Implemented once per instruction set by kernel/simd/simd_impl.cpp
+#define SIMD_ISA_DECL(ISA)                                   \
+    namespace ISA {                                          \
+    template<typename To, typename Ti>                       \
+    BinaryFunc<To, Ti> getBinaryFunc(af_op_t op);            \
+    template<typename To, typename Ti>                       \
+    UnaryFunc<To, Ti> getUnaryFunc(af_op_t op);              \
+    SIMD_BINARY_TYPES(SIMD_BINARY_DECL)                      \
+    SIMD_UNARY_TYPES(SIMD_UNARY_DECL)                        \
+    }
+
+SIMD_ISA_DECL(avx2)
+SIMD_ISA_DECL(avx512)
+
+#undef SIMD_ISA_DECL
+#undef SIMD_UNARY_DECL
+#undef SIMD_BINARY_DECL
+
+}  // namespace simd
+}  // namespace cpu
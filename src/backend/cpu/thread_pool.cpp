@@ -0,0 +1,305 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <thread_pool.hpp>
+
+#include <common/defines.hpp>
+#include <common/dispatch.hpp>
+#include <common/err_common.hpp>
+#include <common/util.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+
+#if defined(OS_LNX)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(OS_WIN)
+#include <windows.h>
+#endif
+
+using std::exception_ptr;
+using std::function;
+using std::lock_guard;
+using std::max;
+using std::mutex;
+using std::stoi;
+using std::string;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+namespace cpu {
+
+namespace {
+// The pool and index of the worker running on this thread
+thread_local ThreadPool *current_pool = nullptr;
+thread_local int current_index        = -1;
+}  // namespace
+
+TaskGroup::TaskGroup(ThreadPool &pool_) : pool(pool_), pending(0) {}
+
+TaskGroup::~TaskGroup() { waitAll(); }
+
+void TaskGroup::run(function<void()> task) {
+    pending.fetch_add(1);
+    pool.submit([this, task] {
+        exception_ptr task_error;
+        try {
+            task();
+        } catch (...) { task_error = std::current_exception(); }
+        finish(task_error);
+    });
+}
+
+void TaskGroup::finish(exception_ptr task_error) {
+    // The counter is decremented under the lock so that the group is not
+    // destroyed by the waiting thread before this function returns
+    lock_guard<mutex> lock(group_mutex);
+    if (task_error && !error) { error = task_error; }
+    if (pending.fetch_sub(1) == 1) { group_cv.notify_all(); }
+}
+
+void TaskGroup::waitAll() {
+    while (pending.load() > 0) {
+        if (pool.runOneTask()) { continue; }
+        // The remaining tasks are running on other threads. Wake up
+        // periodically to help with tasks they create.
+        unique_lock<mutex> lock(group_mutex);
+        group_cv.wait_for(lock, std::chrono::microseconds(100),
+                          [this] { return pending.load() == 0; });
+    }
+    lock_guard<mutex> lock(group_mutex);
+}
+
+void TaskGroup::wait() {
+    waitAll();
+    if (error) {
+        exception_ptr task_error = error;
+        error                    = nullptr;
+        std::rethrow_exception(task_error);
+    }
+}
+
+ThreadPool::ThreadPool(int num_threads, bool pin_threads, vector<int> cores_)
+    : num_queued(0)
+    , stop(false)
+    , pinned(false)
+    , cores(std::move(cores_))
+    , active_calls(0) {
+    startWorkers(num_threads, pin_threads);
+}
+
+ThreadPool::~ThreadPool() { stopWorkers(); }
+
+ThreadPool *ThreadPool::current() { return current_pool; }
+
+void ThreadPool::reset(int num_threads, bool pin_threads) {
+    if (current_pool == this) {
+        AF_ERROR("A thread pool cannot be reset by its own tasks",
+                 AF_ERR_RUNTIME);
+    }
+    unique_lock<mutex> lock(reset_mutex);
+    reset_cv.wait(lock, [this] { return active_calls == 0; });
+    stopWorkers();
+    startWorkers(num_threads, pin_threads);
+}
+
+void ThreadPool::startWorkers(int num_threads, bool pin_threads) {
+    stop   = false;
+    pinned = pin_threads;
+    vector<int> all_cores = cores;
+    if (all_cores.empty()) {
+        const int num_cores =
+            max(1, static_cast<int>(thread::hardware_concurrency()));
+        for (int i = 0; i < num_cores; i++) { all_cores.push_back(i); }
+    }
+    for (int i = 1; i < num_threads; i++) {
+        workers.emplace_back(new Worker());
+        // The calling thread is not pinned. The workers take the cores
+        // after the first one.
+        if (pinned) {
+            workers.back()->affinity.push_back(all_cores[i % all_cores.size()]);
+        } else {
+            workers.back()->affinity = cores;
+        }
+    }
+    // The workers are started after the vector is complete because they
+    // read it
+    for (int i = 0; i < static_cast<int>(workers.size()); i++) {
+        workers[i]->thread = thread(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+void ThreadPool::stopWorkers() {
+    {
+        lock_guard<mutex> lock(sleep_mutex);
+        stop = true;
+    }
+    sleep_cv.notify_all();
+    for (auto &worker : workers) { worker->thread.join(); }
+    workers.clear();
+}
+
+void ThreadPool::workerLoop(int index) {
+    current_pool  = this;
+    current_index = index;
+    // Each worker restricts itself so that the native handles of the
+    // threads are not needed
+    const vector<int> &affinity = workers[index]->affinity;
+    if (!affinity.empty()) { setCurrentThreadAffinity(affinity); }
+    while (true) {
+        if (runOneTask()) { continue; }
+        unique_lock<mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [this] { return stop || num_queued.load() > 0; });
+        if (stop) { return; }
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    if (current_pool == this) {
+        Worker &self = *workers[current_index];
+        lock_guard<mutex> lock(self.tasks_mutex);
+        self.tasks.push_back(std::move(task));
+    } else {
+        lock_guard<mutex> lock(shared_mutex);
+        shared_tasks.push_back(std::move(task));
+    }
+    num_queued.fetch_add(1);
+    // Taking the lock prevents a worker from missing the notification
+    // between checking num_queued and going to sleep
+    { lock_guard<mutex> lock(sleep_mutex); }
+    sleep_cv.notify_one();
+}
+
+bool ThreadPool::runOneTask() {
+    if (num_queued.load() == 0) { return false; }
+
+    const int num_workers = static_cast<int>(workers.size());
+    const int self        = (current_pool == this) ? current_index : -1;
+    Task task;
+
+    // The most recent task of this worker is the most likely to be in cache
+    if (self >= 0) {
+        Worker &worker = *workers[self];
+        lock_guard<mutex> lock(worker.tasks_mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+    }
+    if (!task) {
+        lock_guard<mutex> lock(shared_mutex);
+        if (!shared_tasks.empty()) {
+            task = std::move(shared_tasks.front());
+            shared_tasks.pop_front();
+        }
+    }
+    // Steal the oldest task of another worker. It is usually the largest
+    // range created by splitRange.
+    for (int i = 1; !task && i <= num_workers; i++) {
+        const int index = (self + i + num_workers) % num_workers;
+        if (index == self) { continue; }
+        Worker &victim = *workers[index];
+        lock_guard<mutex> lock(victim.tasks_mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task) { return false; }
+    num_queued.fetch_sub(1);
+    task();
+    return true;
+}
+
+void ThreadPool::splitRange(TaskGroup &group, dim_t begin, dim_t end,
+                            dim_t range,
+                            const function<void(dim_t, dim_t)> &func) {
+    // The upper halves are scheduled as tasks and the lower half is split
+    // further on this thread
+    while (end - begin > range) {
+        dim_t mid = begin + (end - begin) / 2;
+        group.run([this, &group, mid, end, range, &func] {
+            splitRange(group, mid, end, range, func);
+        });
+        end = mid;
+    }
+    func(begin, end);
+}
+
+void ThreadPool::parallel_for(dim_t count, dim_t grain,
+                              const function<void(dim_t, dim_t)> &func) {
+    if (count <= 0) { return; }
+    if (current_pool == this) {
+        runParallel(count, grain, func);
+        return;
+    }
+
+    // Calls from outside the pool keep reset from replacing the workers
+    // while they use them
+    {
+        lock_guard<mutex> lock(reset_mutex);
+        active_calls++;
+    }
+    auto leave = [this] {
+        lock_guard<mutex> lock(reset_mutex);
+        if (--active_calls == 0) { reset_cv.notify_all(); }
+    };
+    try {
+        runParallel(count, grain, func);
+    } catch (...) {
+        leave();
+        throw;
+    }
+    leave();
+}
+
+void ThreadPool::runParallel(dim_t count, dim_t grain,
+                             const function<void(dim_t, dim_t)> &func) {
+    // Create a few ranges per thread so that uneven ranges are balanced
+    const dim_t ranges_per_thread = 4;
+    dim_t range = max(max(grain, dim_t(1)),
+                      divup(count, dim_t(size()) * ranges_per_thread));
+    if (count <= range || workers.empty()) {
+        func(0, count);
+        return;
+    }
+
+    TaskGroup group(*this);
+    splitRange(group, 0, count, range, func);
+    group.wait();
+}
+
+int getDefaultThreadCount(const vector<int> &cores) {
+    string env_var = getEnvVar("AF_CPU_NUM_THREADS");
+    if (!env_var.empty()) { return max(1, stoi(env_var)); }
+    if (!cores.empty()) { return static_cast<int>(cores.size()); }
+    return max(1, static_cast<int>(thread::hardware_concurrency()));
+}
+
+void setCurrentThreadAffinity(const vector<int> &cores) {
+#if defined(OS_LNX)
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int core : cores) { CPU_SET(core, &cpuset); }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+#elif defined(OS_WIN)
+    DWORD_PTR mask = 0;
+    for (int core : cores) { mask |= static_cast<DWORD_PTR>(1) << (core % 64); }
+    SetThreadAffinityMask(GetCurrentThread(), mask);
+#else
+    UNUSED(cores);
+#endif
+}
+
+}  // namespace cpu
@@ -0,0 +1,172 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <af/defines.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpu {
+
+class ThreadPool;
+
+/// A set of tasks executed by a ThreadPool that can be waited on together
+///
+/// Tasks may create their own TaskGroup and wait on it. A thread waiting on a
+/// group executes the pending tasks of the pool instead of blocking, so nested
+/// parallelism does not deadlock and does not oversubscribe the cores.
+class TaskGroup {
+   public:
+    explicit TaskGroup(ThreadPool &pool);
+
+    /// Waits for the tasks that are still running. Exceptions thrown by the
+    /// tasks are discarded; call wait to receive them.
+    ~TaskGroup();
+
+    /// Schedules \p task on the pool
+    void run(std::function<void()> task);
+
+    /// Returns after every task of the group has completed. The first
+    /// exception thrown by a task is rethrown on the calling thread.
+    void wait();
+
+   private:
+    TaskGroup(TaskGroup const &) = delete;
+    void operator=(TaskGroup const &) = delete;
+
+    void waitAll();
+    void finish(std::exception_ptr task_error);
+
+    ThreadPool &pool;
+    std::atomic<int> pending;
+    std::exception_ptr error;
+    std::mutex group_mutex;
+    std::condition_variable group_cv;
+};
+
+/// A work-stealing pool of worker threads used to split a kernel across cores
+///
+/// Kernels are still enqueued on the cpu::queue. Inside the kernel, the work
+/// can be partitioned with parallel_for or a TaskGroup. Each worker owns a
+/// deque of tasks. A worker pushes and pops the tasks it creates at the back
+/// of its deque and steals from the front of the other deques when it runs
+/// out of work. Tasks created by threads outside the pool are pushed to a
+/// shared deque.
+///
+/// The calling thread participates in the work so a pool with zero workers
+/// degrades to a serial loop.
+class ThreadPool {
+   public:
+    /// \param[in] num_threads The total number of threads that will execute a
+    ///                        parallel_for including the calling thread
+    /// \param[in] pin_threads Pins each worker to a core if true
+    /// \param[in] cores       The logical CPUs the workers run on. The
+    ///                        workers may run on any CPU if it is empty.
+    explicit ThreadPool(int num_threads, bool pin_threads = false,
+                        std::vector<int> cores = std::vector<int>());
+    ~ThreadPool();
+
+    /// Returns the number of threads that execute a parallel_for
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    /// Returns true if the workers are pinned to cores
+    bool isPinned() const { return pinned; }
+
+    /// Returns the logical CPUs the workers run on or an empty vector if
+    /// they may run on any CPU
+    const std::vector<int> &getCores() const { return cores; }
+
+    /// Returns the pool whose worker is running on the calling thread or null
+    static ThreadPool *current();
+
+    /// Replaces the workers of the pool
+    ///
+    /// Waits for the parallel_for calls that are running on other threads,
+    /// and blocks new calls until the workers are replaced. Throws if it is
+    /// called by a task of the pool.
+    void reset(int num_threads, bool pin_threads);
+
+    /// Calls \p func on contiguous sub-ranges of [0, \p count)
+    ///
+    /// \param[in] count The number of work items
+    /// \param[in] grain The minimum number of work items in a range
+    /// \param[in] func  Called with the [begin, end) of each range. It may be
+    ///                  called concurrently from multiple threads and may
+    ///                  call parallel_for itself
+    ///
+    /// This function returns after every range has completed. The first
+    /// exception thrown by \p func is rethrown on the calling thread.
+    void parallel_for(dim_t count, dim_t grain,
+                      const std::function<void(dim_t, dim_t)> &func);
+
+   private:
+    friend class TaskGroup;
+    using Task = std::function<void()>;
+
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex tasks_mutex;
+        std::thread thread;
+        std::vector<int> affinity;  // The CPUs of the worker or empty
+    };
+
+    ThreadPool(ThreadPool const &) = delete;
+    void operator=(ThreadPool const &) = delete;
+
+    void startWorkers(int num_threads, bool pin_threads);
+    void stopWorkers();
+    void workerLoop(int index);
+
+    /// Pushes \p task on the deque of the calling worker or the shared deque
+    void submit(Task task);
+
+    /// Runs one pending task. Returns false if there was none.
+    bool runOneTask();
+
+    void splitRange(TaskGroup &group, dim_t begin, dim_t end, dim_t range,
+                    const std::function<void(dim_t, dim_t)> &func);
+
+    void runParallel(dim_t count, dim_t grain,
+                     const std::function<void(dim_t, dim_t)> &func);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::deque<Task> shared_tasks;
+    std::mutex shared_mutex;
+    std::atomic<int> num_queued;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    bool stop;
+    bool pinned;
+    std::vector<int> cores;
+
+    // The parallel_for calls of threads outside the pool that are running.
+    // reset holds the mutex while it replaces the workers.
+    std::mutex reset_mutex;
+    std::condition_variable reset_cv;
+    int active_calls;
+};
+
+/// Returns the number of threads the CPU backend uses for a kernel. Reads
+/// the AF_CPU_NUM_THREADS environment variable and defaults to the number of
+/// \p cores or the number of hardware threads if \p cores is empty.
+int getDefaultThreadCount(const std::vector<int> &cores = std::vector<int>());
+
+/// Restricts the calling thread to \p cores. Not supported on macOS.
+void setCurrentThreadAffinity(const std::vector<int> &cores);
+
+}  // namespace cpu
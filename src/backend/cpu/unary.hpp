@@ -12,6 +12,7 @@
 #include <err_cpu.hpp>
 #include <jit/UnaryNode.hpp>
 #include <optypes.hpp>
+#include <simd.hpp>
 #include <cmath>
 
 namespace cpu {
@@ -30,6 +31,12 @@ T rsqrt(T in) {
     template<typename T>                                                  \
     struct UnOp<T, T, af_##op##_t> {                                      \
         void eval(jit::array<T> &out, const jit::array<T> &in, int lim) { \
+            static const auto simd_func =                                 \
+                simd::getUnaryFunc<T, T>(af_##op##_t);                    \
+            if (simd_func) {                                              \
+                simd_func(out.data(), in.data(), lim);                    \
+                return;                                                   \
+            }                                                             \
             for (int i = 0; i < lim; i++) { out[i] = fn(in[i]); }         \
         }                                                                 \
     };
@@ -81,11 +88,11 @@ UNARY_OP(lgamma)
 
 template<typename T, af_op_t op>
 Array<T> unaryOp(const Array<T> &in, dim4 outDim = dim4(-1, -1, -1, -1)) {
-    jit::Node_ptr in_node          = in.getNode();
-    jit::UnaryNode<T, T, op> *node = new jit::UnaryNode<T, T, op>(in_node);
+    jit::Node_ptr in_node = in.getNode();
+    jit::Node_ptr node    = jit::createUnaryNode<T, T, op>(in_node);
 
     if (outDim == dim4(-1, -1, -1, -1)) { outDim = in.dims(); }
-    return createNodeArray<T>(outDim, jit::Node_ptr(node));
+    return createNodeArray<T>(outDim, node);
 }
 
 #define iszero(a) ((a) == 0)
@@ -106,11 +113,10 @@ CHECK_FN(iszero, iszero)
 template<typename T, af_op_t op>
 Array<char> checkOp(const Array<T> &in, dim4 outDim = dim4(-1, -1, -1, -1)) {
     jit::Node_ptr in_node = in.getNode();
-    jit::UnaryNode<char, T, op> *node =
-        new jit::UnaryNode<char, T, op>(in_node);
+    jit::Node_ptr node    = jit::createUnaryNode<char, T, op>(in_node);
 
     if (outDim == dim4(-1, -1, -1, -1)) { outDim = in.dims(); }
-    return createNodeArray<char>(outDim, jit::Node_ptr(node));
+    return createNodeArray<char>(outDim, node);
 }
 
 }  // namespace cpu
@@ -8,6 +8,7 @@
  ********************************************************/
 
 #include <Array.hpp>
+#include <common/allocation_scope.hpp>
 #include <common/half.hpp>
 #include <common/jit/NodeIterator.hpp>
 #include <copy.hpp>
@@ -143,6 +144,8 @@ void Array<T>::eval() {
     if (isReady()) return;
 
     this->setId(getActiveDeviceId());
+    // The buffers of evaluated JIT trees are attributed to "jit"
+    common::AllocationScope scope("jit");
     this->data = shared_ptr<T>(memAlloc<T>(elements()).release(), memFree<T>);
 
     ready = true;
@@ -172,6 +175,8 @@ void evalMultiple(std::vector<Array<T> *> arrays) {
     vector<Array<T> *> output_arrays;
     vector<Node *> nodes;
 
+    // The buffers of evaluated JIT trees are attributed to "jit"
+    common::AllocationScope scope("jit");
     for (Array<T> *array : arrays) {
         if (array->isReady()) { continue; }
 
@@ -314,7 +319,8 @@ Array<T> createValueArray(const dim4 &dims, const T &value) {
 }
 
 template<typename T>
-Array<T> createEmptyArray(const dim4 &dims) {
+Array<T> createEmptyArray(const dim4 &dims, const char *caller) {
+    common::AllocationScope scope(caller);
     return Array<T>(dims);
 }
 
@@ -401,7 +407,8 @@ void Array<T>::setDataDims(const dim4 &new_dims) {
                                              const T *const data);            \
     template Array<T> createDeviceDataArray<T>(const dim4 &size, void *data); \
     template Array<T> createValueArray<T>(const dim4 &size, const T &value);  \
-    template Array<T> createEmptyArray<T>(const dim4 &size);                  \
+    template Array<T> createEmptyArray<T>(const dim4 &size,                   \
+                                          const char *caller);                \
     template Array<T> createParamArray<T>(Param<T> & tmp, bool owner);        \
     template Array<T> createSubArray<T>(                                      \
         const Array<T> &parent, const std::vector<af_seq> &index, bool copy); \
@@ -9,6 +9,7 @@
 
 #include <Array.hpp>
 
+#include <common/allocation_scope.hpp>
 #include <common/half.hpp>
 #include <common/jit/NodeIterator.hpp>
 #include <common/util.hpp>
@@ -153,6 +154,8 @@ void Array<T>::eval() {
     if (isReady()) return;
 
     this->setId(getActiveDeviceId());
+    // The buffers of evaluated JIT trees are attributed to "jit"
+    common::AllocationScope scope("jit");
     data = Buffer_ptr(bufferAlloc(elements() * sizeof(T)), bufferFree);
 
     // Do not replace this with cast operator
@@ -187,6 +190,8 @@ void evalMultiple(vector<Array<T> *> arrays) {
     vector<Array<T> *> output_arrays;
     vector<Node *> nodes;
 
+    // The buffers of evaluated JIT trees are attributed to "jit"
+    common::AllocationScope scope("jit");
     for (Array<T> *array : arrays) {
         if (array->isReady()) { continue; }
 
@@ -387,7 +392,8 @@ Array<T> createValueArray(const dim4 &size, const T &value) {
 }
 
 template<typename T>
-Array<T> createEmptyArray(const dim4 &size) {
+Array<T> createEmptyArray(const dim4 &size, const char *caller) {
+    common::AllocationScope scope(caller);
     verifyTypeSupport<T>();
     return Array<T>(size);
 }
@@ -442,7 +448,8 @@ void Array<T>::setDataDims(const dim4 &new_dims) {
                                              const T *const data);            \
     template Array<T> createDeviceDataArray<T>(const dim4 &dims, void *data); \
     template Array<T> createValueArray<T>(const dim4 &dims, const T &value);  \
-    template Array<T> createEmptyArray<T>(const dim4 &dims);                  \
+    template Array<T> createEmptyArray<T>(const dim4 &dims,                   \
+                                          const char *caller);                \
     template Array<T> createParamArray<T>(Param & tmp, bool owner);           \
     template Array<T> createSubArray<T>(                                      \
         const Array<T> &parent, const vector<af_seq> &index, bool copy);      \
@@ -11,6 +11,7 @@
 #include <Param.hpp>
 #include <backend.hpp>
 #include <common/ArrayInfo.hpp>
+#include <common/defines.hpp>
 #include <common/jit/Node.hpp>
 #include <err_opencl.hpp>
 #include <memory.hpp>
@@ -65,8 +66,11 @@ void writeDeviceDataArray(Array<T> &arr, const void *const data,
 /// Creates an empty array of a given size. No data is initialized
 ///
 /// \param[in] size The dimension of the output array
+/// \param[in] caller The function the allocation is attributed to in the
+///                   memory statistics
 template<typename T>
-Array<T> createEmptyArray(const af::dim4 &dims);
+Array<T> createEmptyArray(const af::dim4 &dims,
+                          const char *caller = AF_CALLER_FUNCTION);
 
 /// Create an Array object from Param object.
 ///
@@ -273,7 +277,8 @@ class Array {
                                           dim_t offset, const T *const in_data,
                                           bool is_device);
 
-    friend Array<T> createEmptyArray<T>(const af::dim4 &dims);
+    friend Array<T> createEmptyArray<T>(const af::dim4 &dims,
+                                        const char *caller);
     friend Array<T> createParamArray<T>(Param &tmp, bool owner);
     friend Array<T> createNodeArray<T>(const af::dim4 &dims,
                                        common::Node_ptr node);
@@ -102,6 +102,12 @@ void deviceMemoryInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                                lock_buffers);
 }
 
+void memoryStats(af_memory_stats *stats) { memoryManager().memoryStats(stats); }
+
+void resetMemoryStats() { memoryManager().resetMemoryStats(); }
+
+std::string memoryStatsReport() { return memoryManager().memoryStatsReport(); }
+
 template<typename T>
 T *pinnedAlloc(const size_t &elements) {
     MemoryEventPair me =
@@ -14,6 +14,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace cl {
@@ -50,6 +51,9 @@ unsigned getMaxBuffers();
 
 void deviceMemoryInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                       size_t *lock_bytes, size_t *lock_buffers);
+void memoryStats(af_memory_stats *stats);
+void resetMemoryStats();
+std::string memoryStatsReport();
 void garbageCollect();
 void pinnedGarbageCollect();
 
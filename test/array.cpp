@@ -512,6 +512,27 @@ TYPED_TEST(Array, Scalar) {
     EXPECT_EQ(true, gold[0] == a.scalar<TypeParam>());
 }
 
+TEST(Array, MoveConstructorAndAssignment) {
+    array a          = randu(5, 3);
+    const af_array h = a.get();
+    vector<float> gold(a.elements());
+    a.host(gold.data());
+
+    array b(std::move(a));
+    EXPECT_EQ(h, b.get());
+    EXPECT_EQ(nullptr, a.get());
+
+    array c = randu(2, 2);
+    c       = std::move(b);
+    EXPECT_EQ(h, c.get());
+    EXPECT_EQ(nullptr, b.get());
+    ASSERT_VEC_ARRAY_EQ(gold, dim4(5, 3), c);
+
+    // Arrays that were moved from can be assigned to again
+    a = c * 2;
+    ASSERT_VEC_ARRAY_EQ(gold, dim4(5, 3), a / 2);
+}
+
 TEST(Array, ScalarTypeMismatch) {
     array a = constant(1.0, dim4(1), f32);
 
@@ -551,3 +572,95 @@ void deathTest() {
 TEST(ArrayDeathTest, ProxyMoveAssignmentOperator) {
     EXPECT_EXIT(deathTest(), ::testing::ExitedWithCode(0), "");
 }
+
+#if defined(AF_CPU)
+TEST(CPUCopyOnWrite, DeadReferences) {
+    array a = randu(1000);
+    array b = a * 2 + 1;
+    b.eval();
+    af::sync();
+
+    // Neither the evaluated tree of b nor the queue reads a any more
+    int count = 0;
+    ASSERT_SUCCESS(af_get_data_ref_count(&count, a.get()));
+    EXPECT_EQ(1, count);
+
+    float *before = a.device<float>();
+    a.unlock();
+    a(0)         = -1.f;
+    float *after = a.device<float>();
+    a.unlock();
+    EXPECT_EQ(before, after);
+}
+
+TEST(CPUCopyOnWrite, LiveReferences) {
+    array a    = randu(1000);
+    array gold = a.copy();
+
+    // The handle and the unevaluated tree read the buffer of a
+    array handle = a;
+    array tree   = a + 1;
+    a(0)         = -1.f;
+    ASSERT_ARRAYS_EQ(gold, handle);
+    ASSERT_ARRAYS_EQ(gold + 1, tree);
+
+    // The evaluated tree no longer reads the buffer of handle
+    af::sync();
+    int count = 0;
+    ASSERT_SUCCESS(af_get_data_ref_count(&count, handle.get()));
+    EXPECT_EQ(1, count);
+    float *before = handle.device<float>();
+    handle.unlock();
+    af::replace(handle, handle > 0.5, 0.f);
+    float *after = handle.device<float>();
+    handle.unlock();
+    EXPECT_EQ(before, after);
+}
+
+TEST(CPUCopyOnWrite, ReuseTemporaryBuffer) {
+    array a    = randu(1000);
+    array gold = a * 2 + 1;
+    gold.eval();
+
+    float *ptr = a.device<float>();
+    a.unlock();
+
+    // The buffer of a is only read by the tree of b after a is released
+    array b = a * 2 + 1;
+    a       = array();
+    b.eval();
+    EXPECT_EQ(ptr, b.device<float>());
+    b.unlock();
+    ASSERT_ARRAYS_EQ(gold, b);
+
+    // A buffer that is still used is not reused
+    array c = randu(1000);
+    array d = c + 1;
+    d.eval();
+    EXPECT_NE(c.device<float>(), d.device<float>());
+    c.unlock();
+    d.unlock();
+
+    // The buffer under a node that is shared with other arrays is still read
+    // by them after the tree is evaluated
+    vector<float> h_x(1000);
+    array x;
+    {
+        array r = randu(1000);
+        r.host(h_x.data());
+        x = r * 3;
+    }
+    for (float &v : h_x) { v *= 3; }
+    array e = x + 1;
+    array f = x - 1;
+    e.eval();
+    vector<float> gold_e(h_x.size()), gold_f(h_x.size());
+    for (size_t i = 0; i < h_x.size(); i++) {
+        gold_e[i] = h_x[i] + 1;
+        gold_f[i] = h_x[i] - 1;
+    }
+    ASSERT_VEC_ARRAY_NEAR(gold_e, dim4(1000), e, 1e-5);
+    ASSERT_VEC_ARRAY_NEAR(gold_f, dim4(1000), f, 1e-5);
+    ASSERT_VEC_ARRAY_NEAR(h_x, dim4(1000), x, 1e-5);
+}
+#endif
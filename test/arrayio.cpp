@@ -14,6 +14,7 @@
 #include <testHelpers.hpp>
 
 #include <complex>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -22,6 +23,7 @@ using af::array;
 using af::constant;
 using af::dim4;
 using af::readArray;
+using af::readArrayCheck;
 using af::saveArray;
 using std::complex;
 using std::string;
@@ -126,3 +128,227 @@ TEST(ArrayIO, Save) {
     ASSERT_ARRAYS_EQ(a, aread);
     ASSERT_ARRAYS_EQ(b, bread);
 }
+
+TEST(ArrayIO, SaveManyAndReadByKey) {
+    const int num_arrays = 100;
+    vector<array> arrays;
+    for (int i = 0; i < num_arrays; i++) {
+        af_dtype type = (i % 2) ? f64 : s32;
+        arrays.push_back(constant(i, 3 + i % 5, 2, type));
+        string key = "key" + std::to_string(i);
+        ASSERT_EQ(i, saveArray(key.c_str(), arrays.back(), "many.af", i > 0));
+    }
+
+    for (int i = num_arrays - 1; i >= 0; i -= 7) {
+        string key = "key" + std::to_string(i);
+        ASSERT_EQ(i, readArrayCheck("many.af", key.c_str()));
+        ASSERT_ARRAYS_EQ(arrays[i], readArray("many.af", key.c_str()));
+        ASSERT_ARRAYS_EQ(arrays[i], readArray("many.af", (unsigned)i));
+    }
+    ASSERT_EQ(-1, readArrayCheck("many.af", "missing"));
+}
+
+TEST(ArrayIO, SaveDuplicateKey) {
+    array a = constant(1, 10, 10);
+    array b = constant(2, 5, 5);
+
+    saveArray("a", a, "duplicate.af");
+    saveArray("a", b, "duplicate.af", true);
+
+    // The first array saved with a key is read
+    ASSERT_ARRAYS_EQ(a, readArray("duplicate.af", "a"));
+    ASSERT_ARRAYS_EQ(b, readArray("duplicate.af", 1u));
+}
+
+TEST(ArrayIO, SaveSubArray) {
+    array a   = af::randu(10, 10);
+    array sub = a(af::seq(2, 7), af::seq(1, 8, 2));
+
+    saveArray("sub", sub, "sub.af");
+
+    ASSERT_ARRAYS_EQ(sub, readArray("sub.af", "sub"));
+}
+
+TEST(ArrayIO, ReadSeq) {
+    array a = af::randu(20, 15, 3);
+    array b = af::range(dim4(9, 4), 0, s32);
+    saveArray("a", a, "seq.af");
+    saveArray("b", b, "seq.af", true);
+
+    using af::end;
+    using af::seq;
+    using af::span;
+    ASSERT_ARRAYS_EQ(a(span, seq(3, 5)), readArray("seq.af", "a", span,
+                                                   seq(3, 5)));
+    ASSERT_ARRAYS_EQ(a(seq(2, 9), seq(1, 13, 4), 2),
+                     readArray("seq.af", "a", seq(2, 9), seq(1, 13, 4),
+                               seq(2, 2)));
+    ASSERT_ARRAYS_EQ(a(seq(end, 0, -3), span, seq(1, end)),
+                     readArray("seq.af", "a", seq(end, 0, -3), span,
+                               seq(1, end)));
+    ASSERT_ARRAYS_EQ(b(seq(1, 7, 2), end),
+                     readArray("seq.af", "b", seq(1, 7, 2), seq(end, end)));
+
+    af_array out  = 0;
+    af_seq idx[1] = {{0, 20, 1}};
+    ASSERT_EQ(AF_ERR_ARG, af_read_array_key_seq(&out, "seq.af", "b", 1, idx));
+    ASSERT_EQ(AF_ERR_INVALID_ARRAY,
+              af_read_array_key_seq(&out, "seq.af", "c", 1, idx));
+    ASSERT_EQ(AF_ERR_ARG, af_read_array_key_seq(NULL, "seq.af", "a", 1, idx));
+}
+
+TEST(ArrayIO, SaveCompressed) {
+    // The arrays are split into several chunks
+    array img    = af::randu(400, 300);
+    img          = img * (img > 0.9);
+    array labels = (af::range(dim4(300, 200), 0, s32) / 37).as(s32);
+    array noise  = af::randu(100, 100);
+    saveArray("img", img, "compressed.af", false, true);
+    saveArray("labels", labels, "compressed.af", true, true);
+    saveArray("raw", labels, "compressed.af", true);
+    saveArray("noise", noise, "compressed.af", true, true);
+
+    ASSERT_ARRAYS_EQ(img, readArray("compressed.af", "img"));
+    ASSERT_ARRAYS_EQ(labels, readArray("compressed.af", 1));
+    ASSERT_ARRAYS_EQ(labels, readArray("compressed.af", "raw"));
+    ASSERT_ARRAYS_EQ(noise, readArray("compressed.af", "noise"));
+
+    using af::seq;
+    using af::span;
+    ASSERT_ARRAYS_EQ(img(seq(10, 390, 7), seq(100, 250)),
+                     readArray("compressed.af", "img", seq(10, 390, 7),
+                               seq(100, 250)));
+    ASSERT_ARRAYS_EQ(labels(span, seq(199, 0, -40)),
+                     readArray("compressed.af", "labels", span,
+                               seq(199, 0, -40)));
+
+    // The two compressed arrays take less space than the uncompressed one
+    std::ifstream file("compressed.af", std::ios::binary | std::ios::ate);
+    const size_t raw_bytes =
+        (img.elements() + 2 * labels.elements() + noise.elements()) * 4;
+    EXPECT_LT(static_cast<size_t>(file.tellg()),
+              raw_bytes - labels.elements() * 4);
+}
+
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+#include <cstdio>
+#include <numeric>
+
+using af::randu;
+using std::ifstream;
+using std::ofstream;
+
+TEST(CPUMappedArray, ReadOnlyAndCopyOnWrite) {
+    const dim_t rows = 64;
+    const dim_t cols = 32;
+    vector<float> gold(rows * cols);
+    std::iota(gold.begin(), gold.end(), 0.f);
+
+    // The data follows a header so that it does not start on a page
+    const char *filename = "mapped_array.bin";
+    const int header     = 42;
+    {
+        ofstream file(filename, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(gold.data()),
+                   gold.size() * sizeof(float));
+    }
+    array host(rows, cols, gold.data());
+
+    af::deviceGC();
+    size_t alloc_bytes, alloc_buffers, lock_bytes, lock_buffers;
+    af::deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes,
+                      &lock_buffers);
+    {
+        array read_only =
+            afcpu::mapArray(filename, sizeof(header), dim4(rows, cols), f32);
+        ASSERT_ARRAYS_EQ(host, read_only);
+
+        size_t mapped_bytes, mapped_buffers;
+        af::deviceMemInfo(&mapped_bytes, &mapped_buffers, &lock_bytes,
+                          &lock_buffers);
+        EXPECT_EQ(alloc_bytes + gold.size() * sizeof(float), mapped_bytes);
+        EXPECT_EQ(alloc_buffers + 1, mapped_buffers);
+
+        array copy_on_write =
+            afcpu::mapArray(filename, sizeof(header), dim4(rows, cols), f32,
+                            AFCPU_MAP_COPY_ON_WRITE);
+        read_only(0, 0)     = -1.f;
+        copy_on_write(1, 0) = -2.f;
+
+        vector<float> expected = gold;
+        expected[0]            = -1.f;
+        ASSERT_VEC_ARRAY_EQ(expected, dim4(rows, cols), read_only);
+        expected[0] = 0.f;
+        expected[1] = -2.f;
+        ASSERT_VEC_ARRAY_EQ(expected, dim4(rows, cols), copy_on_write);
+    }
+    af::deviceGC();
+    size_t released_bytes, released_buffers;
+    af::deviceMemInfo(&released_bytes, &released_buffers, &lock_bytes,
+                      &lock_buffers);
+    EXPECT_EQ(alloc_bytes, released_bytes);
+    EXPECT_EQ(alloc_buffers, released_buffers);
+
+    // Writes to the arrays are not carried through to the file
+    vector<float> file_data(gold.size());
+    {
+        ifstream file(filename, std::ios::binary);
+        file.seekg(sizeof(header));
+        file.read(reinterpret_cast<char *>(file_data.data()),
+                  file_data.size() * sizeof(float));
+    }
+    EXPECT_EQ(gold, file_data);
+    std::remove(filename);
+}
+
+TEST(CPUMappedArray, SavedArray) {
+    array a = randu(100, 10);
+    array b = randu(7, 3, 2, f64);
+    af::saveArray("a", a, "mapped_saved.af");
+    af::saveArray("b", b, "mapped_saved.af", true);
+
+    ASSERT_ARRAYS_EQ(b, afcpu::mapArray("mapped_saved.af", "b"));
+    ASSERT_ARRAYS_EQ(a, afcpu::mapArray("mapped_saved.af", "a",
+                                        AFCPU_MAP_COPY_ON_WRITE));
+
+    af_array out = 0;
+    EXPECT_EQ(AF_ERR_INVALID_ARRAY,
+              afcpu_map_array_key(&out, "mapped_saved.af", "c",
+                                  AFCPU_MAP_READ_ONLY));
+    std::remove("mapped_saved.af");
+}
+
+TEST(CPUMappedArray, InvalidArgs) {
+    const char *filename = "mapped_array_small.bin";
+    {
+        ofstream file(filename, std::ios::binary);
+        const float data[4] = {1.f, 2.f, 3.f, 4.f};
+        file.write(reinterpret_cast<const char *>(data), sizeof(data));
+    }
+
+    af_array out  = 0;
+    dim_t dims[2] = {2, 2};
+    EXPECT_EQ(AF_ERR_ARG, afcpu_map_array(&out, "missing_file.bin", 0, 2, dims,
+                                          f32, AFCPU_MAP_READ_ONLY));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_map_array(&out, filename, -4, 2, dims, f32,
+                                          AFCPU_MAP_READ_ONLY));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_map_array(&out, filename, 0, 2, dims, f32,
+                                          (afcpu_map_mode)2));
+    // The file is smaller than the array
+    EXPECT_EQ(AF_ERR_ARG, afcpu_map_array(&out, filename, 4, 2, dims, f32,
+                                          AFCPU_MAP_READ_ONLY));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_map_array(&out, filename, 0, 2, dims, f64,
+                                          AFCPU_MAP_READ_ONLY));
+    // The elements are not aligned
+    EXPECT_EQ(AF_ERR_ARG, afcpu_map_array(&out, filename, 2, 1, dims, f32,
+                                          AFCPU_MAP_READ_ONLY));
+
+    ASSERT_SUCCESS(afcpu_map_array(&out, filename, 0, 2, dims, f32,
+                                   AFCPU_MAP_READ_ONLY));
+    ASSERT_SUCCESS(af_release_array(out));
+    std::remove(filename);
+}
+#endif
@@ -0,0 +1,78 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+#include <numeric>
+#include <vector>
+
+using af::array;
+using af::constant;
+using af::matmul;
+using af::randu;
+using std::vector;
+
+TEST(CPUAsyncTransfer, ReadbackOverlapsCompute) {
+    array a = randu(100, 100);
+    array b = matmul(a, a) + 1;
+    vector<float> gold(b.elements());
+    b.host(gold.data());
+
+    vector<float> out(b.elements());
+    afcpu_event read = afcpu::hostAsync(out.data(), b);
+
+    // The queue keeps computing while the data is copied
+    array c              = b * 2;
+    afcpu_event computed = afcpu::evalAsync(c);
+    afcpu::waitEvent(read);
+    afcpu::releaseEvent(read);
+    EXPECT_EQ(gold, out);
+
+    afcpu::waitEvent(computed);
+    afcpu::releaseEvent(computed);
+    ASSERT_ARRAYS_EQ(b * 2, c);
+}
+
+TEST(CPUAsyncTransfer, UploadAndCreate) {
+    vector<float> data(1000);
+    std::iota(data.begin(), data.end(), 0.f);
+
+    array a     = constant(0, 1000);
+    array alias = a;
+    afcpu_event written =
+        afcpu::writeAsync(a, data.data(), data.size() * sizeof(float));
+    afcpu::waitEvent(written);
+    afcpu::releaseEvent(written);
+    ASSERT_ARRAYS_EQ(array(1000, data.data()), a);
+    ASSERT_ARRAYS_EQ(constant(0, 1000), alias);
+
+    af_array handle     = 0;
+    afcpu_event created = 0;
+    dim_t dims[]        = {10, 100};
+    ASSERT_SUCCESS(afcpu_create_array_async(&created, &handle, data.data(), 2,
+                                            dims, f32));
+    ASSERT_SUCCESS(afcpu_wait_event(created));
+    ASSERT_SUCCESS(afcpu_release_event(created));
+    array b(handle);
+    ASSERT_ARRAYS_EQ(array(10, 100, data.data()), b);
+
+    afcpu_event event = 0;
+    EXPECT_EQ(AF_ERR_ARG,
+              afcpu_write_array_async(&event, a.get(), data.data(),
+                                      2 * data.size() * sizeof(float)));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_wait_event(NULL));
+}
+
+#else
+TEST(CPUAsyncTransfer, NoopNonCPU) {}
+#endif
@@ -0,0 +1,65 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+using af::array;
+using af::matmul;
+using af::randu;
+
+TEST(CPUGraph, ReplayWithNewInputs) {
+    array x = randu(100, 10);
+    array w = randu(10, 10);
+    array b = randu(100, 10);
+
+    afcpu::beginCapture({x});
+    array y = af::tanh(matmul(x, w) + b) * 2;
+    afcpu_graph graph = afcpu::endCapture({y});
+
+    for (int i = 0; i < 3; i++) {
+        array input = randu(100, 10);
+        array gold  = af::tanh(matmul(input, w) + b) * 2;
+        afcpu::replayGraph(graph, {input});
+        ASSERT_ARRAYS_NEAR(gold, y, 1e-5);
+    }
+    afcpu::releaseGraph(graph);
+}
+
+TEST(CPUGraph, InvalidUse) {
+    array x           = randu(10);
+    afcpu_graph graph = 0;
+    EXPECT_EQ(AF_ERR_RUNTIME, afcpu_end_capture(&graph, NULL, 0));
+
+    afcpu::beginCapture({x});
+    EXPECT_EQ(AF_ERR_RUNTIME, afcpu_begin_capture(NULL, 0));
+    array y = x + 1;
+    graph   = afcpu::endCapture({y});
+
+    // The inputs must match the captured inputs
+    array wrong         = randu(20);
+    af_array wrong_size = wrong.get();
+    EXPECT_EQ(AF_ERR_SIZE, afcpu_replay_graph(graph, &wrong_size, 1));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_replay_graph(graph, NULL, 0));
+    afcpu::releaseGraph(graph);
+
+    // The host reads a result during the capture
+    afcpu::beginCapture({x});
+    float total  = af::sum<float>(x);
+    array z      = x * total;
+    af_array out = z.get();
+    EXPECT_EQ(AF_ERR_NOT_SUPPORTED, afcpu_end_capture(&graph, &out, 1));
+}
+
+#else
+TEST(CPUGraph, NoopNonCPU) {}
+#endif
@@ -0,0 +1,104 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+#include <cstdio>
+#include <set>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using af::array;
+using af::randu;
+
+/// Returns the system ids of the nodes that hold the pages of \p arr
+static std::set<int> getPageNodes(array &arr) {
+    std::set<int> nodes;
+#if defined(__linux__)
+    // get_mempolicy returns the node of the page at an address with
+    // MPOL_F_NODE | MPOL_F_ADDR
+    const int flags        = 1 | 2;
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    char *data             = reinterpret_cast<char *>(arr.device<float>());
+    const size_t bytes     = arr.bytes();
+    for (size_t offset = 0; offset < bytes; offset += page_size) {
+        int node = -1;
+        if (syscall(SYS_get_mempolicy, &node, nullptr, 0, data + offset,
+                    flags) == 0) {
+            nodes.insert(node);
+        }
+    }
+    arr.unlock();
+#else
+    UNUSED(arr);
+#endif
+    return nodes;
+}
+
+TEST(CPUNuma, Policies) {
+    const int num_nodes = afcpu::getNumaNodeCount();
+    EXPECT_GE(num_nodes, 1);
+
+    // The buffers are large enough to be placed by the policy
+    array in   = randu(1024, 1024);
+    array gold = in * 2;
+    gold.eval();
+
+    const afcpu_numa_policy policies[] = {
+        AFCPU_NUMA_INTERLEAVE, AFCPU_NUMA_LOCAL, AFCPU_NUMA_NODE};
+    for (afcpu_numa_policy policy : policies) {
+        afcpu::setNumaPolicy(policy, num_nodes - 1);
+        af::deviceGC();
+        array out = in * 2;
+        ASSERT_ARRAYS_EQ(gold, out);
+    }
+    afcpu::setNumaPolicy(AFCPU_NUMA_DEFAULT);
+
+#if defined(__linux__)
+    if (num_nodes < 2) {
+        printf("The system has a single NUMA node. Test will exit\n");
+        return;
+    }
+
+    // The pages of an interleaved buffer are spread across the nodes, and
+    // the pages of a buffer placed on a node are on a single node
+    afcpu::setNumaPolicy(AFCPU_NUMA_INTERLEAVE);
+    af::deviceGC();
+    array interleaved = in * 2;
+    interleaved.eval();
+    EXPECT_GT(getPageNodes(interleaved).size(), 1u);
+
+    afcpu::setNumaPolicy(AFCPU_NUMA_NODE, num_nodes - 1);
+    af::deviceGC();
+    array placed = in * 2;
+    placed.eval();
+    EXPECT_EQ(1u, getPageNodes(placed).size());
+    afcpu::setNumaPolicy(AFCPU_NUMA_DEFAULT);
+#else
+    printf("Page placement is only checked on Linux. Test will exit\n");
+#endif
+}
+
+TEST(CPUNuma, InvalidNode) {
+    EXPECT_EQ(AF_ERR_ARG, afcpu_set_numa_policy(AFCPU_NUMA_NODE, -1));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_set_numa_policy(
+                              AFCPU_NUMA_NODE, afcpu::getNumaNodeCount()));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_get_numa_node_count(NULL));
+}
+
+#else
+TEST(CPUNuma, NoopNonCPU) {}
+#endif
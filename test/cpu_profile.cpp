@@ -0,0 +1,50 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using af::array;
+using af::randu;
+using af::sort;
+using std::ifstream;
+
+TEST(CPUProfile, WriteProfile) {
+    const char *filename = "cpu_profile.json";
+    array a              = randu(100);
+    array b              = sort(a * 2);
+    b.eval();
+    ASSERT_SUCCESS(afcpu_write_profile(filename));
+
+    ifstream file(filename);
+    ASSERT_TRUE(file.good());
+    std::string contents((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+    EXPECT_EQ(0u, contents.find("{\"traceEvents\":["));
+    if (!std::getenv("AF_CPU_PROFILE")) {
+        EXPECT_EQ(AF_ERR_ARG, afcpu_write_profile(NULL));
+    } else {
+        EXPECT_NE(std::string::npos, contents.find("\"jit\""));
+    }
+    file.close();
+    std::remove(filename);
+}
+
+#else
+TEST(CPUProfile, NoopNonCPU) {}
+#endif
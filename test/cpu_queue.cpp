@@ -0,0 +1,71 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+#include <cstdio>
+
+using af::array;
+using af::constant;
+using af::randu;
+
+TEST(CPUQueue, Stats) {
+    af::sync();
+    afcpu_queue_stats before = afcpu::getQueueStats();
+
+    // The queue is idle, so the small tree is evaluated on this thread
+    array small = constant(1, 3, 3) + 1;
+    small.eval();
+    af::sync();
+    afcpu_queue_stats middle = afcpu::getQueueStats();
+    EXPECT_GT(middle.inlined, before.inlined);
+
+    array big = randu(1000, 1000) + 1;
+    big.eval();
+    af::sync();
+    afcpu_queue_stats after = afcpu::getQueueStats();
+    EXPECT_GT(after.queued, middle.queued);
+
+    EXPECT_EQ(AF_ERR_ARG, afcpu_get_queue_stats(NULL));
+}
+
+TEST(CPUQueue, StallsAtLimit) {
+    af::sync();
+    afcpu_queue_stats before = afcpu::getQueueStats();
+
+    // Each function takes much longer than enqueueing it, so the thread
+    // runs ahead of the worker until the queue holds too many functions
+    afcpu::setQueueLimits(4);
+    array x = randu(1000, 1000);
+    for (int i = 0; i < 50; i++) {
+        x = x * 0.5f + 0.25f;
+        x.eval();
+    }
+    af::sync();
+    afcpu::setQueueLimits();
+    afcpu_queue_stats after = afcpu::getQueueStats();
+
+#ifdef NDEBUG
+    EXPECT_GT(after.stalls, before.stalls);
+    EXPECT_GT(after.stall_seconds, before.stall_seconds);
+#else
+    // Debug builds wait for every function
+    UNUSED(before);
+    UNUSED(after);
+    printf("Debug builds do not stall. Test will exit\n");
+#endif
+}
+
+#else
+TEST(CPUQueue, NoopNonCPU) {}
+#endif
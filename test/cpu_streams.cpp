@@ -0,0 +1,110 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+#include <thread>
+#include <vector>
+
+using af::array;
+using af::constant;
+using af::matmul;
+using af::randu;
+using af::sum;
+using std::thread;
+using std::vector;
+
+TEST(CPUStreams, SetStream) {
+    EXPECT_EQ(NULL, afcpu::getStream());
+
+    afcpu_stream stream = afcpu::createStream();
+    afcpu::setStream(stream);
+    EXPECT_EQ(stream, afcpu::getStream());
+
+    afcpu::setStream(NULL);
+    EXPECT_EQ(NULL, afcpu::getStream());
+    afcpu::releaseStream(stream);
+}
+
+TEST(CPUStreams, InvalidStream) {
+    int not_a_stream = 0;
+    EXPECT_EQ(AF_ERR_ARG, afcpu_set_stream(&not_a_stream));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_release_stream(&not_a_stream));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_release_stream(NULL));
+}
+
+TEST(CPUStreams, ConcurrentPipelines) {
+    const int num_pipelines = 4;
+    vector<array> inputs;
+    vector<array> gold;
+    for (int i = 0; i < num_pipelines; i++) {
+        inputs.push_back(randu(128, 128));
+        gold.push_back(sum(matmul(inputs[i], inputs[i]) + i, 1));
+    }
+    af::sync();
+
+    vector<array> outputs(num_pipelines);
+    vector<thread> pipelines;
+    for (int i = 0; i < num_pipelines; i++) {
+        pipelines.emplace_back([&, i] {
+            afcpu_stream stream = afcpu::createStream();
+            afcpu::setStream(stream);
+            for (int j = 0; j < 10; j++) {
+                outputs[i] = sum(matmul(inputs[i], inputs[i]) + i, 1);
+            }
+            outputs[i].eval();
+            af::sync();
+            afcpu::setStream(NULL);
+            afcpu::releaseStream(stream);
+        });
+    }
+    for (auto &pipeline : pipelines) { pipeline.join(); }
+
+    for (int i = 0; i < num_pipelines; i++) {
+        ASSERT_ARRAYS_EQ(gold[i], outputs[i]);
+    }
+}
+
+TEST(CPUStreams, ReusedBufferWaitsForOtherStream) {
+    array x = randu(64, 64);
+    array gold = x;
+    for (int i = 0; i < 200; i++) { gold = af::tanh(matmul(gold, x)); }
+    gold.eval();
+    af::sync();
+
+    // The stream still reads the buffer of x after x is released
+    afcpu_stream stream = afcpu::createStream();
+    afcpu::setStream(stream);
+    array y = x;
+    for (int i = 0; i < 200; i++) { y = af::tanh(matmul(y, x)); }
+    y.eval();
+    x = array();
+
+    // The small array can reuse the buffer of x. It must not be written
+    // before the stream is done with it.
+    afcpu::setStream(NULL);
+    array z = constant(5, 64, 64);
+    z.eval();
+    af::sync();
+
+    afcpu::setStream(stream);
+    af::sync();
+    ASSERT_ARRAYS_NEAR(gold, y, 1e-5);
+    afcpu::setStream(NULL);
+    afcpu::releaseStream(stream);
+    ASSERT_ARRAYS_EQ(constant(5, 64, 64), z);
+}
+
+#else
+TEST(CPUStreams, NoopNonCPU) {}
+#endif
@@ -0,0 +1,66 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU)
+#include <af/cpu.h>
+
+using af::array;
+using af::randu;
+using af::sort;
+using af::sum;
+
+TEST(CPUThreads, SetNumThreads) {
+    int num_threads = afcpu::getNumThreads();
+    EXPECT_GE(num_threads, 1);
+
+    afcpu::setNumThreads(3);
+    EXPECT_EQ(3, afcpu::getNumThreads());
+
+    afcpu::setNumThreads(0);
+    EXPECT_EQ(num_threads, afcpu::getNumThreads());
+}
+
+TEST(CPUThreads, InvalidNumThreads) {
+    EXPECT_EQ(AF_ERR_ARG, afcpu_set_num_threads(-1));
+    EXPECT_EQ(AF_ERR_ARG, afcpu_get_num_threads(NULL));
+}
+
+TEST(CPUThreads, NestedReduceAndSort) {
+    // The batches of dims 2 and 3 and the columns of dim 1 are split
+    // across the threads
+    array in = randu(1000, 64, 4, 3);
+
+    afcpu::setNumThreads(1);
+    array sum_serial  = sum(in, 0);
+    array sum1_serial = sum(in, 1);
+    array sort_serial = sort(in, 0);
+    sum_serial.eval();
+    sum1_serial.eval();
+    sort_serial.eval();
+
+    afcpu::setNumThreads(4);
+    afcpu::setThreadAffinity(true);
+    array sum_parallel  = sum(in, 0);
+    array sum1_parallel = sum(in, 1);
+    array sort_parallel = sort(in, 0);
+
+    ASSERT_ARRAYS_EQ(sum_serial, sum_parallel);
+    ASSERT_ARRAYS_EQ(sum1_serial, sum1_parallel);
+    ASSERT_ARRAYS_EQ(sort_serial, sort_parallel);
+
+    afcpu::setThreadAffinity(false);
+    afcpu::setNumThreads(0);
+}
+
+#else
+TEST(CPUThreads, NoopNonCPU) {}
+#endif
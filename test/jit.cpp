@@ -14,6 +14,7 @@
 #include <af/array.h>
 #include <af/data.h>
 
+#include <thread>
 #include <tuple>
 
 using af::array;
@@ -376,6 +377,43 @@ TEST(JIT, LinearLarge) {
     for (size_t i = 0; i < hc.size(); i++) { ASSERT_EQ(hc[i], v3); }
 }
 
+TEST(JIT, MultiOutputNonLinearLarge) {
+    // Large enough for the evaluation to be split across threads. The first
+    // dimension is not a multiple of the chunk size.
+    const int d0 = 1000;
+    const int d1 = 300;
+    const int d2 = 7;
+    array a      = randu(d0, 1, d2);
+    array b      = randu(1, d1);
+
+    array t = tile(a, 1, d1) * tile(b, d0, 1, d2);
+    array c = t + 1;
+    array d = t - 1;
+    eval(c, d);
+
+    vector<float> ha(a.elements());
+    vector<float> hb(b.elements());
+    vector<float> hc(c.elements());
+    vector<float> hd(d.elements());
+    a.host(ha.data());
+    b.host(hb.data());
+    c.host(hc.data());
+    d.host(hd.data());
+
+    for (int k = 0; k < d2; k++) {
+        for (int j = 0; j < d1; j++) {
+            for (int i = 0; i < d0; i++) {
+                int idx = i + j * d0 + k * d0 * d1;
+                float val = ha[i + k * d0] * hb[j];
+                ASSERT_EQ(hc[idx], val + 1)
+                    << " at " << i << "," << j << "," << k;
+                ASSERT_EQ(hd[idx], val - 1)
+                    << " at " << i << "," << j << "," << k;
+            }
+        }
+    }
+}
+
 TEST(JIT, NonLinearBuffers1) {
     array a  = randu(5, 5);
     array a0 = a;
@@ -763,6 +801,171 @@ TEST(JIT, IndexingRow) {
     ASSERT_VEC_ARRAY_EQ(gold, dim4(1, 512), c);
 }
 
+TEST(JIT, SimplifiedExpressions) {
+    const dim4 dims(100, 10);
+    array x     = randu(dims);
+    array two   = constant(2, dims);
+    array three = constant(3, dims);
+    x.eval();
+
+    vector<float> h_x(dims.elements());
+    x.host(h_x.data());
+
+    // Repeated subexpressions, constant subtrees and identities
+    array common_sub = af::exp(x) * af::exp(x) + (two + three);
+    array identities = -(-x) * 1 + 0 - 0;
+    array round_trip = x.as(f64).as(f32) / 1;
+
+    vector<float> gold_common_sub(dims.elements());
+    for (size_t i = 0; i < h_x.size(); i++) {
+        gold_common_sub[i] = std::exp(h_x[i]) * std::exp(h_x[i]) + 5.0f;
+    }
+
+    ASSERT_VEC_ARRAY_NEAR(gold_common_sub, dims, common_sub, 1e-5);
+    ASSERT_VEC_ARRAY_EQ(h_x, dims, identities);
+    ASSERT_VEC_ARRAY_EQ(h_x, dims, round_trip);
+}
+
+TEST(JIT, DeepCheapTree) {
+    const dim4 dims(1000);
+    array x = randu(dims);
+    x.eval();
+
+    vector<float> gold(dims.elements());
+    x.host(gold.data());
+
+    // A long chain of cheap operations on a single buffer
+    array y = x;
+    for (int i = 0; i < 300; i++) { y = y * 0.5f + 0.25f; }
+    for (float &v : gold) {
+        for (int i = 0; i < 300; i++) { v = v * 0.5f + 0.25f; }
+    }
+
+    ASSERT_VEC_ARRAY_NEAR(gold, dims, y, 1e-5);
+}
+
+TEST(JIT, WideTree) {
+    const dim4 dims(1000);
+    const int buffers = 40;
+
+    vector<float> gold(dims.elements(), 0.0f);
+    array sum = constant(0, dims);
+    for (int i = 0; i < buffers; i++) {
+        array x = constant(i, dims);
+        x.eval();
+        sum += x;
+        for (float &v : gold) { v += i; }
+    }
+
+    ASSERT_VEC_ARRAY_EQ(gold, dims, sum);
+}
+
+TEST(JIT, SharedSubtree) {
+    const dim4 dims(100, 10);
+    array a = randu(dims);
+    array b = randu(dims);
+    array c = randu(dims);
+    eval(a, b, c);
+
+    vector<float> h_a(dims.elements()), h_b(dims.elements()),
+        h_c(dims.elements());
+    a.host(h_a.data());
+    b.host(h_b.data());
+    c.host(h_c.data());
+
+    // The subtree is used by several trees
+    array shared = a * b * c + c * a * b - b * c;
+
+#if defined(AF_CPU)
+    {
+        // Building a subtree of shared again returns its nodes. The copy is
+        // then used by two trees, so the CPU backend evaluates it once
+        // another tree uses it. A copy with nodes of its own is not
+        // evaluated.
+        array again = a * b * c + c * a * b;
+
+        size_t alloc_bytes, alloc_buffers, lock_bytes, before, after;
+        af::deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &before);
+        array use = again + 1;
+        af::deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &after);
+        EXPECT_EQ(before + 1, after);
+    }
+#endif
+
+    array first  = shared + 1;
+    array second = shared * 2;
+    array third  = shared - c;
+
+    vector<float> gold_first(dims.elements()), gold_second(dims.elements()),
+        gold_third(dims.elements());
+    for (size_t i = 0; i < h_a.size(); i++) {
+        float value = h_a[i] * h_b[i] * h_c[i] + h_c[i] * h_a[i] * h_b[i] -
+                      h_b[i] * h_c[i];
+        gold_first[i]  = value + 1;
+        gold_second[i] = value * 2;
+        gold_third[i]  = value - h_c[i];
+    }
+
+    ASSERT_VEC_ARRAY_NEAR(gold_first, dims, first, 1e-5);
+    ASSERT_VEC_ARRAY_NEAR(gold_second, dims, second, 1e-5);
+    ASSERT_VEC_ARRAY_NEAR(gold_third, dims, third, 1e-5);
+}
+
+TEST(JIT, SmallAfterLargeWork) {
+    const dim4 dims(1000, 1000);
+    array big = randu(dims);
+    big.eval();
+
+    vector<float> h_big(dims.elements());
+    big.host(h_big.data());
+
+    // The small tree reads the output of the large tree
+    array doubled = big * 2;
+    doubled.eval();
+    array small = doubled(seq(3)) + 1;
+
+    vector<float> gold(3);
+    for (int i = 0; i < 3; i++) { gold[i] = h_big[i] * 2 + 1; }
+    ASSERT_VEC_ARRAY_NEAR(gold, dim4(3), small, 1e-5);
+
+    // Chains of small trees
+    array x = constant(1, 3, 3);
+    for (int i = 0; i < 100; i++) {
+        x = x * 0.5f + 1.0f;
+        x.eval();
+    }
+    float value = 1;
+    for (int i = 0; i < 100; i++) { value = value * 0.5f + 1.0f; }
+    ASSERT_VEC_ARRAY_NEAR(vector<float>(9, value), dim4(3, 3), x, 1e-5);
+}
+
+TEST(JIT, TreesFromManyThreads) {
+    const dim4 dims(100);
+    const int nthreads = 4;
+
+    // The nodes built on one thread are released on the other threads
+    vector<array> results(nthreads);
+    vector<std::thread> threads;
+    for (int t = 0; t < nthreads; t++) {
+        threads.emplace_back([&results, dims, t]() {
+            for (int r = 0; r < 20; r++) {
+                array y = constant(t, dims);
+                for (int i = 0; i < 50; i++) { y = y * 0.5f + 1.0f; }
+                results[t] = y;
+            }
+            results[t].eval();
+        });
+    }
+    for (std::thread &thread : threads) { thread.join(); }
+
+    for (int t = 0; t < nthreads; t++) {
+        float value = t;
+        for (int i = 0; i < 50; i++) { value = value * 0.5f + 1.0f; }
+        vector<float> gold(dims.elements(), value);
+        ASSERT_VEC_ARRAY_NEAR(gold, dims, results[t], 1e-5);
+    }
+}
+
 TEST(JIT, DISABLED_ManyConstants) {
     array res  = constant(1, 1);
     array res2 = tile(res, 1, 10);
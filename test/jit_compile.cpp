@@ -0,0 +1,148 @@
+/*******************************************************
+ * Copyright (c) 2019, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+#include <testHelpers.hpp>
+#if defined(AF_CPU) && !defined(_WIN32)
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <unistd.h>
+
+using af::array;
+using af::dim4;
+using af::eval;
+using af::randu;
+using af::seq;
+using af::span;
+using std::string;
+using std::vector;
+
+namespace {
+
+string cacheDirectory() {
+    const char *tmp = getenv("TMPDIR");
+    return string(tmp ? tmp : "/tmp") + "/arrayfire_jit_compile_test_" +
+           std::to_string(getpid());
+}
+
+/// Returns the libraries in the kernel cache
+vector<string> cachedLibraries() {
+    vector<string> libs;
+    DIR *dir = opendir(cacheDirectory().c_str());
+    if (!dir) { return libs; }
+    while (dirent *entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".so") == 0) {
+            libs.push_back(name);
+        }
+    }
+    closedir(dir);
+    return libs;
+}
+
+string compilerFlags() {
+    const char *flags = getenv("AF_CPU_JIT_CXX_FLAGS");
+    return flags && *flags ? flags : "-O3 -march=native";
+}
+
+bool hasCompiler() {
+    const char *cxx    = getenv("AF_CPU_JIT_CXX");
+    const string check = string(cxx && *cxx ? cxx : "c++") +
+                         " --version > /dev/null 2>&1";
+    return system(check.c_str()) == 0;
+}
+
+/// Compiles the JIT trees into a cache directory of the test. The variables
+/// are read by the library the first time a tree is evaluated.
+class CompileEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override {
+        setenv("AF_CPU_JIT_COMPILE", "1", 1);
+        setenv("AF_CPU_JIT_CACHE_DIRECTORY", cacheDirectory().c_str(), 1);
+    }
+
+    void TearDown() override {
+        const string dir = cacheDirectory();
+        for (const string &lib : cachedLibraries()) {
+            remove((dir + "/" + lib).c_str());
+        }
+        rmdir(dir.c_str());
+    }
+};
+
+::testing::Environment *const compile_env =
+    ::testing::AddGlobalTestEnvironment(new CompileEnvironment);
+
+}  // namespace
+
+TEST(JITCompile, LinearAndGeneralTrees) {
+    if (!hasCompiler()) {
+        printf("No C++ compiler found. Test will exit\n");
+        return;
+    }
+
+    const dim4 dims(100, 10);
+    array a = randu(dims);
+    array b = randu(dims);
+    array c = randu(dims) + 1;
+    eval(a, b, c);
+
+    vector<float> h_a(dims.elements()), h_b(dims.elements()),
+        h_c(dims.elements());
+    a.host(h_a.data());
+    b.host(h_b.data());
+    c.host(h_c.data());
+
+    array linear  = (a * b + 2) / c;
+    array general = a(seq(0, 49), span) * 2 - b(seq(50, 99), span);
+
+    vector<float> gold_linear(dims.elements());
+    for (size_t i = 0; i < h_a.size(); i++) {
+        gold_linear[i] = (h_a[i] * h_b[i] + 2) / h_c[i];
+    }
+    const dim4 half_dims(50, 10);
+    vector<float> gold_general(half_dims.elements());
+    for (int j = 0; j < 10; j++) {
+        for (int i = 0; i < 50; i++) {
+            gold_general[j * 50 + i] =
+                h_a[j * 100 + i] * 2 - h_b[j * 100 + 50 + i];
+        }
+    }
+
+    ASSERT_VEC_ARRAY_NEAR(gold_linear, dims, linear, 1e-5);
+    ASSERT_VEC_ARRAY_NEAR(gold_general, half_dims, general, 1e-5);
+
+    // Each library records the compiler flags it was built with, so that it
+    // is not loaded by a process that uses other flags
+    const vector<string> libs = cachedLibraries();
+    ASSERT_FALSE(libs.empty());
+    for (const string &lib : libs) {
+        const string path = cacheDirectory() + "/" + lib;
+        void *handle      = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        ASSERT_NE(nullptr, handle) << path;
+
+        const string keyName = lib.substr(0, lib.size() - 3) + "_key";
+        const char *key =
+            static_cast<const char *>(dlsym(handle, keyName.c_str()));
+        ASSERT_NE(nullptr, key) << keyName;
+        EXPECT_NE(string::npos, string(key).find(compilerFlags())) << key;
+        dlclose(handle);
+    }
+}
+
+#else
+TEST(JITCompile, NoopNonCPU) {}
+#endif
@@ -11,6 +11,7 @@
 #include <af/arith.h>
 #include <af/data.h>
 #include <complex>
+#include <limits>
 
 // This makes the macros cleaner
 using af::array;
@@ -152,6 +153,34 @@ MATH_TESTS_REAL(erf)
 MATH_TESTS_REAL(erfc)
 #endif
 
+TEST(MathTests, ExpLogSpecialValues) {
+    const float inf  = std::numeric_limits<float>::infinity();
+    const float nan  = std::numeric_limits<float>::quiet_NaN();
+    vector<float> in = {0.0f,  -0.0f,  inf,    -inf,  nan,    1e-40f,
+                        88.7f, 88.8f,  -87.5f, -100.f, -110.f, -1.0f};
+
+    array a(static_cast<dim_t>(in.size()), &in.front());
+    vector<float> h_exp(in.size());
+    vector<float> h_log(in.size());
+    exp(a).host(&h_exp.front());
+    log(a).host(&h_log.front());
+
+    for (size_t i = 0; i < in.size(); i++) {
+        float exp_gold = std::exp(in[i]);
+        float log_gold = std::log(in[i]);
+        if (std::isnan(exp_gold)) {
+            ASSERT_TRUE(std::isnan(h_exp[i])) << "for value: " << in[i];
+        } else {
+            ASSERT_FLOAT_EQ(exp_gold, h_exp[i]) << "for value: " << in[i];
+        }
+        if (std::isnan(log_gold)) {
+            ASSERT_TRUE(std::isnan(h_log[i])) << "for value: " << in[i];
+        } else {
+            ASSERT_FLOAT_EQ(log_gold, h_log[i]) << "for value: " << in[i];
+        }
+    }
+}
+
 TEST(MathTests, Not) {
     array a  = randu(5, 5, b8);
     array b  = !a;
@@ -14,6 +14,7 @@
 #include <af/internal.h>
 #include <af/traits.hpp>
 #include <iostream>
+#include <string>
 #include <vector>
 
 using af::alloc;
@@ -22,8 +23,10 @@ using af::cdouble;
 using af::cfloat;
 using af::deviceGC;
 using af::deviceMemInfo;
+using af::deviceMemStats;
 using af::dtype_traits;
 using af::randu;
+using af::resetMemStats;
 using af::seq;
 using af::span;
 using std::vector;
@@ -602,3 +605,98 @@ TEST(Memory, IndexedDevice) {
         }
     }
 }
+
+TEST(Memory, LargeSizeClasses) {
+    size_t alloc_bytes, alloc_buffers;
+    size_t lock_bytes, lock_buffers;
+
+    cleanSlate();  // Clean up everything done so far
+
+    // Slightly larger than 2 MB. The buffer is rounded up to 2.25 MB.
+    const int num = (2 * 1024 * 1024) / sizeof(float) + 1;
+    const size_t class_bytes = 2304 * step_bytes;
+
+    for (int i = 0; i < 10; i++) {
+        array a = randu(num + i * 100);
+
+        deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+
+        // Arrays of a similar size share the same buffer
+        ASSERT_EQ(alloc_buffers, 1u);
+        ASSERT_EQ(lock_buffers, 1u);
+        ASSERT_EQ(alloc_bytes, class_bytes);
+        ASSERT_EQ(lock_bytes, class_bytes);
+    }
+
+    {
+        // The free 2.25 MB buffer is reused for a 2 MB request
+        array a = randu(num - 1000);
+
+        deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+
+        ASSERT_EQ(alloc_buffers, 1u);
+        ASSERT_EQ(lock_buffers, 1u);
+        ASSERT_EQ(alloc_bytes, class_bytes);
+        ASSERT_EQ(lock_bytes, class_bytes);
+    }
+
+    {
+        // A free buffer much larger than the request is not used
+        array a = randu(num / 4);
+
+        deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+
+        ASSERT_EQ(alloc_buffers, 2u);
+        ASSERT_EQ(lock_buffers, 1u);
+        ASSERT_EQ(alloc_bytes, class_bytes + 512 * step_bytes);
+        ASSERT_EQ(lock_bytes, 512 * step_bytes);
+    }
+}
+
+TEST(Memory, Stats) {
+    cleanSlate();  // Clean up everything done so far
+    resetMemStats();
+    const size_t used_bytes = deviceMemStats().used_bytes;
+
+    const size_t bytes = 1000 * step_bytes;
+    {
+        array a = randu(bytes / sizeof(float));
+        a.eval();
+        af::sync();
+
+        af_memory_stats stats = deviceMemStats();
+        ASSERT_GE(stats.alloc_count, 1u);
+        ASSERT_GE(stats.alloc_bytes, bytes);
+        ASSERT_GE(stats.used_bytes, used_bytes + bytes);
+        ASSERT_GE(stats.peak_used_bytes, stats.used_bytes);
+        ASSERT_GE(stats.native_count, 1u);
+        // 1000 KB requests are in the class of requests up to 1 MB
+        ASSERT_GE(stats.class_count[10], 1u);
+    }
+
+    af_memory_stats stats = deviceMemStats();
+    ASSERT_EQ(stats.used_bytes, used_bytes);
+    ASSERT_GE(stats.peak_used_bytes, used_bytes + bytes);
+
+    // The free buffer is reused
+    array b = randu(bytes / sizeof(float));
+    b.eval();
+    stats = deviceMemStats();
+    ASSERT_GE(stats.reuse_count, 1u);
+
+    deviceGC();
+    stats = deviceMemStats();
+    ASSERT_GE(stats.gc_count, 1u);
+
+    char *report = nullptr;
+    ASSERT_SUCCESS(af_device_mem_stats_report(&report));
+    const std::string text(report);
+    ASSERT_SUCCESS(af_free_host(report));
+    EXPECT_NE(text.find("uniformDistribution"), std::string::npos) << text;
+
+    // The peak starts again from the memory in use
+    resetMemStats();
+    stats = deviceMemStats();
+    ASSERT_EQ(stats.alloc_count, 0u);
+    ASSERT_EQ(stats.peak_used_bytes, stats.used_bytes);
+}
@@ -877,3 +877,26 @@ TEST(ReduceHalf, AllTrue) {
     array gold = constant(1, 1, b8);
     ASSERT_ARRAYS_EQ(gold, out);
 }
+
+TEST(Reduce, JITExpression) {
+    array a = af::randu(300, 29, 11, 3);
+    array b = af::randu(300, 29, 11, 3);
+    a.eval();
+    b.eval();
+
+    array prod           = a * b;
+    array diff           = af::abs(a - b);
+    array prod_evaluated = prod.copy();
+    array diff_evaluated = diff.copy();
+    prod_evaluated.eval();
+    diff_evaluated.eval();
+
+    for (int dim = 0; dim < 4; dim++) {
+        ASSERT_ARRAYS_NEAR(af::sum(prod_evaluated, dim), af::sum(a * b, dim),
+                           1e-3);
+        ASSERT_ARRAYS_EQ(af::max(diff_evaluated, dim),
+                         af::max(af::abs(a - b), dim));
+    }
+    ASSERT_NEAR(af::sum<float>(prod_evaluated), af::sum<float>(a * b), 1e-1);
+    ASSERT_EQ(af::max<float>(diff_evaluated), af::max<float>(af::abs(a - b)));
+}
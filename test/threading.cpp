@@ -252,6 +252,41 @@ TEST(Threading, MemoryManagement_JIT_Node) {
     ASSERT_EQ(lock_bytes, 0u);
 }
 
+TEST(Threading, MemoryManagementCrossThreadFree) {
+    cleanSlate();  // Clean up everything done so far
+
+    size_t alloc_bytes, alloc_buffers;
+    size_t lock_bytes, lock_buffers;
+
+    // Released by a thread other than the one that allocated it
+    array a = randu(5, 5);
+    std::thread([&a] { a = array(); }).join();
+
+    deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+    ASSERT_EQ(alloc_buffers, 1u);
+    ASSERT_EQ(lock_buffers, 0u);
+
+    // The buffer is available to other threads
+    std::thread([] {
+        array b = randu(5, 5);
+
+        size_t alloc_bytes, alloc_buffers;
+        size_t lock_bytes, lock_buffers;
+        deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes,
+                      &lock_buffers);
+        ASSERT_EQ(alloc_buffers, 1u);
+        ASSERT_EQ(lock_buffers, 1u);
+    }).join();
+
+    // The free buffers of all threads are collected
+    deviceGC();
+    deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+    ASSERT_EQ(alloc_buffers, 0u);
+    ASSERT_EQ(lock_buffers, 0u);
+    ASSERT_EQ(alloc_bytes, 0u);
+    ASSERT_EQ(lock_bytes, 0u);
+}
+
 template<typename inType, typename outType, bool isInverse>
 void fftTest(int targetDevice, string pTestFile, dim_t pad0 = 0, dim_t pad1 = 0,
              dim_t pad2 = 0) {